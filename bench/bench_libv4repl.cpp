@@ -0,0 +1,516 @@
+/**
+ * @file bench_libv4repl.cpp
+ * @brief Microbenchmarks for the libv4repl eval pipeline
+ *
+ * Measures each phase of v4_repl_process_line() separately (compile,
+ * word registration, execution, stack printing) plus the end-to-end call,
+ * over a few representative workloads. Results are written as JSON in
+ * the same shape as Google Benchmark's --benchmark_format=json so they
+ * can be compared across V4 / V4-front upgrades with the usual tooling.
+ *
+ * Options:
+ *   --out=FILE       Write JSON to FILE instead of stdout
+ *   --filter=TEXT    Only run benchmarks whose name contains TEXT
+ *   --min-time=SEC   Minimum measuring time per benchmark (default 0.2)
+ *
+ * pool/w<N> benchmarks report time per line across N workers, so ideal
+ * scaling halves the figure each time N doubles.
+ */
+
+extern "C" {
+#include "v4/vm_api.h"
+#include "v4front/compile.h"
+#include "v4repl/repl.h"
+}
+
+#if V4REPL_WITH_POOL
+#include "v4repl/pool.h"
+
+#include <thread>
+#endif
+
+#include "vm_word.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define DUP _dup
+#define DUP2 _dup2
+#define CLOSE _close
+#define FILENO _fileno
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define DUP dup
+#define DUP2 dup2
+#define CLOSE close
+#define FILENO fileno
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double ns_per_iter;
+  std::string label;
+};
+
+struct Options {
+  const char* out_path = nullptr;
+  const char* filter = nullptr;
+  double min_time = 0.2;
+};
+
+Options g_opts;
+std::vector<Result> g_results;
+
+/**
+ * @brief Run @p body with growing iteration counts until min_time is reached
+ *
+ * @p body(n) must perform n iterations of the measured operation and return
+ * the nanoseconds spent in the measured part (setup can be excluded).
+ */
+template <typename F>
+void run_bench(const char* name, const char* label, F&& body) {
+  if (g_opts.filter && !strstr(name, g_opts.filter)) {
+    return;
+  }
+
+  const double min_ns = g_opts.min_time * 1e9;
+  uint64_t iters = 1;
+  double ns = 0;
+
+  while (true) {
+    ns = body(iters);
+    if (ns >= min_ns || iters >= (1ull << 30)) {
+      break;
+    }
+    // Predict the count needed to reach min_time (at most 10x growth per round)
+    double scale = (ns > 0) ? (min_ns * 1.4 / ns) : 10.0;
+    if (scale > 10.0) {
+      scale = 10.0;
+    }
+    uint64_t next = (uint64_t) (iters * scale);
+    iters = (next > iters) ? next : iters + 1;
+  }
+
+  g_results.push_back(Result{name, iters, ns / (double) iters, label ? label : ""});
+  fprintf(stderr, "%-40s %12.1f ns %10llu\n", name, ns / (double) iters,
+          (unsigned long long) iters);
+}
+
+double elapsed_ns(Clock::time_point start) {
+  return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+      .count();
+}
+
+/**
+ * @brief VM + compiler + REPL context for one workload
+ */
+class Session {
+ public:
+  Session() {
+    memset(mem_, 0, sizeof(mem_));
+    VmConfig cfg = {0};
+    cfg.mem = mem_;
+    cfg.mem_size = sizeof(mem_);
+    cfg.arena = nullptr;  // Word names from malloc: large dictionaries exceed a small arena
+    vm = vm_create(&cfg);
+    front = v4front_context_create();
+
+    V4ReplConfig rcfg;
+    memset(&rcfg, 0, sizeof(rcfg));
+    rcfg.vm = vm;
+    rcfg.front_ctx = front;
+    repl = v4_repl_create(&rcfg);
+
+    if (!vm || !front || !repl) {
+      fprintf(stderr, "Failed to create benchmark session\n");
+      exit(1);
+    }
+  }
+
+  ~Session() {
+    v4_repl_destroy(repl);
+    v4front_context_destroy(front);
+    vm_destroy(vm);
+  }
+
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+
+  void eval(const char* line) {
+    if (v4_repl_process_line(repl, line) != 0) {
+      fprintf(stderr, "Setup line failed: %s\n%s\n", line, v4_repl_get_error(repl));
+      exit(1);
+    }
+  }
+
+  struct Vm* vm;
+  V4FrontContext* front;
+  V4ReplContext* repl;
+
+ private:
+  uint8_t mem_[16384];
+};
+
+/**
+ * @brief Compile-only, execute-only and end-to-end benchmarks for one line
+ */
+void bench_line(const char* workload, Session& s, const char* line) {
+  std::string prefix = workload;
+
+  run_bench((prefix + "/compile").c_str(), "includes v4front_free", [&](uint64_t n) {
+    V4FrontError error;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      V4FrontBuf buf;
+      memset(&buf, 0, sizeof(buf));
+      v4front_compile_with_context_ex(s.front, line, &buf, &error);
+      v4front_free(&buf);
+    }
+    return elapsed_ns(start);
+  });
+
+  V4FrontBuf buf;
+  memset(&buf, 0, sizeof(buf));
+  V4FrontError error;
+  if (v4front_compile_with_context_ex(s.front, line, &buf, &error) != 0 || buf.word_count != 0) {
+    fprintf(stderr, "Benchmark line must compile to plain code: %s\n", line);
+    exit(1);
+  }
+
+  run_bench((prefix + "/exec").c_str(), nullptr, [&](uint64_t n) {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      v4repl_exec_code(s.vm, buf.data, buf.size);
+    }
+    return elapsed_ns(start);
+  });
+  v4front_free(&buf);
+
+  run_bench((prefix + "/process_line").c_str(), nullptr, [&](uint64_t n) {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      v4_repl_process_line(s.repl, line);
+    }
+    return elapsed_ns(start);
+  });
+}
+
+void bench_arith() {
+  Session s;
+  bench_line("arith", s, "1 2 + 3 * 4 - 5 AND 6 OR DROP");
+}
+
+void bench_recurse() {
+  Session s;
+  s.eval(": FIB DUP 2 < IF DROP 1 ELSE DUP 1 - RECURSE SWAP 2 - RECURSE + THEN ;");
+  s.eval(": COUNTDOWN DUP 0 > IF 1 - RECURSE THEN ;");
+  bench_line("recurse_fib15", s, "15 FIB DROP");
+  bench_line("recurse_depth24", s, "24 COUNTDOWN DROP");
+}
+
+/**
+ * @brief Build a PASTE-style block of @p count definitions
+ */
+std::string make_paste_block(int count) {
+  std::string src;
+  char line[128];
+  for (int i = 0; i < count; ++i) {
+    if (i == 0) {
+      snprintf(line, sizeof(line), ": P%d\n  DUP 1 +\n  SWAP DROP\n;\n", i);
+    } else {
+      snprintf(line, sizeof(line), ": P%d\n  P%d 1 +\n  DUP DROP\n;\n", i, i - 1);
+    }
+    src += line;
+  }
+  return src;
+}
+
+void bench_paste() {
+  const int kDefs = 64;
+  std::string block = make_paste_block(kDefs);
+
+  run_bench("paste64/compile", "includes v4front_free", [&](uint64_t n) {
+    Session s;
+    V4FrontError error;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      V4FrontBuf buf;
+      memset(&buf, 0, sizeof(buf));
+      v4front_compile_with_context_ex(s.front, block.c_str(), &buf, &error);
+      v4front_free(&buf);
+    }
+    return elapsed_ns(start);
+  });
+
+  // Register the compiled block into a fresh dictionary per iteration
+  Session s;
+  V4FrontBuf buf;
+  memset(&buf, 0, sizeof(buf));
+  V4FrontError error;
+  if (v4front_compile_with_context_ex(s.front, block.c_str(), &buf, &error) != 0) {
+    fprintf(stderr, "PASTE block failed to compile\n");
+    exit(1);
+  }
+
+  run_bench("paste64/register", "vm_register_word + v4front_context_register_word per word",
+            [&](uint64_t n) {
+              double ns = 0;
+              for (uint64_t i = 0; i < n; ++i) {
+                vm_reset_dictionary(s.vm);
+                v4front_context_reset(s.front);
+                auto start = Clock::now();
+                for (int w = 0; w < buf.word_count; ++w) {
+                  V4FrontWord* word = &buf.words[w];
+                  int wid = vm_register_word(s.vm, word->name, word->code, (int) word->code_len);
+                  v4front_context_register_word(s.front, word->name, wid);
+                }
+                ns += elapsed_ns(start);
+              }
+              return ns;
+            });
+
+  vm_reset_dictionary(s.vm);
+  v4front_context_reset(s.front);
+  v4front_free(&buf);
+
+  run_bench("paste64/process_line", "fresh dictionary per iteration", [&](uint64_t n) {
+    double ns = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      v4_repl_reset_dictionary(s.repl);
+      auto start = Clock::now();
+      v4_repl_process_line(s.repl, block.c_str());
+      ns += elapsed_ns(start);
+    }
+    return ns;
+  });
+}
+
+void bench_large_dictionary() {
+  const int kWanted = 2000;
+  Session s;
+
+  // Fill the dictionary until it holds kWanted words or the VM refuses
+  int defined = 0;
+  char line[64];
+  for (int i = 0; i < kWanted; ++i) {
+    snprintf(line, sizeof(line), ": W%d %d ;", i, i);
+    if (v4_repl_process_line(s.repl, line) != 0) {
+      break;
+    }
+    defined++;
+  }
+  if (defined == 0) {
+    fprintf(stderr, "Could not define any words\n");
+    exit(1);
+  }
+
+  char label[64];
+  snprintf(label, sizeof(label), "%d words defined", defined);
+  char use_last[64];
+  snprintf(use_last, sizeof(use_last), "W%d W0 + DROP", defined - 1);
+
+  std::string prefix = "dict";
+  prefix += std::to_string(defined);
+
+  run_bench((prefix + "/compile_lookup").c_str(), label, [&](uint64_t n) {
+    V4FrontError error;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      V4FrontBuf buf;
+      memset(&buf, 0, sizeof(buf));
+      v4front_compile_with_context_ex(s.front, use_last, &buf, &error);
+      v4front_free(&buf);
+    }
+    return elapsed_ns(start);
+  });
+
+  run_bench((prefix + "/process_line").c_str(), label, [&](uint64_t n) {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      v4_repl_process_line(s.repl, use_last);
+    }
+    return elapsed_ns(start);
+  });
+}
+
+void bench_print_stack() {
+  Session s;
+  s.eval("1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16");
+
+  // Send stdout to the null device so terminal speed is not measured
+  fflush(stdout);
+  int saved = DUP(FILENO(stdout));
+  FILE* null_out = fopen(NULL_DEVICE, "w");
+  if (saved < 0 || !null_out) {
+    fprintf(stderr, "Cannot redirect stdout; skipping print benchmarks\n");
+    if (null_out) {
+      fclose(null_out);
+    }
+    return;
+  }
+  DUP2(FILENO(null_out), FILENO(stdout));
+
+  run_bench("print_stack16", "stdout redirected to null device", [&](uint64_t n) {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      v4_repl_print_stack(s.repl);
+    }
+    fflush(stdout);
+    return elapsed_ns(start);
+  });
+
+  fflush(stdout);
+  DUP2(saved, FILENO(stdout));
+  CLOSE(saved);
+  fclose(null_out);
+}
+
+#if V4REPL_WITH_POOL
+void bench_pool() {
+  unsigned int cores = std::thread::hardware_concurrency();
+  if (cores == 0) {
+    cores = 1;
+  }
+
+  for (unsigned int workers = 1; workers <= cores; workers *= 2) {
+    V4ReplPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.workers = (int) workers;
+    config.sessions = (int) workers * 4;
+    config.queue_capacity = 4096;
+
+    V4ReplPool* pool = v4_repl_pool_create(&config);
+    if (!pool) {
+      fprintf(stderr, "Cannot create pool with %u workers\n", workers);
+      return;
+    }
+    for (int s = 0; s < config.sessions; ++s) {
+      v4_repl_pool_submit(pool, s, ": WORK 64 BEGIN 1 - DUP 0= UNTIL DROP ;", 0);
+    }
+    v4_repl_pool_wait_idle(pool);
+
+    std::string name = "pool/w" + std::to_string(workers);
+    run_bench(name.c_str(), "ns per line, round-robin submit", [&](uint64_t n) {
+      auto start = Clock::now();
+      for (uint64_t i = 0; i < n; ++i) {
+        int session = (int) (i % (uint64_t) config.sessions);
+        while (v4_repl_pool_submit(pool, session, "WORK", 0) == V4_REPL_POOL_ERR_FULL) {
+          std::this_thread::yield();
+        }
+      }
+      v4_repl_pool_wait_idle(pool);
+      return elapsed_ns(start);
+    });
+
+    v4_repl_pool_destroy(pool);
+  }
+}
+#endif
+
+void write_json_string(FILE* out, const std::string& s) {
+  fputc('"', out);
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      fputc('\\', out);
+    }
+    fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+void write_json(FILE* out) {
+  char date[64];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  int version = v4_repl_version();
+  fprintf(out, "{\n");
+  fprintf(out, "  \"context\": {\n");
+  fprintf(out, "    \"date\": \"%s\",\n", date);
+  fprintf(out, "    \"executable\": \"bench_libv4repl\",\n");
+  fprintf(out, "    \"libv4repl_version\": \"%d.%d.%d\",\n", (version >> 16) & 0xFF,
+          (version >> 8) & 0xFF, version & 0xFF);
+  fprintf(out, "    \"min_time\": %.3f\n", g_opts.min_time);
+  fprintf(out, "  },\n");
+  fprintf(out, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < g_results.size(); ++i) {
+    const Result& r = g_results[i];
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"name\": ");
+    write_json_string(out, r.name);
+    fprintf(out, ",\n");
+    fprintf(out, "      \"run_type\": \"iteration\",\n");
+    fprintf(out, "      \"iterations\": %llu,\n", (unsigned long long) r.iterations);
+    fprintf(out, "      \"real_time\": %.3f,\n", r.ns_per_iter);
+    fprintf(out, "      \"time_unit\": \"ns\"");
+    if (!r.label.empty()) {
+      fprintf(out, ",\n      \"label\": ");
+      write_json_string(out, r.label);
+    }
+    fprintf(out, "\n    }%s\n", (i + 1 < g_results.size()) ? "," : "");
+  }
+  fprintf(out, "  ]\n");
+  fprintf(out, "}\n");
+}
+
+bool parse_args(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--out=", 6) == 0) {
+      g_opts.out_path = arg + 6;
+    } else if (strncmp(arg, "--filter=", 9) == 0) {
+      g_opts.filter = arg + 9;
+    } else if (strncmp(arg, "--min-time=", 11) == 0) {
+      g_opts.min_time = atof(arg + 11);
+    } else {
+      fprintf(stderr, "Usage: %s [--out=FILE] [--filter=TEXT] [--min-time=SEC]\n", argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (!parse_args(argc, argv)) {
+    return 2;
+  }
+
+  bench_arith();
+  bench_recurse();
+  bench_paste();
+  bench_large_dictionary();
+  bench_print_stack();
+#if V4REPL_WITH_POOL
+  bench_pool();
+#endif
+
+  FILE* out = stdout;
+  if (g_opts.out_path) {
+    out = fopen(g_opts.out_path, "w");
+    if (!out) {
+      fprintf(stderr, "Cannot open '%s'\n", g_opts.out_path);
+      return 1;
+    }
+  }
+  write_json(out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
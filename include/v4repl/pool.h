@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "v4repl/repl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file pool.h
+ * @brief Multi-threaded session pool for libv4repl
+ *
+ * A pool owns a fixed set of REPL sessions, each with its own VM,
+ * compiler context and V4ReplContext, and a fixed set of worker threads.
+ * Session N is pinned to worker (N % workers): only that thread ever
+ * touches the session, so sessions need no locking and a session's
+ * lines run in submission order.
+ *
+ * Any thread may submit lines. Each worker has a bounded lock-free
+ * multi-producer queue; submission never blocks and never takes a lock
+ * unless the worker is asleep and must be woken.
+ *
+ * Results are delivered through V4ReplPoolConfig::on_result on the
+ * worker thread that ran the line.
+ */
+
+/**
+ * @brief Opaque pool handle
+ */
+typedef struct V4ReplPool V4ReplPool;
+
+/**
+ * @brief Result callback
+ *
+ * Called on a worker thread once per submitted line. Calls for one
+ * session are serialized; calls for different sessions may run
+ * concurrently.
+ *
+ * @param user    V4ReplPoolConfig::user
+ * @param session Session index the line was submitted to
+ * @param tag     Caller's tag from v4_repl_pool_submit()
+ * @param err     Result of v4_repl_process_line()
+ * @param output  Stack line (" ok [n]: ...\n") or "Error: ...\n"
+ *                (not NUL-terminated, valid only during the call)
+ * @param len     Length of output
+ */
+typedef void (*V4ReplPoolResultFn)(void *user, int session, uint64_t tag, v4_err err,
+                                   const char *output, size_t len);
+
+/**
+ * @brief Pool configuration
+ */
+typedef struct V4ReplPoolConfig {
+  int workers;                  /**< Worker threads (0 = hardware concurrency) */
+  int sessions;                 /**< Sessions to create (0 = one per worker) */
+  size_t vm_mem_size;           /**< VM RAM per session (0 = default: 16KB) */
+  size_t queue_capacity;        /**< Queue slots per worker, power of two (0 = 1024) */
+  int pin_workers;              /**< Non-zero: pin worker i to CPU i (Linux only) */
+  V4ReplPoolResultFn on_result; /**< Result callback (may be NULL) */
+  void *user;                   /**< Passed to on_result */
+} V4ReplPoolConfig;
+
+/** v4_repl_pool_submit(): the worker's queue is full, retry later */
+#define V4_REPL_POOL_ERR_FULL (-1)
+/** v4_repl_pool_submit(): session index out of range */
+#define V4_REPL_POOL_ERR_SESSION (-2)
+/** v4_repl_pool_submit(): out of memory copying the line */
+#define V4_REPL_POOL_ERR_NOMEM (-3)
+
+/**
+ * @brief Create a pool and start its workers
+ *
+ * @param config Configuration (must not be NULL)
+ * @return Pool handle, or NULL on failure
+ */
+V4ReplPool *v4_repl_pool_create(const V4ReplPoolConfig *config);
+
+/**
+ * @brief Finish queued lines, stop the workers and free all sessions
+ *
+ * @param pool Pool (NULL-safe)
+ */
+void v4_repl_pool_destroy(V4ReplPool *pool);
+
+/**
+ * @brief Queue a line for a session
+ *
+ * The line is copied; the caller's buffer may be reused immediately.
+ * Thread-safe and lock-free.
+ *
+ * @param pool    Pool
+ * @param session Session index (0 .. sessions-1)
+ * @param line    Forth source (NUL-terminated)
+ * @param tag     Opaque value handed back to on_result
+ * @return 0 on success, or a V4_REPL_POOL_ERR_* code
+ */
+int v4_repl_pool_submit(V4ReplPool *pool, int session, const char *line, uint64_t tag);
+
+/**
+ * @brief Interrupt the line a session is running (or its next line)
+ *
+ * See v4_repl_interrupt(). Lines still queued are not discarded.
+ *
+ * @param pool    Pool
+ * @param session Session index
+ */
+void v4_repl_pool_interrupt(V4ReplPool *pool, int session);
+
+/**
+ * @brief Block until every submitted line has been processed
+ *
+ * @param pool Pool
+ */
+void v4_repl_pool_wait_idle(V4ReplPool *pool);
+
+/**
+ * @brief Number of sessions in the pool
+ */
+int v4_repl_pool_session_count(const V4ReplPool *pool);
+
+/**
+ * @brief Number of worker threads in the pool
+ */
+int v4_repl_pool_worker_count(const V4ReplPool *pool);
+
+/**
+ * @brief Access a session's REPL context
+ *
+ * Only safe while the pool is idle (after v4_repl_pool_wait_idle() and
+ * before the next submit), e.g. to read stats or the stack.
+ *
+ * @param pool    Pool
+ * @param session Session index
+ * @return REPL context, or NULL if the index is out of range
+ */
+V4ReplContext *v4_repl_pool_context(V4ReplPool *pool, int session);
+
+#ifdef __cplusplus
+}
+#endif
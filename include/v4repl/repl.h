@@ -6,6 +6,11 @@
 #include "v4/vm_api.h"
 #include "v4front/compile.h"
 
+/* Per-phase instrumentation (v4_repl_get_stats); set by the build */
+#ifndef V4_REPL_ENABLE_STATS
+#define V4_REPL_ENABLE_STATS 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -22,12 +27,28 @@ extern "C" {
  * - Stack preservation between evaluations
  * - Detailed error reporting
  * - Configurable memory limits
+ * - Optional LRU cache of compiled lines
+ * - Non-blocking evaluation (v4_repl_submit_line() / v4_repl_poll())
+ * - Session images (v4_repl_snapshot() / v4_repl_restore())
+ * - Hash-indexed word lookup and prefix completion
  */
 
 /* ------------------------------------------------------------------------- */
 /* Configuration                                                             */
 /* ------------------------------------------------------------------------- */
 
+/**
+ * @brief Output sink callback
+ *
+ * Receives a chunk of REPL output (stack display, error messages).
+ * Chunks are not NUL-terminated and usually end at a line boundary.
+ *
+ * @param user User pointer from V4ReplConfig::write_user
+ * @param data Output bytes
+ * @param len  Number of bytes
+ */
+typedef void (*V4ReplWriteFn)(void *user, const char *data, size_t len);
+
 /**
  * @brief REPL configuration structure
  *
@@ -37,8 +58,66 @@ typedef struct V4ReplConfig {
   struct Vm *vm;              /**< VM instance (must not be NULL) */
   V4FrontContext *front_ctx;  /**< Compiler context (must not be NULL) */
   size_t line_buffer_size;    /**< Maximum line length (0 = default: 512) */
+  size_t bytecode_cache_size; /**< Compiled-line LRU cache entries (0 = disabled) */
+  uint8_t *code_arena;        /**< Definition bytecode arena (NULL = heap buffers) */
+  size_t code_arena_size;     /**< Size of code_arena in bytes */
+  uint64_t (*clock_ns)(void); /**< Monotonic ns clock (NULL = platform default) */
+  V4ReplWriteFn write;        /**< Output sink (NULL = stdout) */
+  void *write_user;           /**< User pointer passed to write */
+  char *out_buf;              /**< Output staging buffer (NULL = 128-byte stack buffer) */
+  size_t out_buf_size;        /**< Size of out_buf in bytes */
+  uint8_t *vm_mem;            /**< VM RAM to include in session images (NULL = omit) */
+  size_t vm_mem_size;         /**< Size of vm_mem in bytes */
+  const uint8_t *preload;     /**< Bytecode bundle registered at creation (NULL = none) */
+  size_t preload_size;        /**< Size of preload in bytes */
+  int lazy_definitions;       /**< Compile definitions on first use (see below) */
 } V4ReplConfig;
 
+/*
+ * Code arena
+ *
+ * When code_arena is set, the bytecode of every word definition is copied
+ * into that caller-provided block (bump allocation, 4-byte aligned) and
+ * the compiler output is freed immediately. No per-definition heap blocks
+ * are kept, and v4_repl_reset() / v4_repl_reset_dictionary() just rewind
+ * the arena. The arena must outlive the REPL context and the VM's use of
+ * the registered words.
+ */
+
+/*
+ * Output sink
+ *
+ * v4_repl_print_stack() and v4_repl_print_error() format into out_buf
+ * (integers are converted without printf) and call write once per line,
+ * or whenever the buffer fills. Nothing is allocated. On UART-backed
+ * ports, point write at the driver's transmit function so a deep stack
+ * costs one transfer instead of one printf per cell.
+ */
+
+/*
+ * Lazy definitions
+ *
+ * With lazy_definitions set, a line (or source chunk) that holds only
+ * colon definitions is not compiled: each definition's source is kept
+ * under its name. Before a later line is compiled, every pending word it
+ * mentions is compiled and registered, after the pending words that one
+ * mentions in turn. Words a session never uses cost neither compile time
+ * nor bytecode. Names inside a lazy definition keep the meaning they had
+ * when it was entered: a pending definition is compiled before any word
+ * it uses is redefined. v4_repl_snapshot() compiles every pending
+ * definition first, so images never miss a word.
+ */
+
+/*
+ * Preloaded bundle
+ *
+ * preload points at a bytecode bundle written by `v4-repl --compile`
+ * (or any session image). v4_repl_create() registers its words in place,
+ * exactly like v4_repl_restore() with V4_REPL_RESTORE_IN_PLACE, so a
+ * standard library costs no compilation at boot. The bundle must outlive
+ * the context; a const array in flash works well.
+ */
+
 /**
  * @brief Opaque REPL context handle
  *
@@ -54,7 +133,8 @@ typedef struct V4ReplContext V4ReplContext;
  * @brief Create a new REPL context
  *
  * @param config Configuration structure (must not be NULL)
- * @return REPL context pointer, or NULL on allocation failure
+ * @return REPL context pointer, or NULL on allocation failure or if the
+ *         preload bundle cannot be registered
  *
  * @note The VM and compiler context must remain valid for the lifetime
  *       of the REPL context.
@@ -88,6 +168,7 @@ void v4_repl_destroy(V4ReplContext *ctx);
  * Error codes:
  * - 0: Success
  * - Negative: Compilation or execution error (V4/V4-front error codes)
+ * - V4_REPL_ERR_BUSY: a line from v4_repl_submit_line() is in progress
  *
  * @note This function does NOT print the stack or "ok" prompt.
  *       The caller should call v4_repl_print_stack() and print "ok"
@@ -99,7 +180,8 @@ v4_err v4_repl_process_line(V4ReplContext *ctx, const char *line);
  * @brief Reset REPL state
  *
  * Clears VM stacks and resets compiler context to initial state.
- * Does not clear VM memory or word dictionary.
+ * Does not clear VM memory or word dictionary. A submitted line that
+ * has not finished is dropped without calling its callback.
  *
  * @param ctx REPL context
  */
@@ -114,6 +196,263 @@ void v4_repl_reset(V4ReplContext *ctx);
  */
 void v4_repl_reset_dictionary(V4ReplContext *ctx);
 
+/**
+ * @brief Get the number of code arena bytes in use
+ *
+ * @param ctx REPL context
+ * @return Bytes allocated from the code arena (0 if no arena is configured)
+ */
+size_t v4_repl_code_arena_used(const V4ReplContext *ctx);
+
+/** Returned by v4_repl_process_line() when v4_repl_interrupt() was called */
+#define V4_REPL_ERR_INTERRUPTED (-100)
+/** A submitted line is still in progress (see v4_repl_submit_line()) */
+#define V4_REPL_ERR_BUSY (-101)
+/** v4_repl_submit_line(): line does not fit V4ReplConfig::line_buffer_size */
+#define V4_REPL_ERR_LINE_TOO_LONG (-102)
+/** v4_repl_restore(): image is malformed, corrupt or from another version */
+#define V4_REPL_ERR_IMAGE (-103)
+
+/**
+ * @brief Request that the current or next line be abandoned
+ *
+ * Safe to call from any thread or from a signal handler. The request is
+ * checked before compiling and around execution; when seen, the data
+ * stack is cleared and v4_repl_process_line() returns
+ * V4_REPL_ERR_INTERRUPTED. A request made while the context is idle
+ * applies to the next line.
+ *
+ * @note Bytecode that is already running on the VM is not stopped
+ *       mid-way; the line ends when it returns.
+ *
+ * @param ctx REPL context
+ */
+void v4_repl_interrupt(V4ReplContext *ctx);
+
+/* ------------------------------------------------------------------------- */
+/* Non-blocking evaluation                                                   */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * A line is processed in steps: compile (or bytecode cache lookup), one
+ * step per word definition, then execution of the top-level code.
+ * v4_repl_submit_line() queues a line and v4_repl_poll() runs steps until
+ * a time budget is used up, so a host main loop can service UART, USB or
+ * a watchdog between steps:
+ *
+ *   v4_repl_submit_line(repl, line, on_done, NULL);
+ *   while (v4_repl_poll(repl, 500)) {
+ *       service_peripherals();
+ *   }
+ *
+ * The VM has no instruction budget, so the top-level code of a line runs
+ * as one step. Long-running words should leave work to V4 tasks (SPAWN,
+ * YIELD) instead of looping at the top level.
+ */
+
+/**
+ * @brief Completion callback for v4_repl_submit_line()
+ *
+ * Called from v4_repl_poll() once the line has finished. The context is
+ * already idle, so the callback may submit the next line.
+ *
+ * @param user  User pointer given to v4_repl_submit_line()
+ * @param err   Result, as v4_repl_process_line() would have returned it
+ * @param error Error message, or NULL on success (valid until the next
+ *              line is submitted)
+ */
+typedef void (*V4ReplDoneFn)(void *user, v4_err err, const char *error);
+
+/**
+ * @brief Queue a line for non-blocking evaluation
+ *
+ * The line is copied into the context's line buffer; nothing runs until
+ * v4_repl_poll() is called. Only one line can be in progress at a time,
+ * and v4_repl_process_line() returns V4_REPL_ERR_BUSY meanwhile.
+ *
+ * @param ctx     REPL context
+ * @param line    Input line (null-terminated string)
+ * @param on_done Completion callback (may be NULL)
+ * @param user    Passed to on_done
+ * @return 0 on success, V4_REPL_ERR_BUSY, V4_REPL_ERR_LINE_TOO_LONG or -1
+ */
+v4_err v4_repl_submit_line(V4ReplContext *ctx, const char *line, V4ReplDoneFn on_done,
+                           void *user);
+
+/**
+ * @brief Advance the submitted line
+ *
+ * Runs at least one step, then further steps until @p budget_us
+ * microseconds (measured with V4ReplConfig::clock_ns) have elapsed or the
+ * line finishes. A budget of 0 runs exactly one step. A step that starts
+ * before the deadline runs to completion, so a call can overrun the
+ * budget by the length of one step.
+ *
+ * @note The execute step is not bounded: the VM has no instruction
+ *       budget, so the top-level code of a line (and every word it
+ *       calls) runs to completion inside one poll. A word that loops
+ *       for a long time blocks the host loop for that long.
+ *
+ * @param ctx       REPL context
+ * @param budget_us Time budget in microseconds
+ * @return 1 if a line is still in progress, 0 if the context is idle
+ */
+int v4_repl_poll(V4ReplContext *ctx, uint32_t budget_us);
+
+/**
+ * @brief Check whether a submitted line is in progress
+ *
+ * @param ctx REPL context
+ * @return 1 if busy, 0 if idle
+ */
+int v4_repl_busy(const V4ReplContext *ctx);
+
+/* ------------------------------------------------------------------------- */
+/* Source loading                                                            */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * v4_repl_load_source() evaluates a whole source text (a library file, a
+ * saved program). Consecutive chunks that only define words are compiled
+ * together: a definition goes in a later "wave" than any definition it
+ * uses or replaces, the definitions of one wave are compiled in parallel
+ * (each worker against its own copy of the compiler's name table), and
+ * the results are registered on the calling thread, wave by wave. A
+ * chunk with top-level code waits for everything before it and runs on
+ * its own, exactly as v4_repl_process_line() would run it.
+ *
+ * Word IDs are therefore assigned in wave order, not source order; what
+ * each name means to the code that uses it is the same as line by line.
+ */
+
+/**
+ * @brief Compile and run a source text
+ *
+ * @param ctx     REPL context
+ * @param source  Forth source (null-terminated, any number of lines)
+ * @param threads Compile threads: 0 = one per hardware thread, 1 = no
+ *                threads (always the case without V4REPL_WITH_POOL)
+ * @return 0 on success, or the first error. Compile errors give the
+ *         position in the whole source; runtime errors name the source
+ *         line of the failing chunk (v4_repl_get_error()).
+ *
+ * @note On error, definitions that do not depend on the failing one may
+ *       already be registered, including some that follow it.
+ */
+v4_err v4_repl_load_source(V4ReplContext *ctx, const char *source, int threads);
+
+/* ------------------------------------------------------------------------- */
+/* Session images                                                            */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * A session image is a versioned, checksummed binary holding every word
+ * defined through this context (name, VM word ID and bytecode, in
+ * definition order), the data stack and, if V4ReplConfig::vm_mem is set,
+ * VM memory. Restoring an image registers the saved bytecode directly,
+ * so startup no longer pays for recompiling a large dictionary.
+ *
+ * The return stack is not saved: it is always empty between lines.
+ */
+
+/** v4_repl_restore(): run bytecode from the image instead of copying it */
+#define V4_REPL_RESTORE_IN_PLACE 0x1u
+
+/**
+ * @brief Write a session image
+ *
+ * Pending lazy definitions are compiled and registered first, so the
+ * dictionary may grow; a definition that fails to compile fails the
+ * snapshot (see v4_repl_get_error()).
+ *
+ * @param ctx      REPL context
+ * @param buf      Destination, or NULL to query the size only
+ * @param buf_size Size of buf in bytes
+ * @param out_len  Receives the image size (always set; 0 on a compile error)
+ * @return 0 on success, -1 if buf is too small, V4_REPL_ERR_BUSY while a
+ *         submitted line is in progress, or a lazy definition's compile error
+ */
+v4_err v4_repl_snapshot(V4ReplContext *ctx, uint8_t *buf, size_t buf_size, size_t *out_len);
+
+/**
+ * @brief Replace the session with the contents of an image
+ *
+ * Resets the dictionary, then registers the image's words with the
+ * same word IDs, restores the data stack and, when both the image and
+ * the context have VM memory, copies it back (sizes must match).
+ *
+ * Bytecode is copied into the code arena or a heap block unless @p flags
+ * contains V4_REPL_RESTORE_IN_PLACE; then it runs straight from
+ * @p image, which must stay valid (e.g. mapped) until the dictionary is
+ * reset or the context destroyed.
+ *
+ * @param ctx   REPL context
+ * @param image Image bytes
+ * @param len   Image size in bytes
+ * @param flags 0 or V4_REPL_RESTORE_IN_PLACE
+ * @return 0 on success, V4_REPL_ERR_IMAGE for an invalid image, or
+ *         another negative code (see v4_repl_get_error()); on failure
+ *         the dictionary is left empty
+ */
+v4_err v4_repl_restore(V4ReplContext *ctx, const uint8_t *image, size_t len, unsigned flags);
+
+/* ------------------------------------------------------------------------- */
+/* Word lookup                                                               */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * The context indexes every word it registers (from lines and restored
+ * images) by name and by word ID, so lookups cost O(1) and prefix
+ * queries O(log n + matches) however large the dictionary grows.
+ * Names match regardless of ASCII case, like the compiler.
+ */
+
+/**
+ * @brief Look up a word defined through this context
+ *
+ * @param ctx  REPL context
+ * @param name Word name
+ * @return Word ID of the latest definition, or -1 if not defined
+ */
+int v4_repl_find_word(const V4ReplContext *ctx, const char *name);
+
+/**
+ * @brief Name a word ID was defined under
+ *
+ * @param ctx REPL context
+ * @param wid Word ID
+ * @return Name (valid until the dictionary is reset), or NULL
+ */
+const char *v4_repl_word_name(const V4ReplContext *ctx, int wid);
+
+/**
+ * @brief List defined words starting with a prefix, in name order
+ *
+ * Intended for tab completion and filtered listings.
+ *
+ * @param ctx       REPL context
+ * @param prefix    Name prefix ("" matches every word)
+ * @param names     Receives up to max_names names (may be NULL to count)
+ * @param max_names Capacity of names
+ * @return Total number of matching words
+ */
+int v4_repl_complete(V4ReplContext *ctx, const char *prefix, const char **names, int max_names);
+
+/**
+ * @brief List lazy definitions that have not been compiled yet, in name order
+ *
+ * Same contract as v4_repl_complete(); words returned here are not (yet)
+ * known to v4_repl_find_word().
+ *
+ * @param ctx       REPL context
+ * @param prefix    Name prefix ("" matches every pending word)
+ * @param names     Receives up to max_names names (may be NULL to count)
+ * @param max_names Capacity of names
+ * @return Total number of matching pending words
+ */
+int v4_repl_lazy_words(V4ReplContext *ctx, const char *prefix, const char **names,
+                       int max_names);
+
 /* ------------------------------------------------------------------------- */
 /* Stack display helpers                                                     */
 /* ------------------------------------------------------------------------- */
@@ -127,17 +466,15 @@ void v4_repl_reset_dictionary(V4ReplContext *ctx);
 int v4_repl_stack_depth(const V4ReplContext *ctx);
 
 /**
- * @brief Print stack contents to stdout
+ * @brief Print stack contents to the output sink
  *
  * Format: " ok [depth]: val1 val2 ... valN\n"
  * If stack is empty, prints " ok\n"
  *
  * @param ctx REPL context
  *
- * @note This function prints directly to stdout.
- *       For embedded systems, you may want to implement your own
- *       stack printing by using v4_repl_stack_depth() and
- *       vm_ds_peek_public() directly.
+ * @note Output goes through V4ReplConfig::write (stdout by default)
+ *       in a single call per line, or per full out_buf.
  */
 void v4_repl_print_stack(const V4ReplContext *ctx);
 
@@ -159,6 +496,116 @@ void v4_repl_print_stack(const V4ReplContext *ctx);
  */
 const char *v4_repl_get_error(const V4ReplContext *ctx);
 
+/**
+ * @brief Print the last error message to the output sink
+ *
+ * Format: "Error: <message>\n". Prints nothing if there is no error.
+ *
+ * @param ctx REPL context
+ */
+void v4_repl_print_error(const V4ReplContext *ctx);
+
+/* ------------------------------------------------------------------------- */
+/* Bytecode cache                                                            */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Bytecode cache counters
+ *
+ * Lines without word definitions are cached by their exact text and the
+ * dictionary generation they were compiled against. Any change to the
+ * dictionary (new definitions, resets) invalidates the whole cache.
+ */
+typedef struct V4ReplCacheStats {
+  uint64_t hits;   /**< Lines executed from the cache */
+  uint64_t misses; /**< Lines that had to be compiled */
+  size_t entries;  /**< Entries currently cached */
+  size_t capacity; /**< Maximum entries (0 = cache disabled) */
+} V4ReplCacheStats;
+
+/**
+ * @brief Get bytecode cache counters
+ *
+ * @param ctx REPL context
+ * @param out Receives the counters (must not be NULL)
+ */
+void v4_repl_get_cache_stats(const V4ReplContext *ctx, V4ReplCacheStats *out);
+
+/**
+ * @brief Drop all cached bytecode
+ *
+ * Hit/miss counters are preserved.
+ *
+ * @param ctx REPL context
+ * @return 0 on success, V4_REPL_ERR_BUSY while a submitted line is in
+ *         progress (it may be running cached bytecode), or -1
+ */
+v4_err v4_repl_clear_cache(V4ReplContext *ctx);
+
+/* ------------------------------------------------------------------------- */
+/* Instrumentation                                                           */
+/* ------------------------------------------------------------------------- */
+
+/** Number of error_counts slots in V4ReplStats */
+#define V4_REPL_STATS_ERROR_SLOTS 32
+
+/**
+ * @brief Cumulative timing and error statistics
+ *
+ * Collected by v4_repl_process_line() when the library is built with
+ * V4_REPL_ENABLE_STATS=1 (CMake option V4REPL_ENABLE_STATS). Phase times
+ * are in nanoseconds from V4ReplConfig::clock_ns. `*_last` values cover
+ * the most recent non-empty line and are 0 for phases it skipped (e.g.
+ * compile on a bytecode cache hit).
+ */
+typedef struct V4ReplStats {
+  uint64_t lines;             /**< Non-empty lines processed */
+  uint64_t compile_ns_total;  /**< Time in V4-front compilation */
+  uint64_t compile_ns_last;
+  uint64_t register_ns_total; /**< Time registering definitions */
+  uint64_t register_ns_last;
+  uint64_t exec_ns_total;     /**< Time in vm_exec */
+  uint64_t exec_ns_last;
+  uint64_t bytecode_bytes;    /**< Bytecode generated (definitions + top-level code) */
+  uint64_t errors;            /**< Lines that returned an error */
+  uint64_t compile_errors;    /**< ...of which failed in the compiler */
+  /** Errors by code: slot N counts error -N, slot 0 counts out-of-range codes */
+  uint64_t error_counts[V4_REPL_STATS_ERROR_SLOTS];
+} V4ReplStats;
+
+#if V4_REPL_ENABLE_STATS
+
+/**
+ * @brief Copy the current statistics
+ *
+ * @param ctx REPL context
+ * @param out Receives the statistics
+ * @return 0 on success, -1 if stats are compiled out or arguments are NULL
+ */
+int v4_repl_get_stats(const V4ReplContext *ctx, V4ReplStats *out);
+
+/**
+ * @brief Zero all statistics
+ *
+ * @param ctx REPL context
+ */
+void v4_repl_reset_stats(V4ReplContext *ctx);
+
+#else
+
+/* Stats compiled out: calls reduce to nothing */
+static inline int v4_repl_get_stats(const V4ReplContext *ctx, V4ReplStats *out) {
+  (void) ctx;
+  (void) out;
+  return -1;
+}
+
+static inline void v4_repl_reset_stats(V4ReplContext *ctx) {
+  (void) ctx;
+}
+
+#endif
+
 /* ------------------------------------------------------------------------- */
 /* Version information                                                       */
 /* ------------------------------------------------------------------------- */
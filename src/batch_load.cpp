@@ -0,0 +1,625 @@
+#include "batch_load.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if V4REPL_WITH_POOL
+#include <atomic>
+#include <thread>
+#endif
+
+#include "chunk_lexer.hpp"
+#include "word_index.h"
+
+static const int MAX_THREADS = 64;
+
+namespace {
+
+struct Span {
+  size_t start;
+  size_t len;
+};
+
+/**
+ * @brief One complete chunk of the source
+ */
+struct Item {
+  size_t start;          // Offset in the text (NUL-terminated in place)
+  unsigned long line;    // 1-based source line where the chunk starts
+  unsigned long column;  // Offset of the chunk within that line
+  bool code;             // Holds top-level code: compiled and run on its own
+  int wave;              // Dependency depth within its run (-1: nothing to compile)
+  int names_first;       // Defined names, in Loader::names_
+  int names_count;
+
+  V4FrontBuf buf;  // Compiler output, until handed to the define hook
+  V4FrontError error;
+  v4front_err err;
+};
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool same_name(const char* a, size_t a_len, const char* b, size_t b_len) {
+  if (a_len != b_len) {
+    return false;
+  }
+  for (size_t i = 0; i < a_len; i++) {
+    char ca = (a[i] >= 'a' && a[i] <= 'z') ? (char) (a[i] - 'a' + 'A') : a[i];
+    char cb = (b[i] >= 'a' && b[i] <= 'z') ? (char) (b[i] - 'a' + 'A') : b[i];
+    if (ca != cb) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Splits, orders and compiles one source text
+ *
+ * Items between two code chunks form the current run. Within a run,
+ * defined_ maps each name to the item that last defined it and
+ * referenced_ maps every name an item uses (defined earlier in the run
+ * or not) to the latest wave that referenced it: a later redefinition
+ * must not become visible to those items, so it goes in that wave or
+ * after.
+ */
+class Loader {
+ public:
+  Loader(const char* source, const V4ReplBatchHooks* hooks)
+      : source_(source),
+        hooks_(hooks),
+        text_(nullptr),
+        loc_offset_(0),
+        loc_line_(1),
+        loc_line_start_(0),
+        items_(nullptr),
+        item_count_(0),
+        item_capacity_(0),
+        names_(nullptr),
+        name_count_(0),
+        name_capacity_(0),
+        refs_(nullptr),
+        ref_count_(0),
+        ref_capacity_(0),
+        scratch_(nullptr),
+        scratch_size_(0),
+        run_begin_(0),
+        defined_(),
+        referenced_(),
+        snapshots_(),
+        snapshot_count_(0),
+        threads_(1) {}
+
+  ~Loader() {
+    for (int i = 0; i < item_count_; i++) {
+      v4front_free(&items_[i].buf);
+    }
+    destroy_snapshots();
+    v4repl_index_free(&defined_);
+    v4repl_index_free(&referenced_);
+    free(text_);
+    free(items_);
+    free(names_);
+    free(refs_);
+    free(scratch_);
+  }
+
+  Loader(const Loader&) = delete;
+  Loader& operator=(const Loader&) = delete;
+
+  v4_err load(int threads);
+
+ private:
+  void locate(size_t offset, unsigned long* line, unsigned long* column);
+  bool add_item(size_t start);
+  bool split();
+  bool classify(int n);
+  v4_err flush(int end);
+  v4_err compile_wave(const int* wave, int count);
+  void compile_item(Item* item, V4FrontContext* ctx);
+  bool ensure_snapshots();
+  bool update_snapshots(const int* wave, int count);
+  void destroy_snapshots();
+  const char* name_at(const Span& s);
+  bool push_span(Span** arr, int* count, int* capacity, size_t start, size_t len);
+
+#if V4REPL_WITH_POOL
+  static void worker(Loader* self, const int* wave, int count, std::atomic<int>* next,
+                     V4FrontContext* ctx);
+#endif
+
+  const char* source_;
+  const V4ReplBatchHooks* hooks_;
+  char* text_;  // Copy of source_, split into NUL-terminated chunks
+
+  size_t loc_offset_;  // locate() cursor
+  unsigned long loc_line_;
+  size_t loc_line_start_;
+
+  Item* items_;
+  int item_count_;
+  int item_capacity_;
+
+  Span* names_;  // Names defined by each item
+  int name_count_;
+  int name_capacity_;
+
+  Span* refs_;  // Names referenced by the item being classified
+  int ref_count_;
+  int ref_capacity_;
+
+  char* scratch_;  // NUL-terminated copy of one name
+  size_t scratch_size_;
+
+  int run_begin_;  // First item of the current run of definitions
+  V4ReplWordIndex defined_;
+  V4ReplWordIndex referenced_;
+
+  V4FrontContext* snapshots_[MAX_THREADS];  // Name tables of workers 1..threads-1
+  int snapshot_count_;
+  int threads_;
+};
+
+bool Loader::push_span(Span** arr, int* count, int* capacity, size_t start, size_t len) {
+  if (*count >= *capacity) {
+    int new_cap = *capacity ? *capacity * 2 : 64;
+    Span* grown = (Span*) realloc(*arr, (size_t) new_cap * sizeof(Span));
+    if (!grown) {
+      return false;
+    }
+    *arr = grown;
+    *capacity = new_cap;
+  }
+  (*arr)[*count].start = start;
+  (*arr)[*count].len = len;
+  (*count)++;
+  return true;
+}
+
+const char* Loader::name_at(const Span& s) {
+  if (s.len + 1 > scratch_size_) {
+    size_t new_size = scratch_size_ ? scratch_size_ : 64;
+    while (new_size < s.len + 1) {
+      new_size *= 2;
+    }
+    char* grown = (char*) realloc(scratch_, new_size);
+    if (!grown) {
+      return nullptr;
+    }
+    scratch_ = grown;
+    scratch_size_ = new_size;
+  }
+  memcpy(scratch_, text_ + s.start, s.len);
+  scratch_[s.len] = '\0';
+  return scratch_;
+}
+
+// Line and column of a text offset; offsets must come in increasing order
+void Loader::locate(size_t offset, unsigned long* line, unsigned long* column) {
+  for (; loc_offset_ < offset; loc_offset_++) {
+    if (source_[loc_offset_] == '\n') {
+      loc_line_++;
+      loc_line_start_ = loc_offset_ + 1;
+    }
+  }
+  *line = loc_line_;
+  *column = (unsigned long) (offset - loc_line_start_);
+}
+
+bool Loader::add_item(size_t start) {
+  if (item_count_ >= item_capacity_) {
+    int new_cap = item_capacity_ ? item_capacity_ * 2 : 64;
+    Item* grown = (Item*) realloc(items_, (size_t) new_cap * sizeof(Item));
+    if (!grown) {
+      return false;
+    }
+    items_ = grown;
+    item_capacity_ = new_cap;
+  }
+  Item* item = &items_[item_count_++];
+  memset(item, 0, sizeof(*item));
+  item->start = start;
+  item->wave = -1;
+  locate(start, &item->line, &item->column);
+  return true;
+}
+
+/*
+ * Split the text into chunks with a ChunkLexer, one line at a time, and
+ * NUL-terminate each chunk in place: over its trailing newline, or over
+ * the whitespace after the ; that ends it mid-line. The next chunk starts
+ * after the overwritten byte.
+ */
+bool Loader::split() {
+  size_t size = strlen(source_);
+  text_ = (char*) malloc(size + 1);
+  if (!text_) {
+    return false;
+  }
+  memcpy(text_, source_, size + 1);
+
+  ChunkLexer lexer;
+  size_t start = 0;
+  size_t line_start = 0;
+  while (line_start < size) {
+    const char* eol = (const char*) memchr(text_ + line_start, '\n', size - line_start);
+    size_t line_end = eol ? (size_t) (eol - text_) + 1 : size;
+    size_t end = lexer.scan(text_, line_start, line_end);
+
+    if (end != 0) {
+      if (!add_item(start)) {
+        return false;
+      }
+      size_t term = (end == line_end && text_[end - 1] == '\n') ? end - 1 : end;
+      if (term < size) {
+        text_[term] = '\0';
+      }
+      start = (term < size) ? term + 1 : size;
+    }
+    line_start = line_end;
+  }
+
+  // An unterminated fragment: the compiler reports what is missing
+  if (start < size && !add_item(start)) {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Tokenize item n (skipping comments and string text), decide whether it
+ * holds top-level code and, if it only defines words, place it in a wave
+ * and record its names and references for the items after it.
+ */
+bool Loader::classify(int n) {
+  Item* item = &items_[n];
+  const char* text = text_;
+  size_t i = item->start;
+  bool in_def = false;
+  bool want_name = false;
+
+  item->names_first = name_count_;
+  item->names_count = 0;
+  ref_count_ = 0;
+
+  while (text[i]) {
+    if (is_space(text[i])) {
+      i++;
+      continue;
+    }
+    size_t tok = i;
+    while (text[i] && !is_space(text[i])) {
+      i++;
+    }
+    size_t len = i - tok;
+
+    if (want_name) {
+      want_name = false;
+      if (!push_span(&names_, &name_count_, &name_capacity_, tok, len)) {
+        return false;
+      }
+      item->names_count++;
+    } else if (len == 1 && text[tok] == '\\') {
+      while (text[i] && text[i] != '\n') {
+        i++;
+      }
+    } else if (len == 1 && text[tok] == '(') {
+      while (text[i] && text[i] != ')') {
+        i++;
+      }
+      if (text[i]) {
+        i++;
+      }
+    } else if (len >= 2 && text[tok + len - 1] == '"') {
+      if (!in_def) {
+        item->code = true;
+      }
+      if (text[i]) {
+        i++;  // The space after the word is not part of the string
+      }
+      while (text[i] && text[i] != '"') {
+        i++;
+      }
+      if (text[i]) {
+        i++;
+      }
+    } else if (len == 1 && text[tok] == ':') {
+      in_def = true;
+      want_name = true;
+    } else if (len == 1 && text[tok] == ';') {
+      in_def = false;
+    } else if (!in_def) {
+      item->code = true;
+    } else {
+      // Words defined earlier in this chunk are resolved by the compiler
+      bool local = false;
+      for (int k = 0; k < item->names_count && !local; k++) {
+        const Span& s = names_[item->names_first + k];
+        local = same_name(text + s.start, s.len, text + tok, len);
+      }
+      if (!local && !push_span(&refs_, &ref_count_, &ref_capacity_, tok, len)) {
+        return false;
+      }
+    }
+  }
+
+  if (item->code || item->names_count == 0) {
+    return true;
+  }
+
+  // After every definition it uses or replaces, and not before an item
+  // that must still see the previous meaning of one of its names
+  int wave = 0;
+  for (int k = 0; k < ref_count_; k++) {
+    const char* name = name_at(refs_[k]);
+    if (!name) {
+      return false;
+    }
+    int32_t d = v4repl_index_find(&defined_, name);
+    if (d >= 0 && items_[d].wave + 1 > wave) {
+      wave = items_[d].wave + 1;
+    }
+  }
+  for (int k = 0; k < item->names_count; k++) {
+    const char* name = name_at(names_[item->names_first + k]);
+    if (!name) {
+      return false;
+    }
+    int32_t d = v4repl_index_find(&defined_, name);
+    if (d >= 0 && items_[d].wave + 1 > wave) {
+      wave = items_[d].wave + 1;
+    }
+    int32_t u = v4repl_index_find(&referenced_, name);
+    if (u > wave) {
+      wave = u;
+    }
+  }
+  item->wave = wave;
+
+  for (int k = 0; k < ref_count_; k++) {
+    const char* name = name_at(refs_[k]);
+    if (!name) {
+      return false;
+    }
+    int32_t u = v4repl_index_find(&referenced_, name);
+    if (u < wave && v4repl_index_add(&referenced_, name, wave) != 0) {
+      return false;
+    }
+  }
+  for (int k = 0; k < item->names_count; k++) {
+    const char* name = name_at(names_[item->names_first + k]);
+    if (!name || v4repl_index_add(&defined_, name, n) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Loader::compile_item(Item* item, V4FrontContext* ctx) {
+  item->err = v4front_compile_with_context_ex(ctx, text_ + item->start, &item->buf, &item->error);
+}
+
+#if V4REPL_WITH_POOL
+void Loader::worker(Loader* self, const int* wave, int count, std::atomic<int>* next,
+                    V4FrontContext* ctx) {
+  for (;;) {
+    int k = next->fetch_add(1, std::memory_order_relaxed);
+    if (k >= count) {
+      return;
+    }
+    self->compile_item(&self->items_[wave[k]], ctx);
+  }
+}
+#endif
+
+/*
+ * Give workers 1..threads-1 their own copy of the compiler's name table
+ * (worker 0 is the calling thread and uses the real one). Names are
+ * copied in registration order, so later definitions still win.
+ */
+bool Loader::ensure_snapshots() {
+  if (snapshot_count_ > 0) {
+    return true;
+  }
+  V4FrontContext* main_ctx = hooks_->front_ctx;
+  int words = v4front_context_get_word_count(main_ctx);
+  for (int t = 1; t < threads_; t++) {
+    V4FrontContext* snap = v4front_context_create();
+    if (!snap) {
+      return false;
+    }
+    snapshots_[snapshot_count_++] = snap;
+    for (int w = 0; w < words; w++) {
+      const char* name = v4front_context_get_word_name(main_ctx, w);
+      if (v4front_context_register_word(snap, name, v4front_context_find_word(main_ctx, name)) !=
+          0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Copy the names a wave just registered into every snapshot
+bool Loader::update_snapshots(const int* wave, int count) {
+  V4FrontContext* main_ctx = hooks_->front_ctx;
+  for (int k = 0; k < count; k++) {
+    const Item& item = items_[wave[k]];
+    for (int m = 0; m < item.names_count; m++) {
+      const char* name = name_at(names_[item.names_first + m]);
+      if (!name) {
+        return false;
+      }
+      int wid = v4front_context_find_word(main_ctx, name);
+      for (int t = 0; t < snapshot_count_; t++) {
+        if (v4front_context_register_word(snapshots_[t], name, wid) != 0) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void Loader::destroy_snapshots() {
+  for (int t = 0; t < snapshot_count_; t++) {
+    v4front_context_destroy(snapshots_[t]);
+  }
+  snapshot_count_ = 0;
+}
+
+v4_err Loader::compile_wave(const int* wave, int count) {
+#if V4REPL_WITH_POOL
+  if (threads_ > 1 && count > 1) {
+    if (!ensure_snapshots()) {
+      return -1;
+    }
+    int helpers = (count < threads_ ? count : threads_) - 1;
+    std::atomic<int> next(0);
+    std::thread pool[MAX_THREADS];
+    for (int t = 0; t < helpers; t++) {
+      pool[t] = std::thread(worker, this, wave, count, &next, snapshots_[t]);
+    }
+    worker(this, wave, count, &next, hooks_->front_ctx);
+    for (int t = 0; t < helpers; t++) {
+      pool[t].join();
+    }
+    return 0;
+  }
+#endif
+  for (int k = 0; k < count; k++) {
+    compile_item(&items_[wave[k]], hooks_->front_ctx);
+  }
+  return 0;
+}
+
+/*
+ * Compile and register items [run_begin_, end), wave by wave. Within a
+ * wave, definitions are registered in source order up to the first one
+ * that failed to compile.
+ */
+v4_err Loader::flush(int end) {
+  int max_wave = -1;
+  for (int n = run_begin_; n < end; n++) {
+    if (items_[n].wave > max_wave) {
+      max_wave = items_[n].wave;
+    }
+  }
+
+  v4_err result = 0;
+  int* wave = nullptr;
+  if (max_wave >= 0) {
+    wave = (int*) malloc((size_t) (end - run_begin_) * sizeof(int));
+    if (!wave) {
+      result = -1;
+    }
+  }
+
+  for (int w = 0; w <= max_wave && result == 0; w++) {
+    int count = 0;
+    for (int n = run_begin_; n < end; n++) {
+      if (items_[n].wave == w) {
+        wave[count++] = n;
+      }
+    }
+
+    result = compile_wave(wave, count);
+    for (int k = 0; k < count && result == 0; k++) {
+      Item* item = &items_[wave[k]];
+      if (item->err != 0) {
+        // Positions are relative to the chunk; make them source positions
+        V4FrontError error = item->error;
+        if (error.line <= 1) {
+          error.column += (int) item->column;
+        }
+        error.line = (int) item->line + (error.line > 1 ? error.line - 1 : 0);
+        error.position += (int) item->start;
+        hooks_->compile_error(hooks_->user, &error, source_);
+        result = item->err;
+        break;
+      }
+      V4FrontBuf buf = item->buf;
+      memset(&item->buf, 0, sizeof(item->buf));
+      result = hooks_->define(hooks_->user, &buf);
+    }
+
+    if (result == 0 && snapshot_count_ > 0 && w < max_wave && !update_snapshots(wave, count)) {
+      result = -1;
+    }
+  }
+
+  free(wave);
+  v4repl_index_clear(&defined_);
+  v4repl_index_clear(&referenced_);
+  destroy_snapshots();
+  run_begin_ = end;
+  return result;
+}
+
+v4_err Loader::load(int threads) {
+  threads_ = threads;
+  if (!split()) {
+    return -1;
+  }
+
+  for (int n = 0; n < item_count_; n++) {
+    if (hooks_->defer) {
+      int taken = hooks_->defer(hooks_->user, text_ + items_[n].start);
+      if (taken < 0) {
+        return -1;
+      }
+      if (taken > 0) {
+        continue;
+      }
+    }
+    if (!classify(n)) {
+      return -1;
+    }
+    const Item& item = items_[n];
+    if (!item.code) {
+      continue;
+    }
+    // Top-level code sees everything defined before it
+    v4_err err = flush(n);
+    if (err == 0) {
+      err = hooks_->run(hooks_->user, text_ + item.start, item.line);
+    }
+    if (err != 0) {
+      return err;
+    }
+    run_begin_ = n + 1;
+  }
+  return flush(item_count_);
+}
+
+}  // namespace
+
+v4_err v4repl_batch_load(const char* source, int threads, const V4ReplBatchHooks* hooks) {
+  if (!source || !hooks || !hooks->front_ctx || !hooks->define || !hooks->run ||
+      !hooks->compile_error) {
+    return -1;
+  }
+
+#if V4REPL_WITH_POOL
+  if (threads <= 0) {
+    threads = (int) std::thread::hardware_concurrency();
+  }
+#endif
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > MAX_THREADS) {
+    threads = MAX_THREADS;
+  }
+
+  Loader* loader = new (std::nothrow) Loader(source, hooks);
+  if (!loader) {
+    return -1;
+  }
+  v4_err err = loader->load(threads);
+  delete loader;
+  return err;
+}
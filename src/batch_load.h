@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * Batch loader
+ *
+ * Splits a source text into complete chunks (see chunk_lexer.hpp).
+ * Consecutive chunks that hold only colon definitions form a run that
+ * is compiled in dependency waves: a definition that refers to (or
+ * redefines) a name defined earlier in the run goes into a later wave
+ * than that definition; everything in one wave is compiled at once on
+ * worker threads, each against its own copy of the compiler's name
+ * table. Compiled definitions are handed back on the calling thread,
+ * wave by wave and in source order within a wave, for registration.
+ *
+ * Any other chunk (top-level code) ends the run and is compiled and
+ * executed on its own, after everything before it.
+ *
+ * Used by v4_repl_load_source().
+ */
+
+#include <stddef.h>
+
+#include "v4/vm_api.h"
+#include "v4front/compile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct V4ReplBatchHooks {
+  /* Names visible to the source; only read while workers compile */
+  V4FrontContext* front_ctx;
+  void* user;
+
+  /* Register the definitions in buf; ownership of buf passes to the hook */
+  v4_err (*define)(void* user, V4FrontBuf* buf);
+
+  /* Compile and execute a chunk that is not only definitions */
+  v4_err (*run)(void* user, const char* code, unsigned long line);
+
+  /* A definition failed to compile; error positions refer to the whole source */
+  void (*compile_error)(void* user, const V4FrontError* error, const char* source);
+
+  /* Optional: take a chunk instead of compiling it (1 = taken, 0 = compile, -1 = OOM) */
+  int (*defer)(void* user, const char* code);
+} V4ReplBatchHooks;
+
+/**
+ * @brief Load a NUL-terminated source text
+ *
+ * Stops at the first error. Definitions in earlier waves than the
+ * failing one (which do not depend on it) may already be registered,
+ * even if they come later in the source.
+ *
+ * @param source  Forth source
+ * @param threads Compile threads (0 = one per hardware thread); 1, or a
+ *                build without V4REPL_WITH_POOL, compiles on the caller
+ * @param hooks   Registration and reporting callbacks
+ * @return 0 on success, or the first error code
+ */
+v4_err v4repl_batch_load(const char* source, int threads, const V4ReplBatchHooks* hooks);
+
+#ifdef __cplusplus
+}
+#endif
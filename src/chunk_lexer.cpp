@@ -0,0 +1,95 @@
+#include "chunk_lexer.hpp"
+
+#include <cstring>
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Case-insensitive match of a token against an uppercase keyword
+static bool token_is(const char* tok, size_t len, const char* kw) {
+  size_t i = 0;
+  for (; i < len && kw[i]; i++) {
+    char c = tok[i];
+    if (c >= 'a' && c <= 'z') {
+      c = (char) (c - 'a' + 'A');
+    }
+    if (c != kw[i]) {
+      return false;
+    }
+  }
+  return i == len && kw[i] == '\0';
+}
+
+static bool is_opener(const char* tok, size_t len) {
+  return token_is(tok, len, "IF") || token_is(tok, len, "DO") || token_is(tok, len, "?DO") ||
+         token_is(tok, len, "BEGIN") || token_is(tok, len, "CASE");
+}
+
+static bool is_closer(const char* tok, size_t len) {
+  return token_is(tok, len, "THEN") || token_is(tok, len, "LOOP") ||
+         token_is(tok, len, "+LOOP") || token_is(tok, len, "UNTIL") ||
+         token_is(tok, len, "AGAIN") || token_is(tok, len, "REPEAT") ||
+         token_is(tok, len, "ENDCASE");
+}
+
+size_t ChunkLexer::scan(const char* text, size_t from, size_t to) {
+  size_t commit = 0;
+  size_t i = from;
+  while (i < to) {
+    if (in_comment || in_string) {
+      char close = in_comment ? ')' : '"';
+      const char* end = (const char*) memchr(text + i, close, to - i);
+      if (!end) {
+        i = to;
+        break;
+      }
+      i = (size_t) (end - text) + 1;
+      in_comment = false;
+      in_string = false;
+      continue;
+    }
+
+    if (is_space(text[i])) {
+      i++;
+      continue;
+    }
+
+    const char* tok = text + i;
+    size_t len = 0;
+    while (i + len < to && !is_space(tok[len])) {
+      len++;
+    }
+    i += len;
+
+    if (len == 1 && tok[0] == '\\') {
+      // Line comment: skip to the newline
+      while (i < to && text[i] != '\n') {
+        i++;
+      }
+    } else if (len == 1 && tok[0] == '(') {
+      in_comment = true;
+    } else if (len >= 2 && tok[len - 1] == '"') {
+      in_string = true;  // ." S" ABORT" etc.; the text follows the space
+    } else if (len == 1 && tok[0] == ':') {
+      in_def = true;
+    } else if (len == 1 && tok[0] == ';') {
+      in_def = false;
+      if (nesting == 0) {
+        commit = i;
+      }
+    } else if (!in_def) {
+      if (is_opener(tok, len)) {
+        nesting++;
+      } else if (is_closer(tok, len) && nesting > 0) {
+        nesting--;
+      }
+    }
+  }
+
+  // The line ended outside any definition, comment or structure
+  if (!in_def && !in_comment && !in_string && nesting == 0) {
+    commit = to;
+  }
+  return commit;
+}
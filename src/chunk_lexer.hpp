@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Finds where complete, compilable chunks of Forth source end
+ *
+ * Tracks just enough Forth syntax across lines: colon definitions,
+ * ( ) comments, \ comments, string words ending in a quote (." S"
+ * ABORT") and control structures in top-level code (IF/THEN, DO/LOOP,
+ * BEGIN/UNTIL and friends). A chunk ends after the ; that closes a
+ * definition, or at the end of a line outside any of these.
+ *
+ * Shared by libv4repl (batch loads) and the v4-repl executable (PASTE
+ * mode, .include).
+ */
+struct ChunkLexer {
+  bool in_def;
+  bool in_comment;  // Inside ( ... )
+  bool in_string;   // Inside ." ... "
+  int nesting;      // Open control structures in top-level code
+
+  ChunkLexer() {
+    reset();
+  }
+
+  void reset() {
+    in_def = false;
+    in_comment = false;
+    in_string = false;
+    nesting = 0;
+  }
+
+  /**
+   * @brief Scan text[from, to), which must end at a line end
+   *
+   * @return Offset just past the last chunk end in the range, or 0 if none
+   */
+  size_t scan(const char* text, size_t from, size_t to);
+};
@@ -0,0 +1,132 @@
+#include "code_map.hpp"
+
+#include <v4/internal/vm.h>  // For Word structure definition
+#include <v4/opcodes.hpp>
+
+#include <cstdlib>
+
+// CALL is followed by a 4-byte little-endian word ID
+static const uint32_t CALL_OPERAND_SIZE = 4;
+
+CodeMap::CodeMap() : ranges_(nullptr), count_(0), capacity_(0), top_() {
+  top_.wid = -1;
+  top_.name = "<top-level>";
+}
+
+CodeMap::~CodeMap() {
+  free(ranges_);
+}
+
+static int compare_start(const void* a, const void* b) {
+  uint32_t x = ((const CodeMap::Range*) a)->start;
+  uint32_t y = ((const CodeMap::Range*) b)->start;
+  return (x > y) - (x < y);
+}
+
+bool CodeMap::rebuild(struct Vm* vm, const V4ReplDefLog& defs) {
+  count_ = 0;
+  if (defs.count > capacity_) {
+    Range* new_ranges = (Range*) realloc(ranges_, defs.count * sizeof(Range));
+    if (!new_ranges) {
+      return false;
+    }
+    ranges_ = new_ranges;
+    capacity_ = defs.count;
+  }
+
+  for (int i = 0; i < defs.count; i++) {
+    Word* word = vm_get_word(vm, defs.defs[i].wid);
+    if (!word || !word->code || word->code_len == 0) {
+      continue;
+    }
+
+    Range* r = &ranges_[count_++];
+    r->wid = defs.defs[i].wid;
+    r->start = (uint32_t) (uintptr_t) word->code;
+    r->len = (uint32_t) word->code_len;
+    r->code = word->code;
+    r->name = defs.defs[i].name;
+  }
+
+  qsort(ranges_, count_, sizeof(Range), compare_start);
+  return true;
+}
+
+void CodeMap::set_top_level(const uint8_t* code, size_t len) {
+  top_.code = code;
+  top_.start = (uint32_t) (uintptr_t) code;
+  top_.len = code ? (uint32_t) len : 0;
+}
+
+const CodeMap::Range* CodeMap::find(uint32_t addr) const {
+  // Unsigned wrap-around keeps the containment test correct even if
+  // the range straddles 2^32
+  if (addr - top_.start < top_.len) {
+    return &top_;
+  }
+
+  // Last range starting at or below addr
+  int lo = 0;
+  int hi = count_;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (ranges_[mid].start <= addr) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo > 0 && addr - ranges_[lo - 1].start < ranges_[lo - 1].len) {
+    return &ranges_[lo - 1];
+  }
+  return nullptr;
+}
+
+int CodeMap::callee_at(const Range* caller, uint32_t ret_addr) {
+  // The return address points just past "CALL <wid>"
+  uint32_t offset = ret_addr - caller->start;
+  if (offset < 1 + CALL_OPERAND_SIZE) {
+    return -1;
+  }
+
+  const uint8_t* insn = caller->code + offset - (1 + CALL_OPERAND_SIZE);
+  if (insn[0] != static_cast<uint8_t>(v4::Op::CALL)) {
+    return -1;
+  }
+
+  uint32_t wid = (uint32_t) insn[1] | ((uint32_t) insn[2] << 8) | ((uint32_t) insn[3] << 16) |
+                 ((uint32_t) insn[4] << 24);
+  return (int) wid;
+}
+
+void CodeMap::describe(uint32_t addr, char* out, size_t out_size) const {
+  const Range* r = find(addr);
+  if (r) {
+    snprintf(out, out_size, "%s+0x%X", r->name, (unsigned int) (addr - r->start));
+  } else {
+    snprintf(out, out_size, "???");
+  }
+}
+
+void CodeMap::print_trace(FILE* out, const v4_i32* rs, int depth,
+                          const V4ReplWordIndex& words) const {
+  fprintf(out, "Backtrace (most recent call first):\n");
+
+  // Frame #0 is the word that was running: the callee of the innermost CALL
+  const char* running = top_.name;
+  if (depth > 0) {
+    const Range* caller = find((uint32_t) rs[depth - 1]);
+    int wid = caller ? callee_at(caller, (uint32_t) rs[depth - 1]) : -1;
+    running = (wid >= 0) ? v4repl_index_name(&words, wid) : nullptr;
+    if (!running) {
+      running = "???";
+    }
+  }
+  fprintf(out, "  #0  %s\n", running);
+
+  char where[96];
+  for (int i = depth - 1; i >= 0; i--) {
+    describe((uint32_t) rs[i], where, sizeof(where));
+    fprintf(out, "  #%-2d %s (0x%08X)\n", depth - i, where, (unsigned int) rs[i]);
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <v4/vm_api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "snapshot.h"
+#include "word_index.h"
+
+/**
+ * @brief Sorted interval table from code addresses to words
+ *
+ * Return-stack entries are the low 32 bits of bytecode addresses. The
+ * map holds the code range of every registered word (including words
+ * shadowed by a later redefinition, whose code is still called by older
+ * words), sorted by start address, so an address resolves to
+ * WORD+offset with a binary search. The bytecode of the line being
+ * executed can be added as a separate top-level range.
+ *
+ * Used by .rstack, the backtrace printed when execution fails, and the
+ * sampling profiler.
+ */
+class CodeMap {
+ public:
+  struct Range {
+    int wid;           // VM word ID, -1 for top-level line code
+    uint32_t start;    // Low 32 bits of the code address
+    uint32_t len;
+    const uint8_t* code;
+    const char* name;  // Borrowed from the definition log
+  };
+
+  CodeMap();
+  ~CodeMap();
+
+  CodeMap(const CodeMap&) = delete;
+  CodeMap& operator=(const CodeMap&) = delete;
+
+  /**
+   * @brief Rebuild the table from every registration in @p defs
+   *
+   * Code pointers are taken from the VM, which is what return addresses
+   * refer to. Names stay borrowed from @p defs until the next rebuild.
+   *
+   * @return false on allocation failure (the map is then empty)
+   */
+  bool rebuild(struct Vm* vm, const V4ReplDefLog& defs);
+
+  /**
+   * @brief Set (or with nullptr, clear) the top-level code range
+   */
+  void set_top_level(const uint8_t* code, size_t len);
+
+  /**
+   * @brief Range containing @p addr, or nullptr
+   */
+  const Range* find(uint32_t addr) const;
+
+  /**
+   * @brief Word ID called by the CALL that ends just before @p ret_addr
+   *
+   * @param caller Range containing @p ret_addr
+   * @return Callee word ID, or -1 if no CALL precedes the address
+   */
+  static int callee_at(const Range* caller, uint32_t ret_addr);
+
+  /**
+   * @brief Format @p addr as "NAME+0xOFF" (or "<top-level>+0xOFF", "???")
+   */
+  void describe(uint32_t addr, char* out, size_t out_size) const;
+
+  /**
+   * @brief Print a call trace for a return stack, innermost frame first
+   *
+   * @param out Destination stream
+   * @param rs Return stack copy, bottom first (as from vm_rs_copy_to_array)
+   * @param depth Number of entries in @p rs
+   * @param words Index used to name the innermost callee
+   */
+  void print_trace(FILE* out, const v4_i32* rs, int depth, const V4ReplWordIndex& words) const;
+
+  int size() const {
+    return count_;
+  }
+
+ private:
+  Range* ranges_;
+  int count_;
+  int capacity_;
+  Range top_;
+};
@@ -0,0 +1,57 @@
+#include "code_segment.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+CodeSegment::CodeSegment() : base_(nullptr), used_(0), capacity_(0) {}
+
+CodeSegment::~CodeSegment() {
+  free(base_);
+}
+
+void CodeSegment::clear() {
+  free(base_);
+  base_ = nullptr;
+  used_ = 0;
+  capacity_ = 0;
+}
+
+const uint8_t* CodeSegment::append(const uint8_t* code, uint32_t len) {
+  if (len > free_space()) {
+    return nullptr;
+  }
+  uint8_t* dst = base_ + used_;
+  memcpy(dst, code, len);
+  used_ += len;
+  return dst;
+}
+
+bool CodeSegment::repack(Item* items, int count, size_t extra) {
+  size_t live = 0;
+  for (int i = 0; i < count; ++i) {
+    live += items[i].len;
+  }
+
+  // Double what is needed, so a run of new definitions repacks rarely
+  size_t new_cap = MIN_CAPACITY;
+  while (new_cap < 2 * (live + extra)) {
+    new_cap *= 2;
+  }
+  uint8_t* block = static_cast<uint8_t*>(malloc(new_cap));
+  if (!block) {
+    return false;
+  }
+
+  size_t offset = 0;
+  for (int i = 0; i < count; ++i) {
+    memcpy(block + offset, items[i].code, items[i].len);
+    items[i].code = block + offset;
+    offset += items[i].len;
+  }
+
+  free(base_);
+  base_ = block;
+  used_ = offset;
+  capacity_ = new_cap;
+  return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief One contiguous block holding the bytecode of REPL-defined words
+ *
+ * New words are appended back to back instead of each line's compiler
+ * output staying in its own allocation, so words defined together (and
+ * the words they call) share cache lines and pages. Retired words leave
+ * holes that repack() closes by copying the live words, in a caller
+ * supplied order, into a fresh block; the caller then points the VM and
+ * its own tables at the new addresses. Bytecode never moves otherwise.
+ */
+class CodeSegment {
+ public:
+  // Smallest block allocated by repack()
+  static const size_t MIN_CAPACITY = 4096;
+
+  /**
+   * @brief Bytecode to keep across a repack()
+   */
+  struct Item {
+    int wid;              // VM word ID (for the caller)
+    const uint8_t* code;  // In: current location; out: location in the new block
+    uint32_t len;
+  };
+
+  CodeSegment();
+  ~CodeSegment();
+
+  CodeSegment(const CodeSegment&) = delete;
+  CodeSegment& operator=(const CodeSegment&) = delete;
+
+  /**
+   * @brief Copy @p len bytes to the end of the segment
+   *
+   * @return Address of the copy, or nullptr if free_space() is too small
+   */
+  const uint8_t* append(const uint8_t* code, uint32_t len);
+
+  /**
+   * @brief Replace the block with one holding only @p items, in order
+   *
+   * The new block has room for at least @p extra more bytes. The old
+   * block is freed, so every pointer into it must be updated from
+   * @p items afterwards.
+   *
+   * @return false on allocation failure (nothing changed)
+   */
+  bool repack(Item* items, int count, size_t extra);
+
+  /**
+   * @brief Whether @p p points into the current block
+   */
+  bool contains(const uint8_t* p) const {
+    return base_ && p >= base_ && p < base_ + capacity_;
+  }
+
+  size_t used() const {
+    return used_;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  size_t free_space() const {
+    return capacity_ - used_;
+  }
+
+  /**
+   * @brief Free the block (after a dictionary reset)
+   */
+  void clear();
+
+ private:
+  uint8_t* base_;
+  size_t used_;
+  size_t capacity_;
+};
@@ -0,0 +1,449 @@
+#include "disasm.hpp"
+
+#include <v4/internal/vm.h>  // For Word structure definition
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+// Opcode names and values, straight from the engine
+struct OpName {
+  const char* name;
+  uint8_t value;
+};
+
+static const OpName OP_NAMES[] = {
+#define OP(name, value, ...) {#name, static_cast<uint8_t>(value)},
+#include <v4/opcodes.def>
+#undef OP
+};
+
+// Operand size, stack effect and control flow, by opcode name
+struct OpFacts {
+  const char* name;
+  uint8_t imm_size;
+  int8_t pops;
+  int8_t pushes;
+  uint8_t flags;
+};
+
+static const uint8_t JUMP = Disassembler::OPF_JUMP;
+static const uint8_t COND = Disassembler::OPF_JUMP | Disassembler::OPF_COND;
+static const uint8_t CALL = Disassembler::OPF_CALL;
+static const uint8_t RET = Disassembler::OPF_RET;
+static const uint8_t NOEFFECT = Disassembler::OPF_NOEFFECT;
+static const uint8_t UNSIGNED = Disassembler::OPF_UNSIGNED;
+static const uint8_t UNKNOWN = Disassembler::OPF_UNKNOWN;
+
+static const OpFacts OP_FACTS[] = {
+    // Literals
+    {"LIT", 4, 0, 1, 0},
+    {"LIT0", 0, 0, 1, 0},
+    {"LIT1", 0, 0, 1, 0},
+    {"LITN1", 0, 0, 1, 0},
+    {"LIT_U8", 1, 0, 1, UNSIGNED},
+    {"LIT_I8", 1, 0, 1, 0},
+    {"LIT_I16", 2, 0, 1, 0},
+
+    // Stack
+    {"DUP", 0, 1, 2, 0},
+    {"DROP", 0, 1, 0, 0},
+    {"SWAP", 0, 2, 2, 0},
+    {"OVER", 0, 2, 3, 0},
+    {"ROT", 0, 3, 3, 0},
+    {"NIP", 0, 2, 1, 0},
+    {"TUCK", 0, 2, 3, 0},
+    {"SELECT", 0, 3, 1, 0},
+
+    // Arithmetic, logic and comparison
+    {"ADD", 0, 2, 1, 0},
+    {"SUB", 0, 2, 1, 0},
+    {"MUL", 0, 2, 1, 0},
+    {"DIV", 0, 2, 1, 0},
+    {"MOD", 0, 2, 1, 0},
+    {"DIVU", 0, 2, 1, 0},
+    {"MODU", 0, 2, 1, 0},
+    {"AND", 0, 2, 1, 0},
+    {"OR", 0, 2, 1, 0},
+    {"XOR", 0, 2, 1, 0},
+    {"SHL", 0, 2, 1, 0},
+    {"SHR", 0, 2, 1, 0},
+    {"SAR", 0, 2, 1, 0},
+    {"EQ", 0, 2, 1, 0},
+    {"NE", 0, 2, 1, 0},
+    {"LT", 0, 2, 1, 0},
+    {"LE", 0, 2, 1, 0},
+    {"GT", 0, 2, 1, 0},
+    {"GE", 0, 2, 1, 0},
+    {"LTU", 0, 2, 1, 0},
+    {"LEU", 0, 2, 1, 0},
+    {"GTU", 0, 2, 1, 0},
+    {"GEU", 0, 2, 1, 0},
+    {"INVERT", 0, 1, 1, 0},
+    {"NEGATE", 0, 1, 1, 0},
+    {"INC", 0, 1, 1, 0},
+    {"DEC", 0, 1, 1, 0},
+    {"ABS", 0, 1, 1, 0},
+
+    // Memory
+    {"LOAD", 0, 1, 1, 0},
+    {"LOAD8U", 0, 1, 1, 0},
+    {"LOAD16U", 0, 1, 1, 0},
+    {"LOAD8S", 0, 1, 1, 0},
+    {"LOAD16S", 0, 1, 1, 0},
+    {"STORE", 0, 2, 0, 0},
+    {"STORE8", 0, 2, 0, 0},
+    {"STORE16", 0, 2, 0, 0},
+
+    // Return stack
+    {"TOR", 0, 1, 0, 0},
+    {"FROMR", 0, 0, 1, 0},
+    {"RFETCH", 0, 0, 1, 0},
+
+    // Control flow
+    {"JMP", 2, 0, 0, JUMP},
+    {"JZ", 2, 1, 0, COND},
+    {"JNZ", 2, 1, 0, COND},
+    {"CALL", 4, 0, 0, CALL},
+    {"RET", 0, 0, 0, RET},
+
+    // System calls take a 1-byte ID; their stack effect depends on it
+    {"SYS", 1, 0, 0, NOEFFECT | UNSIGNED},
+};
+
+struct OpTable {
+  Disassembler::OpInfo ops[256];
+};
+
+static OpTable build_op_table() {
+  OpTable table;
+  memset(&table, 0, sizeof(table));
+  for (Disassembler::OpInfo& info : table.ops) {
+    info.flags = NOEFFECT | UNKNOWN;  // Until the facts table says otherwise
+  }
+  for (const OpName& op : OP_NAMES) {
+    Disassembler::OpInfo* info = &table.ops[op.value];
+    info->name = op.name;
+
+    for (const OpFacts& facts : OP_FACTS) {
+      if (strcmp(facts.name, op.name) == 0) {
+        info->imm_size = facts.imm_size;
+        info->pops = facts.pops;
+        info->pushes = facts.pushes;
+        info->flags = facts.flags;
+        break;
+      }
+    }
+  }
+  return table;
+}
+
+const Disassembler::OpInfo* Disassembler::op_info(uint8_t op) {
+  static const OpTable table = build_op_table();
+  return &table.ops[op];
+}
+
+bool Disassembler::decode(const uint8_t* code, uint32_t len, uint32_t offset, Insn* out) {
+  if (offset >= len) {
+    return false;
+  }
+
+  out->offset = offset;
+  out->op = code[offset];
+  out->info = op_info(out->op);
+  out->size = 1 + out->info->imm_size;
+  out->imm = 0;
+  if (out->size > len - offset) {
+    return false;
+  }
+
+  // Operands are little-endian
+  const uint8_t* imm = code + offset + 1;
+  bool is_unsigned = (out->info->flags & OPF_UNSIGNED) != 0;
+  switch (out->info->imm_size) {
+    case 1:
+      out->imm = is_unsigned ? imm[0] : (int8_t) imm[0];
+      break;
+    case 2:
+      out->imm = is_unsigned ? (imm[0] | (imm[1] << 8)) : (int16_t) (imm[0] | (imm[1] << 8));
+      break;
+    case 4:
+      out->imm = (int32_t) ((uint32_t) imm[0] | ((uint32_t) imm[1] << 8) |
+                            ((uint32_t) imm[2] << 16) | ((uint32_t) imm[3] << 24));
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+// Mnemonic padded to a column, so operands line up
+static void out_mnemonic(V4ReplOutBuf* out, const char* name) {
+  v4repl_out_str(out, name);
+  for (size_t n = strlen(name); n < 9; n++) {
+    v4repl_out_char(out, ' ');
+  }
+}
+
+void Disassembler::print_listing(V4ReplOutBuf* out, const uint8_t* code, uint32_t len) const {
+  Insn insn;
+  uint32_t offset = 0;
+  while (offset < len) {
+    v4repl_out_str(out, "  ");
+    v4repl_out_hex(out, offset, 4);
+    v4repl_out_str(out, "  ");
+
+    if (!decode(code, len, offset, &insn)) {
+      // Truncated operand: show the remaining bytes raw
+      for (uint32_t i = offset; i < len; i++) {
+        v4repl_out_hex(out, code[i], 2);
+        v4repl_out_char(out, ' ');
+      }
+      v4repl_out_str(out, " <truncated>\n");
+      v4repl_out_flush(out);
+      return;
+    }
+
+    for (uint32_t i = 0; i < 5; i++) {
+      if (i < insn.size) {
+        v4repl_out_hex(out, code[offset + i], 2);
+        v4repl_out_char(out, ' ');
+      } else {
+        v4repl_out_str(out, "   ");
+      }
+    }
+    v4repl_out_char(out, ' ');
+
+    const OpInfo* info = insn.info;
+    if (!info->name) {
+      v4repl_out_str(out, "??? (0x");
+      v4repl_out_hex(out, insn.op, 2);
+      v4repl_out_char(out, ')');
+    } else if (info->flags & OPF_CALL) {
+      const char* callee = v4repl_index_name(&words_, insn.imm);
+      out_mnemonic(out, info->name);
+      v4repl_out_str(out, callee ? callee : "<unknown>");
+    } else if (info->flags & OPF_JUMP) {
+      out_mnemonic(out, info->name);
+      v4repl_out_str(out, "-> ");
+      v4repl_out_hex(out, offset + insn.size + insn.imm, 4);
+    } else if (info->imm_size > 0) {
+      out_mnemonic(out, info->name);
+      v4repl_out_i32(out, insn.imm);
+    } else {
+      v4repl_out_str(out, info->name);
+    }
+    v4repl_out_char(out, '\n');
+    v4repl_out_flush(out);
+    offset += insn.size;
+  }
+}
+
+Disassembler::Disassembler(struct Vm* vm, const V4ReplWordIndex& words)
+    : vm_(vm), words_(words), facts_(nullptr), state_(nullptr), capacity_(0), path_len_(0) {}
+
+Disassembler::~Disassembler() {
+  free(facts_);
+  free(state_);
+}
+
+bool Disassembler::ensure(int wid) {
+  if (wid < 0) {
+    return false;
+  }
+  if (wid < capacity_) {
+    return true;
+  }
+
+  int new_cap = capacity_ ? capacity_ : 64;
+  while (new_cap <= wid) {
+    new_cap *= 2;
+  }
+  WordFacts* new_facts = (WordFacts*) realloc(facts_, new_cap * sizeof(WordFacts));
+  if (!new_facts) {
+    return false;
+  }
+  facts_ = new_facts;
+  uint8_t* new_state = (uint8_t*) realloc(state_, new_cap);
+  if (!new_state) {
+    return false;
+  }
+  state_ = new_state;
+  memset(state_ + capacity_, 0, new_cap - capacity_);
+  capacity_ = new_cap;
+  return true;
+}
+
+// Analysis states; ON_CYCLE is or-ed in while a word is in progress
+static const uint8_t STATE_ACTIVE = 1;
+static const uint8_t STATE_DONE = 2;
+static const uint8_t STATE_ON_CYCLE = 4;
+
+const Disassembler::WordFacts* Disassembler::analyze(int wid) {
+  if (wid >= 0 && wid < capacity_ && (state_[wid] & STATE_DONE)) {
+    return &facts_[wid];
+  }
+
+  // Check the word exists before sizing tables by its ID
+  Word* word = vm_get_word(vm_, wid);
+  if (!word || !word->code || word->code_len == 0 || path_len_ >= MAX_ANALYSIS_DEPTH ||
+      !ensure(wid)) {
+    return nullptr;
+  }
+  const uint8_t* code = word->code;
+  uint32_t len = (uint32_t) word->code_len;
+
+  WordFacts f;
+  memset(&f, 0, sizeof(f));
+  f.leaf = true;
+
+  state_[wid] = STATE_ACTIVE;
+  path_[path_len_++] = wid;
+
+  // Linear sweep: count instructions and analyze callees first
+  Insn insn;
+  for (uint32_t offset = 0; decode(code, len, offset, &insn); offset += insn.size) {
+    f.insn_count++;
+    if (!(insn.info->flags & OPF_CALL)) {
+      continue;
+    }
+
+    f.call_count++;
+    f.leaf = false;
+    int callee = insn.imm;
+    if (callee >= 0 && callee < capacity_ && (state_[callee] & STATE_ACTIVE)) {
+      // Back edge: every word from the callee down to here is on a cycle
+      for (int i = path_len_ - 1; i >= 0; i--) {
+        state_[path_[i]] |= STATE_ON_CYCLE;
+        if (path_[i] == callee) {
+          break;
+        }
+      }
+      f.call_depth = -1;
+      continue;
+    }
+
+    const WordFacts* cf = analyze(callee);
+    if (!cf || cf->call_depth < 0) {
+      f.call_depth = -1;  // Unknown or unbounded below this call
+    } else if (f.call_depth >= 0 && cf->call_depth + 1 > f.call_depth) {
+      f.call_depth = cf->call_depth + 1;
+    }
+  }
+
+  path_len_--;
+  f.recursive = (state_[wid] & STATE_ON_CYCLE) != 0;
+  if (f.recursive) {
+    f.call_depth = -1;
+  }
+
+  stack_effect(code, len, &f);
+
+  facts_[wid] = f;
+  state_[wid] = STATE_DONE;
+  return &facts_[wid];
+}
+
+// Queue a successor; paths that meet with different depths are unbalanced
+static bool reach(int* depth_at, uint32_t* work, int* pending, uint32_t len, uint32_t target,
+                  int depth) {
+  if (target >= len) {
+    return false;
+  }
+  if (depth_at[target] == INT_MIN) {
+    depth_at[target] = depth;
+    work[(*pending)++] = target;
+    return true;
+  }
+  return depth_at[target] == depth;
+}
+
+// Abstract interpretation of the data stack depth over every path
+void Disassembler::stack_effect(const uint8_t* code, uint32_t len, WordFacts* f) {
+  f->effect_known = false;
+
+  // Depth on entry to each instruction (INT_MIN = not reached yet)
+  int* depth_at = (int*) malloc(len * sizeof(int));
+  uint32_t* work = (uint32_t*) malloc(len * sizeof(uint32_t));
+  if (!depth_at || !work) {
+    free(depth_at);
+    free(work);
+    return;
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    depth_at[i] = INT_MIN;
+  }
+
+  int lowest = 0;
+  int highest = 0;
+  int exit_depth = INT_MIN;
+  bool ok = true;
+  int pending = 0;
+
+  depth_at[0] = 0;
+  work[pending++] = 0;
+
+  while (ok && pending > 0) {
+    uint32_t offset = work[--pending];
+    int depth = depth_at[offset];
+
+    Insn insn;
+    if (!decode(code, len, offset, &insn)) {
+      ok = false;
+      break;
+    }
+    const OpInfo* info = insn.info;
+
+    int pops = info->pops;
+    int pushes = info->pushes;
+    if (info->flags & OPF_CALL) {
+      int callee = insn.imm;
+      if (callee < 0 || callee >= capacity_ || !(state_[callee] & STATE_DONE) ||
+          !facts_[callee].effect_known) {
+        ok = false;
+        break;
+      }
+      const WordFacts* cf = &facts_[callee];
+      if (depth + cf->peak > highest) {
+        highest = depth + cf->peak;
+      }
+      pops = cf->inputs;
+      pushes = cf->outputs;
+    } else if (!info->name || (info->flags & OPF_NOEFFECT)) {
+      ok = false;
+      break;
+    }
+
+    depth -= pops;
+    if (depth < lowest) {
+      lowest = depth;
+    }
+    depth += pushes;
+    if (depth > highest) {
+      highest = depth;
+    }
+
+    uint32_t next = offset + insn.size;
+    if (info->flags & OPF_RET) {
+      if (exit_depth != INT_MIN && exit_depth != depth) {
+        ok = false;  // Paths return with different depths
+      }
+      exit_depth = depth;
+    } else if (info->flags & OPF_JUMP) {
+      ok = reach(depth_at, work, &pending, len, next + insn.imm, depth) &&
+           (!(info->flags & OPF_COND) || reach(depth_at, work, &pending, len, next, depth));
+    } else {
+      ok = reach(depth_at, work, &pending, len, next, depth);
+    }
+  }
+
+  if (ok && exit_depth != INT_MIN) {
+    f->effect_known = true;
+    f->inputs = -lowest;
+    f->outputs = exit_depth - lowest;
+    f->peak = highest;
+  }
+
+  free(depth_at);
+  free(work);
+}
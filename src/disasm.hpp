@@ -0,0 +1,113 @@
+#pragma once
+
+#include <v4/vm_api.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "out_buf.h"
+#include "word_index.h"
+
+/**
+ * @brief Bytecode disassembler and static word analysis
+ *
+ * Opcode names come from V4's opcodes.def, so new opcodes are listed
+ * by name as soon as the engine defines them. Operand sizes and stack
+ * effects are kept in a table keyed by name; an opcode missing from it
+ * decodes without operands, is flagged OPF_UNKNOWN and makes stack
+ * effects "unknown" rather than wrong.
+ *
+ * Analysis results are memoized per word ID for the lifetime of the
+ * object, so create one per query (the dictionary may change between).
+ */
+class Disassembler {
+ public:
+  // Opcode flags
+  enum : uint8_t {
+    OPF_JUMP = 0x01,     // Operand is a signed 16-bit offset from the next instruction
+    OPF_COND = 0x02,     // Jump is conditional (falls through)
+    OPF_CALL = 0x04,     // Operand is a 32-bit word ID
+    OPF_RET = 0x08,      // Ends the word
+    OPF_NOEFFECT = 0x10,  // Stack effect not known statically
+    OPF_UNSIGNED = 0x20,  // Operand is zero-extended
+    OPF_UNKNOWN = 0x40    // No facts entry: operand size unknown, later offsets unreliable
+  };
+
+  struct OpInfo {
+    const char* name;  // nullptr for undefined opcodes
+    uint8_t imm_size;  // Operand bytes after the opcode
+    int8_t pops;
+    int8_t pushes;
+    uint8_t flags;
+  };
+
+  struct Insn {
+    uint32_t offset;
+    uint32_t size;  // Opcode plus operand bytes
+    uint8_t op;
+    int32_t imm;    // Extended operand (0 if none)
+    const OpInfo* info;
+  };
+
+  /**
+   * @brief Static facts about one word
+   */
+  struct WordFacts {
+    int insn_count;
+    int call_count;
+    bool leaf;          // Calls no other word
+    bool recursive;     // Reaches itself through its calls
+    int call_depth;     // Longest static call chain below this word (-1 if recursive)
+    bool effect_known;  // inputs/outputs/peak are valid
+    int inputs;         // Cells consumed from the caller's stack
+    int outputs;        // Cells left in their place
+    int peak;           // Highest depth reached above the entry depth
+  };
+
+  Disassembler(struct Vm* vm, const V4ReplWordIndex& words);
+  ~Disassembler();
+
+  Disassembler(const Disassembler&) = delete;
+  Disassembler& operator=(const Disassembler&) = delete;
+
+  /**
+   * @brief Table entry for an opcode byte
+   */
+  static const OpInfo* op_info(uint8_t op);
+
+  /**
+   * @brief Decode the instruction at @p offset
+   *
+   * @return false if @p offset is past the end or the operand is truncated
+   */
+  static bool decode(const uint8_t* code, uint32_t len, uint32_t offset, Insn* out);
+
+  /**
+   * @brief Print one line per instruction, with jump targets and CALL names
+   */
+  void print_listing(V4ReplOutBuf* out, const uint8_t* code, uint32_t len) const;
+
+  /**
+   * @brief Facts for a word (nullptr if it has no bytecode)
+   *
+   * A CALL contributes its callee's stack effect, so callees are
+   * analyzed first; cycles mark every word on them as recursive.
+   */
+  const WordFacts* analyze(int wid);
+
+ private:
+  struct Vm* vm_;
+  const V4ReplWordIndex& words_;
+
+  WordFacts* facts_;
+  uint8_t* state_;  // See STATE_* in disasm.cpp
+  int capacity_;
+
+  // Words currently being analyzed, outermost first (bounds recursion)
+  static const int MAX_ANALYSIS_DEPTH = 256;
+  int path_[MAX_ANALYSIS_DEPTH];
+  int path_len_;
+
+  bool ensure(int wid);
+  void stack_effect(const uint8_t* code, uint32_t len, WordFacts* f);
+};
@@ -0,0 +1,43 @@
+#include "hex_dump.hpp"
+
+// Hex digits, uppercase to match v4repl_out_hex
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Table-driven and branch-light, so the inner loop compiles to straight-line code
+size_t HexDump::format_row(char* line, uint32_t addr, const uint8_t* bytes, int valid) {
+  char* p = line;
+  for (int shift = 28; shift >= 0; shift -= 4) {
+    *p++ = HEX_DIGITS[(addr >> shift) & 0xF];
+  }
+  *p++ = ' ';
+  *p++ = ' ';
+
+  char* ascii = p + ROW_BYTES * 3 + 4 + 1;
+  for (int i = 0; i < (int) ROW_BYTES; i++) {
+    uint8_t b = bytes[i];
+    bool ok = i < valid;
+    p[0] = ok ? HEX_DIGITS[b >> 4] : '?';
+    p[1] = ok ? HEX_DIGITS[b & 0xF] : '?';
+    p[2] = ' ';
+    p += 3;
+    if ((i & 3) == 3) {
+      *p++ = ' ';  // Group separator
+    }
+    ascii[i] = (ok && b >= 32 && b < 127) ? (char) b : '.';
+  }
+  *p++ = ' ';
+  p += ROW_BYTES;
+  *p++ = '\n';
+  return (size_t) (p - line);
+}
+
+uint32_t HexDump::row_span(uint32_t addr, uint32_t length, size_t mem_size) {
+  if (addr >= mem_size) {
+    return 0;
+  }
+  // Clamp before rounding, so lengths near UINT32_MAX cannot wrap to 0
+  if (length > mem_size - addr) {
+    length = (uint32_t) (mem_size - addr);
+  }
+  return (length + ROW_BYTES - 1) & ~(ROW_BYTES - 1);
+}
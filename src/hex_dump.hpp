@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Row formatting and range checks for .dump
+ *
+ * A row covers 16 bytes: address, hex bytes in groups of four, ASCII.
+ * Rows are fixed-width so a whole dump can be staged in one buffer.
+ */
+class HexDump {
+ public:
+  // Bytes per row, and the buffer size format_row() needs
+  static const uint32_t ROW_BYTES = 16;
+  static const size_t LINE_SIZE = 80;
+
+  /**
+   * @brief Format one row into @p line, ending in a newline
+   *
+   * Bytes at index >= @p valid are shown as "??"; non-printable bytes
+   * (and missing ones) as '.' in the ASCII column.
+   *
+   * @param line Output, at least LINE_SIZE bytes (not NUL-terminated)
+   * @param addr Address of the first byte
+   * @param bytes ROW_BYTES bytes, of which the first @p valid are shown
+   * @return Line length
+   */
+  static size_t format_row(char* line, uint32_t addr, const uint8_t* bytes, int valid);
+
+  /**
+   * @brief Bytes to show for a dump of @p length bytes at @p addr
+   *
+   * @p length is clamped to the end of memory, then rounded up to whole
+   * rows (the tail of the last row may lie past the end).
+   *
+   * @return Multiple of ROW_BYTES, 0 if @p addr is outside memory
+   */
+  static uint32_t row_span(uint32_t addr, uint32_t length, size_t mem_size);
+};
@@ -0,0 +1,533 @@
+#include "lazy_defs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LAZY_INITIAL_CAPACITY 16
+
+static int is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*
+ * Next token at *pos, skipping ( ) and \ comments. After a string word
+ * (." S" ABORT" ...) its text is skipped too. Returns NULL at the end.
+ */
+static const char* next_token(const char** pos, size_t* len) {
+  const char* p = *pos;
+  for (;;) {
+    while (*p && is_space(*p)) {
+      p++;
+    }
+    if (!*p) {
+      return NULL;
+    }
+    const char* tok = p;
+    while (*p && !is_space(*p)) {
+      p++;
+    }
+    size_t n = (size_t) (p - tok);
+
+    if (n == 1 && tok[0] == '\\') {
+      while (*p && *p != '\n') {
+        p++;
+      }
+      continue;
+    }
+    if (n == 1 && tok[0] == '(') {
+      while (*p && *p != ')') {
+        p++;
+      }
+      if (*p) {
+        p++;
+      }
+      continue;
+    }
+    if (n >= 2 && tok[n - 1] == '"') {
+      if (*p) {
+        p++; /* The space after the word is not part of the string */
+      }
+      while (*p && *p != '"') {
+        p++;
+      }
+      if (*p) {
+        p++;
+      }
+    }
+    *pos = p;
+    *len = n;
+    return tok;
+  }
+}
+
+static const char* copy_token(V4ReplLazyTable* table, const char* tok, size_t len) {
+  if (len + 1 > table->scratch_size) {
+    size_t new_size = table->scratch_size ? table->scratch_size : 64;
+    while (new_size < len + 1) {
+      new_size *= 2;
+    }
+    char* grown = (char*) realloc(table->scratch, new_size);
+    if (!grown) {
+      return NULL;
+    }
+    table->scratch = grown;
+    table->scratch_size = new_size;
+  }
+  memcpy(table->scratch, tok, len);
+  table->scratch[len] = '\0';
+  return table->scratch;
+}
+
+/* Token equals name, ignoring ASCII case like the word index */
+static int same_name(const char* tok, size_t len, const char* name) {
+  for (size_t i = 0; i < len; i++) {
+    char a = tok[i];
+    char b = name[i];
+    if (b == '\0') {
+      return 0;
+    }
+    if (a >= 'a' && a <= 'z') {
+      a = (char) (a - 'a' + 'A');
+    }
+    if (b >= 'a' && b <= 'z') {
+      b = (char) (b - 'a' + 'A');
+    }
+    if (a != b) {
+      return 0;
+    }
+  }
+  return name[len] == '\0';
+}
+
+/* Name of a recorded definition: the token after its ':' */
+static const char* def_name(const char* source, size_t* len) {
+  const char* pos = source;
+  next_token(&pos, len);
+  return next_token(&pos, len);
+}
+
+/* Index of the definition still pending under its own name, else -1 */
+static int pending_def(V4ReplLazyTable* table, int d) {
+  const char* source = table->defs[d].source;
+  size_t len;
+  const char* name = source ? def_name(source, &len) : NULL;
+  if (!name) {
+    return -1;
+  }
+  name = copy_token(table, name, len);
+  return (name && v4repl_index_find(&table->names, name) == d) ? d : -1;
+}
+
+/* Non-zero if the body of a recorded definition mentions name */
+static int mentions(const char* source, const char* name) {
+  const char* pos = source;
+  const char* tok;
+  size_t len;
+  next_token(&pos, &len); /* ':' */
+  next_token(&pos, &len); /* Its own name */
+  while ((tok = next_token(&pos, &len)) != NULL) {
+    if (same_name(tok, len, name)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* The definition no longer backs any name: its source can go (unless being compiled) */
+static void release_def(V4ReplLazyTable* table, int d) {
+  if (!table->defs[d].busy) {
+    free(table->defs[d].source);
+    table->defs[d].source = NULL;
+  }
+}
+
+/* Add one definition, text[0, len) starting at its ':' */
+static int record_def(V4ReplLazyTable* table, const char* text, size_t len, const char* name) {
+  if (table->count >= table->capacity) {
+    int new_cap = table->capacity ? table->capacity * 2 : LAZY_INITIAL_CAPACITY;
+    V4ReplLazyDef* grown =
+        (V4ReplLazyDef*) realloc(table->defs, (size_t) new_cap * sizeof(V4ReplLazyDef));
+    if (!grown) {
+      return -1;
+    }
+    table->defs = grown;
+    table->capacity = new_cap;
+  }
+
+  char* source = (char*) malloc(len + 1);
+  if (!source) {
+    return -1;
+  }
+  memcpy(source, text, len);
+  source[len] = '\0';
+
+  int d = table->count;
+  int old = v4repl_index_find(&table->names, name);
+  if (v4repl_index_add(&table->names, name, d) != 0) {
+    free(source);
+    return -1;
+  }
+  table->defs[d].source = source;
+  table->defs[d].busy = 0;
+  table->count++;
+
+  /* A pending definition of the same name is superseded */
+  if (old >= 0) {
+    release_def(table, old);
+  } else {
+    table->pending++;
+  }
+
+  /* Note the names the body mentions, for v4repl_lazy_redefine() */
+  const char* pos = source;
+  const char* tok;
+  size_t tok_len;
+  next_token(&pos, &tok_len);
+  next_token(&pos, &tok_len);
+  while ((tok = next_token(&pos, &tok_len)) != NULL) {
+    const char* ref = copy_token(table, tok, tok_len);
+    if (!ref || v4repl_index_add(&table->refs, ref, d) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* One definition being resolved (or the line, for d < 0) */
+typedef struct LazyFrame {
+  int d;
+  const char* pos;      /* Next token of its source */
+  const char* name;     /* Its name, in the text that referred to it */
+  size_t name_len;
+  int after_colon;
+} LazyFrame;
+
+/* Frames kept on the C stack before resolve() allocates */
+#define LAZY_INLINE_FRAMES 16
+
+/*
+ * Compile the pending definitions text refers to, dependencies first,
+ * then definition d itself if d >= 0 (name[0, name_len) is its name).
+ * Depth-first over an explicit stack, so a long chain of definitions
+ * that each use the next costs heap, not C stack.
+ */
+static int resolve(V4ReplLazyTable* table, int d, const char* text, const char* name,
+                   size_t name_len, V4ReplLazyCompileFn compile, void* user) {
+  LazyFrame inline_frames[LAZY_INLINE_FRAMES];
+  LazyFrame* frames = inline_frames;
+  int capacity = LAZY_INLINE_FRAMES;
+  int depth = 1;
+  int err = 0;
+
+  frames[0].d = d;
+  frames[0].pos = text;
+  frames[0].name = name;
+  frames[0].name_len = name_len;
+  frames[0].after_colon = 0;
+  if (d >= 0) {
+    table->defs[d].busy = 1;
+  }
+
+  while (depth > 0) {
+    LazyFrame* f = &frames[depth - 1];
+    const char* tok = NULL;
+    size_t len = 0;
+
+    /* Once nothing is pending, the rest of a line cannot refer to anything */
+    if (f->d >= 0 || table->pending > 0) {
+      tok = next_token(&f->pos, &len);
+    }
+
+    if (!tok) {
+      /* Everything the definition uses is compiled: now the definition */
+      depth--;
+      int fd = f->d;
+      if (fd < 0) {
+        continue;
+      }
+      const char* fname = copy_token(table, f->name, f->name_len);
+      err = fname ? compile(user, fname, table->defs[fd].source) : -1;
+      table->defs[fd].busy = 0;
+      if (err != 0) {
+        break;
+      }
+      fname = copy_token(table, f->name, f->name_len);
+      if (!fname) {
+        err = -1;
+        break;
+      }
+      if (v4repl_index_find(&table->names, fname) == fd) {
+        v4repl_lazy_drop(table, fname); /* The host did not register it under this name */
+      } else {
+        release_def(table, fd);
+      }
+      continue;
+    }
+
+    if (f->after_colon) {
+      f->after_colon = 0;
+      continue;
+    }
+    if (len == 1 && tok[0] == ':') {
+      f->after_colon = 1;
+      continue;
+    }
+
+    const char* ref = copy_token(table, tok, len);
+    if (!ref) {
+      err = -1;
+      break;
+    }
+    int r = v4repl_index_find(&table->names, ref);
+    if (r < 0 || table->defs[r].busy) {
+      continue;
+    }
+
+    /* Words the definition uses come first */
+    if (depth == capacity) {
+      int new_cap = capacity * 2;
+      LazyFrame* grown;
+      if (frames == inline_frames) {
+        grown = (LazyFrame*) malloc((size_t) new_cap * sizeof(LazyFrame));
+        if (grown) {
+          memcpy(grown, frames, (size_t) depth * sizeof(LazyFrame));
+        }
+      } else {
+        grown = (LazyFrame*) realloc(frames, (size_t) new_cap * sizeof(LazyFrame));
+      }
+      if (!grown) {
+        err = -1;
+        break;
+      }
+      frames = grown;
+      capacity = new_cap;
+    }
+    LazyFrame* next = &frames[depth++];
+    next->d = r;
+    next->pos = table->defs[r].source;
+    next->name = tok;
+    next->name_len = len;
+    next->after_colon = 0;
+    table->defs[r].busy = 1;
+  }
+
+  /* On error, definitions still on the stack stay pending */
+  for (int i = 0; i < depth; i++) {
+    if (frames[i].d >= 0) {
+      table->defs[frames[i].d].busy = 0;
+    }
+  }
+  if (frames != inline_frames) {
+    free(frames);
+  }
+  return err;
+}
+
+/* Compile pending definition d (a no-op if it is being compiled already) */
+static int resolve_def(V4ReplLazyTable* table, int d, V4ReplLazyCompileFn compile, void* user) {
+  if (table->defs[d].busy) {
+    return 0;
+  }
+  size_t len;
+  const char* name = def_name(table->defs[d].source, &len);
+  return resolve(table, d, table->defs[d].source, name, len, compile, user);
+}
+
+int v4repl_lazy_redefine(V4ReplLazyTable* table, const char* name, const V4ReplWordIndex* words,
+                         V4ReplLazyCompileFn compile, void* user) {
+  if (table->pending == 0) {
+    return 0;
+  }
+  int last = v4repl_index_find(&table->refs, name);
+  if (last < 0) {
+    return 0; /* No recorded definition mentions it */
+  }
+
+  /* The definition being compiled registers its own name: not a redefinition */
+  int own = v4repl_index_find(&table->names, name);
+  if (own >= 0 && table->defs[own].busy) {
+    return 0;
+  }
+  /* Unknown so far: pending words that mention it are forward references */
+  if (own < 0 && (!words || v4repl_index_find(words, name) < 0)) {
+    return 0;
+  }
+
+  /* The name is copied: compile() may reuse the caller's buffer */
+  size_t name_len = strlen(name);
+  char* saved = (char*) malloc(name_len + 1);
+  if (!saved) {
+    return -1;
+  }
+  memcpy(saved, name, name_len + 1);
+
+  int err = 0;
+  for (int d = 0; d <= last && d < table->count && err == 0; d++) {
+    if (pending_def(table, d) >= 0 && !table->defs[d].busy &&
+        mentions(table->defs[d].source, saved)) {
+      err = resolve_def(table, d, compile, user);
+    }
+  }
+  free(saved);
+  return err;
+}
+
+int v4repl_lazy_record(V4ReplLazyTable* table, const char* source, const V4ReplWordIndex* words,
+                       V4ReplLazyCompileFn compile, void* user) {
+  const char* pos = source;
+  const char* tok;
+  size_t len;
+  int in_def = 0;
+  int defs = 0;
+
+  /* Colon definitions only, all of them terminated (the compiler reports the rest) */
+  while ((tok = next_token(&pos, &len)) != NULL) {
+    if (len == 1 && tok[0] == ':') {
+      if (in_def || next_token(&pos, &len) == NULL) {
+        return 0;
+      }
+      in_def = 1;
+      defs++;
+    } else if (len == 1 && tok[0] == ';') {
+      if (!in_def) {
+        return 0;
+      }
+      in_def = 0;
+    } else if (!in_def) {
+      return 0;
+    }
+  }
+  if (in_def || defs == 0) {
+    return 0;
+  }
+
+  /* Record each definition on its own, so each is compiled only when needed */
+  pos = source;
+  while ((tok = next_token(&pos, &len)) != NULL) {
+    const char* start = tok;
+    const char* name = next_token(&pos, &len);
+    size_t name_len = len;
+    while ((tok = next_token(&pos, &len)) != NULL && !(len == 1 && tok[0] == ';')) {
+    }
+
+    /* Pending words that use the name it replaces keep the old meaning */
+    const char* copy = copy_token(table, name, name_len);
+    if (!copy) {
+      return -1;
+    }
+    if (v4repl_lazy_redefine(table, copy, words, compile, user) != 0) {
+      return -2;
+    }
+    copy = copy_token(table, name, name_len);
+    if (!copy || record_def(table, start, (size_t) (pos - start), copy) != 0) {
+      return -1;
+    }
+  }
+  return 1;
+}
+
+int v4repl_lazy_resolve(V4ReplLazyTable* table, const char* line, V4ReplLazyCompileFn compile,
+                        void* user) {
+  if (table->pending == 0) {
+    return 0;
+  }
+  return resolve(table, -1, line, NULL, 0, compile, user);
+}
+
+int v4repl_lazy_resolve_all(V4ReplLazyTable* table, V4ReplLazyCompileFn compile, void* user) {
+  for (int d = 0; d < table->count && table->pending > 0; d++) {
+    if (pending_def(table, d) >= 0) {
+      int err = resolve_def(table, d, compile, user);
+      if (err != 0) {
+        return err;
+      }
+    }
+  }
+  return 0;
+}
+
+void v4repl_lazy_drop(V4ReplLazyTable* table, const char* name) {
+  if (table->pending == 0) {
+    return;
+  }
+  int d = v4repl_index_find(&table->names, name);
+  if (d < 0) {
+    return;
+  }
+  if (v4repl_index_add(&table->names, name, -1) != 0) {
+    return; /* Out of memory: stays pending, compiled again on next use */
+  }
+  table->pending--;
+  release_def(table, d);
+}
+
+int v4repl_lazy_is_pending(const V4ReplLazyTable* table, const char* name) {
+  return table->pending > 0 && v4repl_index_find(&table->names, name) >= 0;
+}
+
+int v4repl_lazy_position(const V4ReplLazyTable* table, const char* name) {
+  return (table->pending > 0) ? v4repl_index_find(&table->names, name) : -1;
+}
+
+void v4repl_lazy_truncate(V4ReplLazyTable* table, int count) {
+  if (count < 0) {
+    count = 0;
+  }
+  for (int d = count; d < table->count; d++) {
+    const char* source = table->defs[d].source;
+    size_t len;
+    const char* name = source ? def_name(source, &len) : NULL;
+    if (name && (name = copy_token(table, name, len)) != NULL &&
+        v4repl_index_find(&table->names, name) == d &&
+        v4repl_index_add(&table->names, name, -1) == 0) {
+      table->pending--;
+    }
+    free(table->defs[d].source);
+  }
+  if (count < table->count) {
+    table->count = count;
+  }
+  /* refs may still name later positions: an upper bound, which stays safe */
+}
+
+int v4repl_lazy_list(V4ReplLazyTable* table, const char* prefix, const char** names, int max) {
+  if (table->pending == 0) {
+    return 0;
+  }
+  int first;
+  int matches = v4repl_index_prefix(&table->names, prefix, &first);
+  if (matches < 0) {
+    return -1;
+  }
+  int total = 0;
+  for (int i = 0; i < matches; i++) {
+    const char* name = v4repl_index_sorted_name(&table->names, first + i);
+    if (v4repl_index_find(&table->names, name) < 0) {
+      continue;
+    }
+    if (names && total < max) {
+      names[total] = name;
+    }
+    total++;
+  }
+  return total;
+}
+
+void v4repl_lazy_clear(V4ReplLazyTable* table) {
+  for (int i = 0; i < table->count; i++) {
+    free(table->defs[i].source);
+  }
+  table->count = 0;
+  table->pending = 0;
+  v4repl_index_clear(&table->names);
+  v4repl_index_clear(&table->refs);
+}
+
+void v4repl_lazy_free(V4ReplLazyTable* table) {
+  v4repl_lazy_clear(table);
+  free(table->defs);
+  free(table->scratch);
+  v4repl_index_free(&table->names);
+  v4repl_index_free(&table->refs);
+  memset(table, 0, sizeof(*table));
+}
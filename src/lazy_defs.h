@@ -0,0 +1,123 @@
+#pragma once
+
+/*
+ * Lazy definitions
+ *
+ * Source text of colon definitions recorded instead of compiled, one
+ * entry per definition. A name stays pending until a line that refers
+ * to it is about to be compiled, at which point v4repl_lazy_resolve()
+ * hands its definition to the compiler (after any pending definitions
+ * that definition itself refers to).
+ *
+ * Names inside a lazy definition keep the meaning they had when it was
+ * entered: before a word it mentions is redefined (eagerly or by another
+ * recorded definition), v4repl_lazy_redefine() compiles it against the
+ * old word. A name that did not exist yet is a forward reference and
+ * binds to whatever defines it before first use.
+ *
+ * Shared by libv4repl (C) and the v4-repl executable (C++).
+ */
+
+#include <stddef.h>
+
+#include "word_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct V4ReplLazyDef {
+  char* source; /* Owned copy of the definition; NULL once compiled */
+  int busy;     /* Being resolved (guards against cycles) */
+} V4ReplLazyDef;
+
+typedef struct V4ReplLazyTable {
+  V4ReplLazyDef* defs;
+  int count;
+  int capacity;
+
+  /* Name -> defs index; -1 once the name is compiled or redefined eagerly */
+  V4ReplWordIndex names;
+  int pending; /* Names that map to a definition */
+
+  /* Name -> last defs index whose body mentions it (may be compiled since) */
+  V4ReplWordIndex refs;
+
+  char* scratch; /* NUL-terminated copy of one token */
+  size_t scratch_size;
+} V4ReplLazyTable;
+
+/*
+ * Compiles one recorded definition and registers its word (the host
+ * calls v4repl_lazy_drop() for it). name is the word being defined.
+ * Returns 0 or an error code.
+ */
+typedef int (*V4ReplLazyCompileFn)(void* user, const char* name, const char* source);
+
+/*
+ * Record source if it consists of colon definitions only. Pending
+ * definitions that use a name it redefines are compiled first (see
+ * v4repl_lazy_redefine). Returns 1 if recorded, 0 if it holds other code
+ * (compile it normally), -1 on OOM or -2 if compile failed.
+ */
+int v4repl_lazy_record(V4ReplLazyTable* table, const char* source, const V4ReplWordIndex* words,
+                       V4ReplLazyCompileFn compile, void* user);
+
+/*
+ * Compile every pending definition that line refers to, dependencies
+ * first. Names right after ':' are not references. Returns 0 or the
+ * first error from compile (that definition stays pending). Chains of
+ * definitions are followed on a heap stack, so their length is bounded
+ * by memory only (-1 on OOM).
+ */
+int v4repl_lazy_resolve(V4ReplLazyTable* table, const char* line, V4ReplLazyCompileFn compile,
+                        void* user);
+
+/*
+ * name is about to be registered again: compile the pending definitions
+ * that mention it, so they bind to its current meaning. Nothing to do
+ * unless name is pending or in words (the host's registered words).
+ * Call before registering compiled definitions. Returns 0 or the first
+ * error from compile.
+ */
+int v4repl_lazy_redefine(V4ReplLazyTable* table, const char* name, const V4ReplWordIndex* words,
+                         V4ReplLazyCompileFn compile, void* user);
+
+/*
+ * Compile every pending definition, in the order they were recorded
+ * (e.g. before writing a session image). Returns 0 or the first error
+ * from compile.
+ */
+int v4repl_lazy_resolve_all(V4ReplLazyTable* table, V4ReplLazyCompileFn compile, void* user);
+
+/* The name has been registered for real; forget any pending definition of it */
+void v4repl_lazy_drop(V4ReplLazyTable* table, const char* name);
+
+/* Non-zero if name is pending */
+int v4repl_lazy_is_pending(const V4ReplLazyTable* table, const char* name);
+
+/* Recording position of name's pending definition (see count), or -1 */
+int v4repl_lazy_position(const V4ReplLazyTable* table, const char* name);
+
+/*
+ * Forget the definitions recorded at position count and later (the
+ * table's count when an earlier word was registered). Definitions they
+ * superseded stay forgotten.
+ */
+void v4repl_lazy_truncate(V4ReplLazyTable* table, int count);
+
+/*
+ * Pending names starting with prefix, in name order: fills up to max
+ * names (names may be NULL) and returns the total, or -1 on OOM.
+ */
+int v4repl_lazy_list(V4ReplLazyTable* table, const char* prefix, const char** names, int max);
+
+/* Forget all recorded definitions but keep the allocations */
+void v4repl_lazy_clear(V4ReplLazyTable* table);
+
+/* Release everything */
+void v4repl_lazy_free(V4ReplLazyTable* table);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,94 @@
+#include "line_reader.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+LineReader::LineReader(FILE* in)
+    : in_(in), buf_(nullptr), capacity_(0), start_(0), end_(0), eof_(false), line_number_(0) {
+  buf_ = (char*) malloc(kBlockSize + 1);  // +1 for the final line's '\0'
+  if (buf_) {
+    capacity_ = kBlockSize;
+  }
+
+  // We do our own block buffering; avoid a second copy inside stdio
+  setvbuf(in_, nullptr, _IONBF, 0);
+}
+
+LineReader::~LineReader() {
+  free(buf_);
+}
+
+bool LineReader::fill() {
+  if (eof_) {
+    return false;
+  }
+
+  // Move the partial line to the front of the buffer
+  if (start_ > 0) {
+    memmove(buf_, buf_ + start_, end_ - start_);
+    end_ -= start_;
+    start_ = 0;
+  }
+
+  // A single line fills the whole buffer: grow it
+  if (end_ == capacity_) {
+    size_t new_cap = capacity_ * 2;
+    char* new_buf = (char*) realloc(buf_, new_cap + 1);
+    if (!new_buf) {
+      eof_ = true;
+      return false;
+    }
+    buf_ = new_buf;
+    capacity_ = new_cap;
+  }
+
+  size_t n = fread(buf_ + end_, 1, capacity_ - end_, in_);
+  if (n == 0) {
+    eof_ = true;
+    return false;
+  }
+  end_ += n;
+  return true;
+}
+
+char* LineReader::next_line() {
+  if (!buf_) {
+    return nullptr;
+  }
+
+  size_t scan = start_;
+  while (true) {
+    char* nl = (char*) memchr(buf_ + scan, '\n', end_ - scan);
+    if (nl) {
+      char* line = buf_ + start_;
+      *nl = '\0';
+      if (nl > line && nl[-1] == '\r') {
+        nl[-1] = '\0';
+      }
+      start_ = (size_t) (nl - buf_) + 1;
+      line_number_++;
+      return line;
+    }
+
+    // No newline yet: remember how far we scanned, then read more
+    size_t scanned = end_ - start_;
+    if (!fill()) {
+      break;
+    }
+    scan = start_ + scanned;
+  }
+
+  // Last line without a trailing newline
+  if (end_ > start_) {
+    char* line = buf_ + start_;
+    buf_[end_] = '\0';
+    if (buf_[end_ - 1] == '\r') {
+      buf_[end_ - 1] = '\0';
+    }
+    start_ = end_;
+    line_number_++;
+    return line;
+  }
+
+  return nullptr;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+/**
+ * @brief Buffered line reader for non-interactive input
+ *
+ * Reads a file or pipe in large blocks and hands out one line at a time
+ * without per-character stdio calls. Used by batch mode, where input can
+ * be several megabytes of Forth source.
+ *
+ * Lines are returned NUL-terminated with the trailing "\n" or "\r\n"
+ * stripped. Lines longer than the block size grow the buffer as needed.
+ */
+class LineReader {
+ public:
+  /**
+   * @brief Construct a reader over an open stream
+   *
+   * @param in Input stream (not closed by the reader)
+   */
+  explicit LineReader(FILE* in);
+
+  /**
+   * @brief Destroy the reader and free its buffer
+   */
+  ~LineReader();
+
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+
+  /**
+   * @brief Check whether the read buffer was allocated
+   */
+  bool ok() const {
+    return buf_ != nullptr;
+  }
+
+  /**
+   * @brief Read the next line
+   *
+   * @return Pointer to the line, or nullptr at end of input or on error.
+   *         The pointer is valid until the next call.
+   */
+  char* next_line();
+
+  /**
+   * @brief 1-based number of the line last returned by next_line()
+   */
+  unsigned long line_number() const {
+    return line_number_;
+  }
+
+ private:
+  static const size_t kBlockSize = 64 * 1024;
+
+  FILE* in_;
+  char* buf_;
+  size_t capacity_;
+  size_t start_;  // Start of unconsumed data
+  size_t end_;    // End of valid data
+  bool eof_;
+  unsigned long line_number_;
+
+  /**
+   * @brief Refill the buffer, compacting or growing it first
+   *
+   * @return false if no more data could be read
+   */
+  bool fill();
+};
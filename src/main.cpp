@@ -1,6 +1,139 @@
 #include "repl.hpp"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include "server.hpp"
+#define HAVE_SERVER 1
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#define ISATTY(fd) _isatty(fd)
+#define FILENO(f) _fileno(f)
+#else
+#include <unistd.h>
+#define ISATTY(fd) isatty(fd)
+#define FILENO(f) fileno(f)
+#endif
+
+static const size_t DEFAULT_SESSION_MEM = 4096;
+static const size_t MAX_PATH_LEN = 1024;
+
+// Copy path to out with its extension (if any) replaced by ext
+static void replace_extension(const char* path, const char* ext, char* out, size_t size) {
+  const char* slash = strrchr(path, '/');
+  const char* dot = strrchr(path, '.');
+  size_t stem = (dot && (!slash || dot > slash)) ? (size_t) (dot - path) : strlen(path);
+  snprintf(out, size, "%.*s%s", (int) stem, path, ext);
+}
+
+static void print_usage(const char* prog) {
+  printf("Usage: %s [--preload BUNDLE] [--lazy] [-f FILE] [--serve SOCKET [--session-mem BYTES]]\n",
+         prog);
+  printf("       %s --compile FILE.fs [-o BUNDLE]\n", prog);
+  printf("\n");
+  printf("  -f FILE              Evaluate FILE in batch mode ('-' = stdin)\n");
+  printf("  --compile FILE.fs    Compile FILE.fs to a bytecode bundle (default: FILE.v4b)\n");
+  printf("  -o BUNDLE            Output path for --compile\n");
+  printf("  --preload BUNDLE     Register a compiled bundle before starting\n");
+  printf("  --lazy               Compile colon definitions on first use\n");
+  printf("  --serve SOCKET       Serve framed sessions on a Unix socket (Linux)\n");
+  printf("  --session-mem BYTES  VM RAM per server session (default: %zu)\n",
+         DEFAULT_SESSION_MEM);
+  printf("  -h                   Show this help\n");
+  printf("\n");
+  printf("Batch mode is also used when stdin is not a terminal.\n");
+}
+
 int main(int argc, char** argv) {
+  const char* script = nullptr;
+  const char* serve_path = nullptr;
+  const char* compile_path = nullptr;
+  const char* output_path = nullptr;
+  const char* preload_path = nullptr;
+  bool lazy = false;
+  size_t session_mem = DEFAULT_SESSION_MEM;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      script = argv[++i];
+    } else if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc) {
+      compile_path = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (strcmp(argv[i], "--preload") == 0 && i + 1 < argc) {
+      preload_path = argv[++i];
+    } else if (strcmp(argv[i], "--lazy") == 0) {
+      lazy = true;
+    } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+      serve_path = argv[++i];
+    } else if (strcmp(argv[i], "--session-mem") == 0 && i + 1 < argc) {
+      session_mem = (size_t) strtoul(argv[++i], nullptr, 0);
+      if (session_mem == 0) {
+        fprintf(stderr, "Invalid --session-mem value\n");
+        return 2;
+      }
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      print_usage(argv[0]);
+      return 0;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (serve_path) {
+#ifdef HAVE_SERVER
+    Server server(session_mem);
+    return server.run(serve_path);
+#else
+    fprintf(stderr, "--serve is only supported on Linux\n");
+    return 2;
+#endif
+  }
+
   Repl repl;
+
+  if (compile_path) {
+    char bundle_path[MAX_PATH_LEN];
+    if (output_path) {
+      snprintf(bundle_path, sizeof(bundle_path), "%s", output_path);
+    } else {
+      replace_extension(compile_path, ".v4b", bundle_path, sizeof(bundle_path));
+    }
+    return repl.compile_bundle(compile_path, bundle_path);
+  }
+
+  if (preload_path) {
+    // lib.v4b is checked against lib.fs when the source is present
+    char source_path[MAX_PATH_LEN];
+    replace_extension(preload_path, ".fs", source_path, sizeof(source_path));
+    if (repl.load_image(preload_path, source_path, false) != 0) {
+      return 1;
+    }
+  }
+
+  // After the bundle: preloaded words are already compiled
+  repl.set_lazy(lazy);
+
+  if (script && strcmp(script, "-") != 0) {
+    FILE* in = fopen(script, "rb");
+    if (!in) {
+      fprintf(stderr, "Cannot open '%s'\n", script);
+      return 1;
+    }
+    int rc = repl.run_batch(in, script);
+    fclose(in);
+    return rc;
+  }
+
+  if (script || !ISATTY(FILENO(stdin))) {
+    return repl.run_batch(stdin, "<stdin>");
+  }
+
   return repl.run();
 }
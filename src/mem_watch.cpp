@@ -0,0 +1,158 @@
+#include "mem_watch.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+// Changed words printed per report; the rest are only counted
+static const int MAX_REPORT_LINES = 32;
+
+static uint64_t load64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t load32_le(const uint8_t* p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+         ((uint32_t) p[3] << 24);
+}
+
+MemWatch::MemWatch(const uint8_t* mem, size_t mem_size)
+    : mem_(mem), mem_size_(mem_size), regions_(), count_(0) {}
+
+MemWatch::~MemWatch() {
+  clear();
+}
+
+int MemWatch::add(uint32_t addr, uint32_t len) {
+  // Widen to whole words
+  uint32_t start = addr & ~3u;
+  uint64_t end = ((uint64_t) addr + len + 3) & ~(uint64_t) 3;
+  if (len == 0 || end > mem_size_) {
+    return -1;
+  }
+  if (count_ >= MAX_WATCHES) {
+    return -2;
+  }
+
+  Region* r = &regions_[count_];
+  r->addr = start;
+  r->len = (uint32_t) (end - start);
+  r->shadow = (uint8_t*) malloc(r->len);
+  r->base = (uint8_t*) malloc(r->len);
+  if (!r->shadow || !r->base) {
+    free(r->shadow);
+    free(r->base);
+    return -3;
+  }
+  memcpy(r->shadow, mem_ + r->addr, r->len);
+  memcpy(r->base, mem_ + r->addr, r->len);
+  count_++;
+  return 0;
+}
+
+bool MemWatch::remove(int n) {
+  if (n < 0 || n >= count_) {
+    return false;
+  }
+  free(regions_[n].shadow);
+  free(regions_[n].base);
+  memmove(&regions_[n], &regions_[n + 1], (count_ - n - 1) * sizeof(Region));
+  count_--;
+  return true;
+}
+
+void MemWatch::clear() {
+  for (int i = 0; i < count_; i++) {
+    free(regions_[i].shadow);
+    free(regions_[i].base);
+  }
+  count_ = 0;
+}
+
+void MemWatch::list(FILE* out) const {
+  if (count_ == 0) {
+    fprintf(out, "No watched regions\n");
+    return;
+  }
+  fprintf(out, "Watched regions (%d):\n", count_);
+  for (int i = 0; i < count_; i++) {
+    fprintf(out, "  #%d  0x%08X-0x%08X (%u bytes)\n", i, (unsigned int) regions_[i].addr,
+            (unsigned int) (regions_[i].addr + regions_[i].len - 1),
+            (unsigned int) regions_[i].len);
+  }
+}
+
+/*
+ * Compare live memory against copy (the shadow or the base of r), print
+ * changed words and bring copy up to date. Only chunks that differ are
+ * written back. printed counts lines across regions for the report cap;
+ * header is printed before the first change of a report.
+ */
+int MemWatch::compare(const Region& r, uint8_t* copy, const char* header, FILE* out,
+                      int* printed) {
+  const uint8_t* live = mem_ + r.addr;
+  int changed = 0;
+
+  for (uint32_t off = 0; off < r.len; off += 8) {
+    uint32_t chunk = (r.len - off >= 8) ? 8 : 4;
+    bool same = (chunk == 8) ? load64(live + off) == load64(copy + off)
+                             : memcmp(live + off, copy + off, 4) == 0;
+    if (same) {
+      continue;
+    }
+
+    for (uint32_t w = off; w < off + chunk; w += 4) {
+      uint32_t old_val = load32_le(copy + w);
+      uint32_t new_val = load32_le(live + w);
+      if (old_val == new_val) {
+        continue;
+      }
+      changed++;
+      if (*printed == 0) {
+        fprintf(out, "%s\n", header);
+      }
+      if (*printed < MAX_REPORT_LINES) {
+        fprintf(out, "  0x%08X: 0x%08X -> 0x%08X  (%d -> %d)\n", (unsigned int) (r.addr + w),
+                (unsigned int) old_val, (unsigned int) new_val, (int32_t) old_val,
+                (int32_t) new_val);
+      }
+      (*printed)++;
+    }
+    memcpy(copy + off, live + off, chunk);
+  }
+  return changed;
+}
+
+int MemWatch::check(FILE* out) {
+  int printed = 0;
+  int changed = 0;
+  for (int i = 0; i < count_; i++) {
+    changed += compare(regions_[i], regions_[i].shadow, "Watched memory changed:", out, &printed);
+  }
+  if (printed > MAX_REPORT_LINES) {
+    fprintf(out, "  ... %d more changed words (see .diff)\n", printed - MAX_REPORT_LINES);
+  }
+  return changed;
+}
+
+int MemWatch::diff(FILE* out) {
+  int printed = 0;
+  int changed = 0;
+  for (int i = 0; i < count_; i++) {
+    changed += compare(regions_[i], regions_[i].base, "Changes since last .diff:", out, &printed);
+  }
+  if (printed > MAX_REPORT_LINES) {
+    fprintf(out, "  ... %d more changed words\n", printed - MAX_REPORT_LINES);
+  }
+  if (changed == 0) {
+    fprintf(out, "No changes since last .diff\n");
+  }
+  return changed;
+}
+
+void MemWatch::sync() {
+  for (int i = 0; i < count_; i++) {
+    memcpy(regions_[i].shadow, mem_ + regions_[i].addr, regions_[i].len);
+  }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @brief Watched VM memory regions with change tracking
+ *
+ * Each region keeps two private copies of its bytes:
+ * - shadow: contents after the previous line, for the per-line report
+ * - base: contents at the previous .diff (or when the watch was added)
+ *
+ * Regions are compared 64 bits at a time; only chunks that differ are
+ * inspected word by word and copied back, so the cost of an unchanged
+ * region is one pass of 8-byte compares. Changes are reported as
+ * little-endian 32-bit words.
+ */
+class MemWatch {
+ public:
+  static const int MAX_WATCHES = 8;
+
+  /**
+   * @param mem VM RAM (mapped at VM address 0)
+   * @param mem_size Size of @p mem in bytes
+   */
+  MemWatch(const uint8_t* mem, size_t mem_size);
+  ~MemWatch();
+
+  MemWatch(const MemWatch&) = delete;
+  MemWatch& operator=(const MemWatch&) = delete;
+
+  /**
+   * @brief Watch [addr, addr + len), widened to whole 32-bit words
+   *
+   * @return 0 on success, -1 if the range is outside RAM, -2 if all
+   *         watch slots are in use, -3 on allocation failure
+   */
+  int add(uint32_t addr, uint32_t len);
+
+  /**
+   * @brief Remove the watch with index @p n (as listed), false if none
+   */
+  bool remove(int n);
+
+  /**
+   * @brief Remove all watches
+   */
+  void clear();
+
+  int count() const {
+    return count_;
+  }
+
+  /**
+   * @brief Print one line per watched region
+   */
+  void list(FILE* out) const;
+
+  /**
+   * @brief Report words changed since the previous check and update the shadow
+   *
+   * Called after every evaluated line; prints nothing if nothing changed.
+   *
+   * @return Number of changed words
+   */
+  int check(FILE* out);
+
+  /**
+   * @brief Report words changed since the previous diff, then re-baseline
+   *
+   * @return Number of changed words
+   */
+  int diff(FILE* out);
+
+  /**
+   * @brief Take the current contents as the new shadow without reporting
+   *
+   * Used when memory is replaced wholesale (e.g. by .load).
+   */
+  void sync();
+
+ private:
+  struct Region {
+    uint32_t addr;  // 4-byte aligned
+    uint32_t len;   // Multiple of 4
+    uint8_t* shadow;
+    uint8_t* base;
+  };
+
+  const uint8_t* mem_;
+  size_t mem_size_;
+  Region regions_[MAX_WATCHES];
+  int count_;
+
+  int compare(const Region& r, uint8_t* copy, const char* header, FILE* out, int* printed);
+};
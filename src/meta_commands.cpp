@@ -6,7 +6,25 @@
 #include <cstdlib>
 #include <cstring>
 
-MetaCommands::MetaCommands(struct Vm* vm, V4FrontContext* ctx) : vm_(vm), ctx_(ctx) {}
+#include "disasm.hpp"
+#include "hex_dump.hpp"
+#include "out_buf.h"
+#include "repl.hpp"
+#include "timing.hpp"
+
+static const unsigned long PROFILE_DEFAULT_ITERATIONS = 1000;
+static const unsigned long PROFILE_MAX_ITERATIONS = 10000000;
+static const unsigned long PROFILER_DEFAULT_HZ = 1000;
+static const unsigned long PROFILER_MAX_HZ = 100000;
+
+// .see reports leaf words up to this size as inlining candidates
+static const int INLINE_MAX_INSNS = 8;
+
+// Staging buffer for commands that print one line per cell or row
+static const size_t OUT_BUFFER_SIZE = 256;
+
+MetaCommands::MetaCommands(struct Vm* vm, V4FrontContext* ctx, Repl* repl)
+    : vm_(vm), ctx_(ctx), repl_(repl) {}
 
 bool MetaCommands::execute(const char* line) {
   // Skip leading whitespace
@@ -23,19 +41,39 @@ bool MetaCommands::execute(const char* line) {
 
   // Match command
   if (strncmp(line, "words", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
-    cmd_words();
+    cmd_words(line + 5);  // Pass arguments after "words"
   } else if (strncmp(line, "stack", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
     cmd_stack();
   } else if (strncmp(line, "rstack", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
     cmd_rstack();
   } else if (strncmp(line, "dump", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
     cmd_dump(line + 4);  // Pass arguments after "dump"
+  } else if (strncmp(line, "watch", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
+    cmd_watch(line + 5);
+  } else if (strncmp(line, "diff", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+    cmd_diff();
   } else if (strncmp(line, "see", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
     cmd_see(line + 3);  // Pass arguments after "see"
+  } else if (strncmp(line, "forget", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
+    cmd_forget(line + 6);  // Pass word name after "forget"
   } else if (strncmp(line, "reset", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
     cmd_reset();
   } else if (strncmp(line, "memory", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
     cmd_memory();
+  } else if (strncmp(line, "compact", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+    cmd_compact();
+  } else if (strncmp(line, "time", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+    cmd_time(line + 4);  // Pass code after "time"
+  } else if (strncmp(line, "profile", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+    cmd_profile(line + 7);  // Pass arguments after "profile"
+  } else if (strncmp(line, "sampling", 8) == 0 && (line[8] == '\0' || line[8] == ' ')) {
+    cmd_sampling(line + 8);  // Pass arguments after "sampling"
+  } else if (strncmp(line, "save", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+    cmd_save(line + 4);  // Pass file name after "save"
+  } else if (strncmp(line, "load", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+    cmd_load(line + 4);  // Pass file name after "load"
+  } else if (strncmp(line, "include", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+    cmd_include(line + 7);  // Pass file name after "include"
   } else if (strncmp(line, "help", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
     cmd_help();
   } else if (strncmp(line, "version", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
@@ -49,24 +87,87 @@ bool MetaCommands::execute(const char* line) {
   return true;
 }
 
-void MetaCommands::cmd_words() {
+void MetaCommands::cmd_words(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  // .words --hot [n]: words sorted by profiler samples
+  if (strncmp(args, "--hot", 5) == 0 && (args[5] == '\0' || args[5] == ' ')) {
+    int limit = (int) strtol(args + 5, nullptr, 0);
+    repl_->profiler().print_hot(repl_->word_index(), limit > 0 ? limit : 0);
+    return;
+  }
+
+  // .words <prefix>: matching words in name order, from the word index
+  if (*args != '\0') {
+    char prefix[64];
+    int n = 0;
+    while (args[n] && args[n] != ' ' && n < 63) {
+      prefix[n] = args[n];
+      n++;
+    }
+    prefix[n] = '\0';
+
+    V4ReplWordIndex& index = repl_->word_index();
+    int first;
+    int matches = v4repl_index_prefix(&index, prefix, &first);
+    int lazy = v4repl_lazy_list(&repl_->lazy_defs(), prefix, nullptr, 0);
+    if (matches < 0) {
+      matches = 0;
+    }
+    if (lazy < 0) {
+      lazy = 0;
+    }
+    if (matches + lazy == 0) {
+      printf("No words starting with '%s'.\n", prefix);
+      return;
+    }
+
+    printf("Words starting with '%s' (%d):\n", prefix, matches + lazy);
+    for (int i = 0; i < matches; i++) {
+      printf("  %s\n", v4repl_index_sorted_name(&index, first + i));
+    }
+    print_lazy_words(prefix);
+    return;
+  }
+
   int count = v4front_context_get_word_count(ctx_);
+  int lazy = v4repl_lazy_list(&repl_->lazy_defs(), "", nullptr, 0);
+  if (lazy < 0) {
+    lazy = 0;
+  }
 
-  if (count == 0) {
+  if (count + lazy == 0) {
     printf("No words defined.\n");
     return;
   }
 
-  printf("Defined words (%d):\n", count);
+  printf("Defined words (%d):\n", count + lazy);
   for (int i = 0; i < count; i++) {
     const char* name = v4front_context_get_word_name(ctx_, i);
     if (name) {
       printf("  %s\n", name);
     }
   }
+  print_lazy_words("");
+}
+
+void MetaCommands::print_lazy_words(const char* prefix) {
+  const char* names[64];
+  int total = v4repl_lazy_list(&repl_->lazy_defs(), prefix, names, 64);
+  for (int i = 0; i < total && i < 64; i++) {
+    printf("  %s (not compiled)\n", names[i]);
+  }
+  if (total > 64) {
+    printf("  ... and %d more not compiled\n", total - 64);
+  }
 }
 
 void MetaCommands::cmd_stack() {
+  char data[OUT_BUFFER_SIZE];
+  V4ReplOutBuf out;
+  v4repl_out_init(&out, data, sizeof(data), v4repl_out_stdout, nullptr);
+
   int ds_depth = vm_ds_depth_public(vm_);
 
   printf("Data Stack (depth: %d):\n", ds_depth);
@@ -76,7 +177,14 @@ void MetaCommands::cmd_stack() {
     // Print from bottom to top (index 0 = bottom)
     for (int i = ds_depth - 1; i >= 0; i--) {
       v4_i32 val = vm_ds_peek_public(vm_, i);
-      printf("  [%d]: %d (0x%08X)\n", ds_depth - 1 - i, val, (unsigned int) val);
+      v4repl_out_str(&out, "  [");
+      v4repl_out_i32(&out, ds_depth - 1 - i);
+      v4repl_out_str(&out, "]: ");
+      v4repl_out_i32(&out, val);
+      v4repl_out_str(&out, " (0x");
+      v4repl_out_hex(&out, (uint32_t) val, 8);
+      v4repl_out_str(&out, ")\n");
+      v4repl_out_flush(&out);
     }
   }
 
@@ -92,7 +200,12 @@ void MetaCommands::cmd_stack() {
 
     // Print from bottom to top
     for (int i = count - 1; i >= 0; i--) {
-      printf("  [%d]: 0x%08X\n", count - 1 - i, (unsigned int) rs_data[i]);
+      v4repl_out_str(&out, "  [");
+      v4repl_out_i32(&out, count - 1 - i);
+      v4repl_out_str(&out, "]: 0x");
+      v4repl_out_hex(&out, (uint32_t) rs_data[i], 8);
+      v4repl_out_char(&out, '\n');
+      v4repl_out_flush(&out);
     }
   }
 }
@@ -110,20 +223,23 @@ void MetaCommands::cmd_rstack() {
   v4_i32 rs_data[64];  // Max return stack size
   int count = vm_rs_copy_to_array(vm_, rs_data, 64);
 
+  // Resolve each return address to WORD+offset
+  const CodeMap& map = repl_->code_map();
+  char where[96];
+
   printf("\nCall trace (most recent first):\n");
   for (int i = count - 1; i >= 0; i--) {
-    printf("  [%2d]: 0x%08X", count - 1 - i, (unsigned int) rs_data[i]);
-
-    // Try to resolve address to word name (if it's a return address)
-    // TODO: Add word lookup by code address when V4-front API is available
-
-    printf("\n");
+    map.describe((uint32_t) rs_data[i], where, sizeof(where));
+    printf("  [%2d]: 0x%08X  %s\n", count - 1 - i, (unsigned int) rs_data[i], where);
   }
 
   printf("\nNote: Values shown are return addresses from function calls.\n");
   printf("      Use .stack to see both data and return stacks together.\n");
 }
 
+// Bytes fetched from VM RAM per bulk read
+static const v4_u32 DUMP_CHUNK_SIZE = 4096;
+
 void MetaCommands::cmd_dump(const char* args) {
   v4_u32 addr = last_dump_addr_;
   v4_u32 length = 256;  // Default: 256 bytes
@@ -132,6 +248,12 @@ void MetaCommands::cmd_dump(const char* args) {
   while (*args == ' ')
     args++;  // Skip leading spaces
 
+  // .dump --raw addr len > file: binary export
+  if (strncmp(args, "--raw", 5) == 0 && (args[5] == '\0' || args[5] == ' ')) {
+    dump_raw(args + 5);
+    return;
+  }
+
   if (*args != '\0') {
     // Parse address
     char* end;
@@ -150,54 +272,181 @@ void MetaCommands::cmd_dump(const char* args) {
   // Align address to 4-byte boundary for cleaner output
   v4_u32 aligned_addr = addr & ~3;
 
+  // Whole rows are shown, so the range is rounded up to 16 bytes
+  size_t mem_size = repl_->memory_size();
+  v4_u32 total = HexDump::row_span(aligned_addr, length, mem_size);
+  if (total == 0) {
+    printf("Address 0x%08X is outside VM memory (%zu bytes)\n", aligned_addr, mem_size);
+    return;
+  }
+  if (length > mem_size - aligned_addr) {
+    length = (v4_u32) (mem_size - aligned_addr);
+  }
+
   printf("Memory dump at 0x%08X (%u bytes):\n", aligned_addr, length);
   printf("Address   +0 +1 +2 +3  +4 +5 +6 +7  +8 +9 +A +B  +C +D +E +F  ASCII\n");
   printf("--------  -----------  -----------  -----------  -----------  ----------------\n");
 
-  for (v4_u32 offset = 0; offset < length; offset += 16) {
-    printf("%08X  ", aligned_addr + offset);
-
-    // Read and display 16 bytes in hex
-    v4_u8 bytes[16];
-    for (int i = 0; i < 16; i++) {
-      v4_u32 byte_addr = aligned_addr + offset + i;
-      v4_u32 word;
-
-      // Read 32-bit word (VM memory API works in 32-bit units)
-      v4_err err = vm_mem_read32(vm_, byte_addr & ~3, &word);
-
-      if (err == 0) {
-        // Extract the byte from the word (little-endian)
-        int byte_pos = byte_addr & 3;
-        bytes[i] = (word >> (byte_pos * 8)) & 0xFF;
-        printf("%02X ", bytes[i]);
-      } else {
-        bytes[i] = 0;
-        printf("?? ");
-      }
-
-      // Add spacing every 4 bytes
-      if ((i & 3) == 3)
-        printf(" ");
+  static v4_u8 chunk[DUMP_CHUNK_SIZE];
+  char data[4096];
+  V4ReplOutBuf out;
+  v4repl_out_init(&out, data, sizeof(data), v4repl_out_stdout, nullptr);
+
+  char line[HexDump::LINE_SIZE];
+  for (v4_u32 base = 0; base < total; base += DUMP_CHUNK_SIZE) {
+    v4_u32 want = (total - base < DUMP_CHUNK_SIZE) ? total - base : DUMP_CHUNK_SIZE;
+    size_t got = repl_->read_memory(aligned_addr + base, chunk, want);
+
+    for (v4_u32 row = 0; row < want; row += HexDump::ROW_BYTES) {
+      int valid = (got > row) ? (int) (got - row) : 0;
+      size_t n = HexDump::format_row(line, aligned_addr + base + row, chunk + row,
+                                     valid < 16 ? valid : 16);
+      v4repl_out_write(&out, line, n);
     }
+  }
+  v4repl_out_flush(&out);
 
-    // Display ASCII representation
-    printf(" ");
-    for (int i = 0; i < 16; i++) {
-      char c = bytes[i];
-      printf("%c", (c >= 32 && c < 127) ? c : '.');
-    }
-    printf("\n");
+  // Update last dump address for next invocation
+  last_dump_addr_ = aligned_addr + total;  // Round up to next 16-byte boundary
+
+  printf("\nNext: .dump (continues from 0x%08X)\n", last_dump_addr_);
+}
+
+void MetaCommands::dump_raw(const char* args) {
+  char* end;
+  v4_u32 addr = (v4_u32) strtoul(args, &end, 0);
+  bool have_addr = end != args;
+  args = end;
+  v4_u32 length = (v4_u32) strtoul(args, &end, 0);
+  bool have_len = end != args;
+  args = end;
+
+  while (*args == ' ')
+    args++;
+  if (*args == '>') {
+    args++;
+    while (*args == ' ')
+      args++;
+  }
+
+  // The file name runs to the end of the line, less trailing whitespace
+  char path[256];
+  size_t path_len = strlen(args);
+  while (path_len > 0 && (args[path_len - 1] == ' ' || args[path_len - 1] == '\t' ||
+                          args[path_len - 1] == '\r' || args[path_len - 1] == '\n')) {
+    path_len--;
+  }
 
-    // Stop if we've gone beyond requested length
-    if (offset + 16 >= length)
+  if (!have_addr || !have_len || path_len == 0) {
+    printf("Usage: .dump --raw <addr> <len> > <file>\n");
+    return;
+  }
+  if (path_len >= sizeof(path)) {
+    printf("File name too long\n");
+    return;
+  }
+  memcpy(path, args, path_len);
+  path[path_len] = '\0';
+
+  size_t mem_size = repl_->memory_size();
+  if (addr >= mem_size || length > mem_size - addr) {
+    printf("Range 0x%08X+%u is outside VM memory (%zu bytes)\n", addr, length, mem_size);
+    return;
+  }
+
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    printf("Cannot open '%s' for writing\n", path);
+    return;
+  }
+
+  // One bulk read per chunk, written straight to the file
+  static v4_u8 chunk[DUMP_CHUNK_SIZE];
+  size_t written = 0;
+  while (written < length) {
+    size_t want = length - written;
+    if (want > DUMP_CHUNK_SIZE) {
+      want = DUMP_CHUNK_SIZE;
+    }
+    size_t got = repl_->read_memory(addr + (v4_u32) written, chunk, want);
+    if (got == 0 || fwrite(chunk, 1, got, f) != got) {
       break;
+    }
+    written += got;
   }
+  bool ok = (fclose(f) == 0) && written == length;
 
-  // Update last dump address for next invocation
-  last_dump_addr_ = aligned_addr + ((length + 15) & ~15);  // Round up to next 16-byte boundary
+  if (ok) {
+    printf("Wrote %zu bytes from 0x%08X to %s\n", written, addr, path);
+  } else {
+    printf("Error writing '%s'\n", path);
+  }
+}
 
-  printf("\nNext: .dump (continues from 0x%08X)\n", last_dump_addr_);
+void MetaCommands::cmd_watch(const char* args) {
+  MemWatch& watch = repl_->mem_watch();
+
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    watch.list(stdout);
+    return;
+  }
+
+  if (strcmp(args, "clear") == 0) {
+    watch.clear();
+    printf("All watches removed\n");
+    return;
+  }
+
+  if (strncmp(args, "del", 3) == 0 && (args[3] == '\0' || args[3] == ' ')) {
+    char* end;
+    long n = strtol(args + 3, &end, 0);
+    if (end == args + 3 || !watch.remove((int) n)) {
+      printf("No watch #%s (see .watch)\n", args + 3 + strspn(args + 3, " "));
+      return;
+    }
+    printf("Watch #%ld removed\n", n);
+    return;
+  }
+
+  // .watch addr len
+  char* end;
+  v4_u32 addr = (v4_u32) strtoul(args, &end, 0);
+  bool have_addr = end != args;
+  args = end;
+  v4_u32 length = (v4_u32) strtoul(args, &end, 0);
+  if (!have_addr || end == args) {
+    printf("Usage: .watch <addr> <len>\n");
+    printf("       .watch [del <n> | clear]\n");
+    return;
+  }
+
+  switch (watch.add(addr, length)) {
+    case 0:
+      printf("Watching 0x%08X (%u bytes)\n", addr & ~3u, length);
+      break;
+    case -1:
+      printf("Range 0x%08X+%u is outside VM memory (%zu bytes)\n", addr, length,
+             repl_->memory_size());
+      break;
+    case -2:
+      printf("Too many watches (max %d), remove one with .watch del <n>\n",
+             MemWatch::MAX_WATCHES);
+      break;
+    default:
+      printf("Out of memory\n");
+      break;
+  }
+}
+
+void MetaCommands::cmd_diff() {
+  if (repl_->mem_watch().count() == 0) {
+    printf("No watched regions (use .watch <addr> <len>)\n");
+    return;
+  }
+  repl_->mem_watch().diff(stdout);
 }
 
 void MetaCommands::cmd_see(const char* args) {
@@ -219,8 +468,12 @@ void MetaCommands::cmd_see(const char* args) {
   }
   word_name[i] = '\0';
 
-  // Find word in compiler context
-  int vm_idx = v4front_context_find_word(ctx_, word_name);
+  // Find word in the session's word index
+  int vm_idx = v4repl_index_find(&repl_->word_index(), word_name);
+  if (vm_idx < 0 && v4repl_lazy_is_pending(&repl_->lazy_defs(), word_name)) {
+    printf("Word '%s' is defined but not compiled yet (lazy mode).\n", word_name);
+    return;
+  }
   if (vm_idx < 0) {
     printf("Word '%s' not found.\n", word_name);
     printf("Use .words to see all defined words.\n");
@@ -238,40 +491,308 @@ void MetaCommands::cmd_see(const char* args) {
   printf("Word: %s\n", word_name);
   printf("VM index: %d\n", vm_idx);
   printf("Bytecode length: %d bytes\n", word->code_len);
-  printf("\nDisassembly:\n");
-  printf("Offset  Bytes                    \n");
-  printf("------  -------------------------\n");
-
-  // Display bytecode in hex (16 bytes per line)
-  const uint8_t* code = word->code;
-  for (uint32_t offset = 0; offset < word->code_len; offset += 16) {
-    printf("%04X    ", offset);
 
-    // Print hex bytes
-    for (uint32_t i = 0; i < 16 && (offset + i) < word->code_len; i++) {
-      printf("%02X ", code[offset + i]);
-    }
+  Disassembler disasm(vm_, repl_->word_index());
+  printf("\nDisassembly:\n");
+  printf("  Off   Bytes           Instruction\n");
+  printf("  ----  --------------  -----------\n");
+  char data[OUT_BUFFER_SIZE];
+  V4ReplOutBuf out;
+  v4repl_out_init(&out, data, sizeof(data), v4repl_out_stdout, nullptr);
+  disasm.print_listing(&out, word->code, (uint32_t) word->code_len);
+
+  const Disassembler::WordFacts* facts = disasm.analyze(vm_idx);
+  if (!facts) {
+    return;
+  }
 
-    printf("\n");
+  printf("\nAnalysis:\n");
+  printf("  Instructions:     %d\n", facts->insn_count);
+  if (facts->effect_known) {
+    printf("  Stack effect:     ( %d -- %d ), peak +%d\n", facts->inputs, facts->outputs,
+           facts->peak);
+  } else {
+    printf("  Stack effect:     unknown\n");
   }
+  if (facts->call_depth >= 0) {
+    printf("  Calls:            %d (call depth %d)\n", facts->call_count, facts->call_depth);
+  } else {
+    printf("  Calls:            %d (call depth unbounded)\n", facts->call_count);
+  }
+  printf("  Leaf word:        %s\n", facts->leaf ? "yes" : "no");
+  printf("  Recursive:        %s\n", facts->recursive ? "yes" : "no");
 
-  printf("\nNote: Use V4-front disassembler for opcode names.\n");
-  printf("      Bytecode is in V4 instruction format.\n");
+  // Small straight-line leaves are cheap to copy into their callers
+  bool inline_candidate =
+      facts->leaf && facts->effect_known && facts->insn_count <= INLINE_MAX_INSNS;
+  printf("  Inline candidate: %s\n", inline_candidate ? "yes" : "no");
 }
 
 void MetaCommands::cmd_reset() {
   vm_reset(vm_);
   v4front_context_reset(ctx_);
+  repl_->clear_definitions();
+  repl_->profiler().reset();  // Word IDs are reused after a reset
+  repl_->mem_watch().sync();
   printf("VM and compiler context reset.\n");
   last_dump_addr_ = 0;  // Reset dump address too
 }
 
+void MetaCommands::cmd_forget(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .forget <word_name>\n");
+    printf("Forgets the word and every word defined after it.\n");
+    return;
+  }
+
+  char word_name[64];
+  int i = 0;
+  while (*args && *args != ' ' && i < 63) {
+    word_name[i++] = *args++;
+  }
+  word_name[i] = '\0';
+
+  int forgotten = repl_->forget_word(word_name);
+  if (forgotten > 0) {
+    printf("Forgot %d definition%s from %s on.\n", forgotten, forgotten == 1 ? "" : "s",
+           word_name);
+  }
+}
+
 void MetaCommands::cmd_memory() {
   printf("Memory usage information:\n");
   printf("  VM memory size: (not yet available from V4-core)\n");
   printf("  Data stack depth: %d / 256\n", vm_ds_depth_public(vm_));
   printf("  Return stack depth: %d / 64\n", vm_rs_depth_public(vm_));
   printf("  Registered words: %d\n", v4front_context_get_word_count(ctx_));
+  const CodeSegment& segment = repl_->code_segment();
+  printf("  Code segment: %zu / %zu bytes used, %zu reclaimable by .compact\n", segment.used(),
+         segment.capacity(), repl_->reclaimable_code_bytes());
+}
+
+void MetaCommands::cmd_compact() {
+  size_t before = repl_->code_segment().used();
+  repl_->retire_superseded();
+  if (!repl_->compact_code()) {
+    printf("Out of memory compacting the code segment\n");
+    return;
+  }
+  const CodeSegment& segment = repl_->code_segment();
+  printf("Code segment: %zu -> %zu bytes (%zu reclaimed), capacity %zu\n", before, segment.used(),
+         before - segment.used(), segment.capacity());
+}
+
+void MetaCommands::cmd_time(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .time <forth code>\n");
+    printf("Example: .time 10 FIB\n");
+    return;
+  }
+
+  uint64_t compile_ns = 0;
+  uint64_t exec_ns = 0;
+  if (repl_->eval_code(args, &compile_ns, &exec_ns) != 0) {
+    return;  // Error already reported
+  }
+
+  char compile_str[32];
+  char exec_str[32];
+  format_duration(compile_str, sizeof(compile_str), compile_ns);
+  format_duration(exec_str, sizeof(exec_str), exec_ns);
+  printf("compile: %s  execute: %s\n", compile_str, exec_str);
+}
+
+void MetaCommands::cmd_sampling(const char* args) {
+  Profiler& profiler = repl_->profiler();
+
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    if (profiler.running()) {
+      printf("Sampling profiler: on (%u Hz)\n", profiler.hz());
+    } else {
+      printf("Sampling profiler: off\n");
+    }
+    printf("Usage: .sampling on [hz] | off | reset\n");
+    return;
+  }
+
+  if (strncmp(args, "on", 2) == 0 && (args[2] == '\0' || args[2] == ' ')) {
+    if (!Profiler::supported()) {
+      printf("Sampling profiler is not supported on this platform.\n");
+      return;
+    }
+    if (profiler.running()) {
+      printf("Sampling profiler already on (%u Hz)\n", profiler.hz());
+      return;
+    }
+
+    unsigned long hz = strtoul(args + 2, nullptr, 0);
+    if (hz == 0) {
+      hz = PROFILER_DEFAULT_HZ;
+    }
+    if (hz > PROFILER_MAX_HZ) {
+      printf("Sampling rate must be at most %lu Hz\n", PROFILER_MAX_HZ);
+      return;
+    }
+
+    if (!profiler.start((unsigned int) hz)) {
+      printf("Failed to start sampling profiler\n");
+      return;
+    }
+    printf("Sampling profiler on (%lu Hz). Use .words --hot to see results.\n", hz);
+  } else if (strncmp(args, "off", 3) == 0 && (args[3] == '\0' || args[3] == ' ')) {
+    profiler.stop();
+    printf("Sampling profiler off.\n");
+  } else if (strncmp(args, "reset", 5) == 0 && (args[5] == '\0' || args[5] == ' ')) {
+    profiler.reset();
+    printf("Profiler samples cleared.\n");
+  } else {
+    printf("Usage: .sampling on [hz] | off | reset\n");
+  }
+}
+
+static int compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a;
+  uint64_t y = *(const uint64_t*) b;
+  return (x > y) - (x < y);
+}
+
+void MetaCommands::cmd_profile(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .profile <word_name> [iterations]\n");
+    printf("Example: .profile SQUARE 10000\n");
+    return;
+  }
+
+  // Extract word name (up to first space or end of string)
+  char word_name[64];
+  int i = 0;
+  while (*args && *args != ' ' && i < 63) {
+    word_name[i++] = *args++;
+  }
+  word_name[i] = '\0';
+
+  unsigned long iterations = PROFILE_DEFAULT_ITERATIONS;
+  while (*args == ' ')
+    args++;
+  if (*args != '\0') {
+    iterations = strtoul(args, nullptr, 0);
+    if (iterations == 0 || iterations > PROFILE_MAX_ITERATIONS) {
+      printf("Iterations must be between 1 and %lu\n", PROFILE_MAX_ITERATIONS);
+      return;
+    }
+  }
+
+  int vm_idx = v4repl_index_find(&repl_->word_index(), word_name);
+  if (vm_idx < 0) {
+    printf("Word '%s' not found.\n", word_name);
+    printf("Use .words to see all defined words.\n");
+    return;
+  }
+
+  Word* word = vm_get_word(vm_, vm_idx);
+  if (!word || !word->code || word->code_len == 0) {
+    printf("Word '%s' has no bytecode.\n", word_name);
+    return;
+  }
+
+  uint64_t* samples = (uint64_t*) malloc(iterations * sizeof(uint64_t));
+  if (!samples) {
+    printf("Out of memory allocating %lu samples\n", iterations);
+    return;
+  }
+
+  // Every run starts from the current stack, so words that consume or
+  // produce values can be measured repeatedly
+  struct VmStackSnapshot* snapshot = vm_ds_snapshot(vm_);
+  if (!snapshot) {
+    printf("Failed to save data stack\n");
+    free(samples);
+    return;
+  }
+
+  unsigned long done = 0;
+  for (; done < iterations; done++) {
+    uint64_t start = monotonic_ns();
+    v4_err err = vm_exec(vm_, word);
+    samples[done] = monotonic_ns() - start;
+
+    vm_ds_restore(vm_, snapshot);
+
+    if (err != 0) {
+      printf("Execution failed [%d] on iteration %lu\n", err, done + 1);
+      break;
+    }
+  }
+
+  vm_ds_snapshot_free(snapshot);
+
+  if (done == iterations) {
+    qsort(samples, done, sizeof(uint64_t), compare_u64);
+
+    unsigned long p99_idx = (done * 99) / 100;
+    if (p99_idx >= done) {
+      p99_idx = done - 1;
+    }
+
+    char min_str[32];
+    char median_str[32];
+    char p99_str[32];
+    char max_str[32];
+    printf("Profile: %s (%lu iterations)\n", word_name, done);
+    printf("  min:    %s\n", format_duration(min_str, sizeof(min_str), samples[0]));
+    printf("  median: %s\n", format_duration(median_str, sizeof(median_str), samples[done / 2]));
+    printf("  p99:    %s\n", format_duration(p99_str, sizeof(p99_str), samples[p99_idx]));
+    printf("  max:    %s\n", format_duration(max_str, sizeof(max_str), samples[done - 1]));
+  }
+
+  free(samples);
+}
+
+void MetaCommands::cmd_save(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .save <file>\n");
+    return;
+  }
+  repl_->save_image(args);
+}
+
+void MetaCommands::cmd_load(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .load <file>\n");
+    return;
+  }
+  if (repl_->load_image(args) == 0) {
+    last_dump_addr_ = 0;  // Memory was replaced
+  }
+}
+
+void MetaCommands::cmd_include(const char* args) {
+  while (*args == ' ')
+    args++;  // Skip leading spaces
+
+  if (*args == '\0') {
+    printf("Usage: .include <file>\n");
+    return;
+  }
+  repl_->include_file(args);
 }
 
 void MetaCommands::cmd_help() {
@@ -280,12 +801,26 @@ void MetaCommands::cmd_help() {
 
   printf("Meta-commands:\n");
   printf("  .words              - List all defined words\n");
+  printf("  .words --hot [n]    - List words by profiler samples (see .sampling)\n");
+  printf("  .words <prefix>     - List words starting with prefix (Tab completes names)\n");
   printf("  .stack              - Show data and return stack contents\n");
   printf("  .rstack             - Show return stack with call trace\n");
   printf("  .dump [addr] [len]  - Hexdump memory (default: continue from last)\n");
+  printf("  .dump --raw a n > f - Write n bytes of memory at a to file f\n");
+  printf("  .watch <addr> <len> - Report changes to memory after every line\n");
+  printf("  .watch              - List watched regions (also: del <n>, clear)\n");
+  printf("  .diff               - Show watched words changed since the last .diff\n");
   printf("  .see <word>         - Show word bytecode disassembly\n");
+  printf("  .forget <word>      - Forget a word and all words defined after it\n");
   printf("  .reset              - Reset VM and compiler context\n");
   printf("  .memory             - Show memory usage statistics\n");
+  printf("  .compact            - Re-pack word bytecode, dropping superseded words\n");
+  printf("  .time <code>        - Evaluate code and show compile/execute time\n");
+  printf("  .profile <word> [n] - Run a word n times (default 1000), show latency\n");
+  printf("  .sampling on [hz]   - Start sampling profiler (also: off, reset)\n");
+  printf("  .save <file>        - Save words, stack and memory to an image\n");
+  printf("  .load <file>        - Replace the session with a saved image\n");
+  printf("  .include <file>     - Compile and run a source file (once per session)\n");
   printf("  .help               - Show this help message\n");
   printf("  .version            - Show REPL and component versions\n");
 
@@ -3,17 +3,23 @@
 #include <v4/vm_api.h>
 #include <v4front/compile.h>
 
+class Repl;
+
 /**
  * @brief Meta-command handler for V4 REPL
  *
  * Provides dot-commands for inspecting and controlling the REPL state:
- * - .words              : List all defined words
+ * - .words [--hot [n]]  : List all defined words (or hottest by samples)
  * - .stack              : Show data and return stack contents
  * - .rstack             : Show return stack with call trace
  * - .dump [addr] [len]  : Hexdump memory (default: continue from last)
  * - .see <word>         : Show word bytecode disassembly
  * - .reset              : Reset VM and compiler context
  * - .memory             : Show memory usage statistics
+ * - .compact            : Re-pack word bytecode in call-graph order
+ * - .time <code>        : Evaluate code and report compile/execute time
+ * - .profile <word> [n] : Run a word n times and report latency percentiles
+ * - .sampling on|off    : Control the sampling profiler
  * - .help               : Show help message
  * - .version            : Show version information
  */
@@ -24,8 +30,9 @@ class MetaCommands {
    *
    * @param vm Pointer to VM instance
    * @param ctx Pointer to compiler context
+   * @param repl Owning REPL, used to evaluate code for .time
    */
-  MetaCommands(struct Vm* vm, V4FrontContext* ctx);
+  MetaCommands(struct Vm* vm, V4FrontContext* ctx, Repl* repl);
 
   /**
    * @brief Execute a meta-command if the line starts with '.'
@@ -38,15 +45,28 @@ class MetaCommands {
  private:
   struct Vm* vm_;
   V4FrontContext* ctx_;
+  Repl* repl_;
   v4_u32 last_dump_addr_ = 0;  // Track last dump address for continuation
 
-  void cmd_words();
+  void cmd_words(const char* args);
+  void print_lazy_words(const char* prefix);
   void cmd_stack();
   void cmd_rstack();
   void cmd_dump(const char* args);
+  void dump_raw(const char* args);
   void cmd_see(const char* args);
+  void cmd_watch(const char* args);
+  void cmd_diff();
+  void cmd_forget(const char* args);
   void cmd_reset();
   void cmd_memory();
+  void cmd_compact();
+  void cmd_time(const char* args);
+  void cmd_profile(const char* args);
+  void cmd_sampling(const char* args);
+  void cmd_save(const char* args);
+  void cmd_load(const char* args);
+  void cmd_include(const char* args);
   void cmd_help();
   void cmd_version();
 };
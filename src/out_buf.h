@@ -0,0 +1,131 @@
+#pragma once
+
+/*
+ * Allocation-free buffered output
+ *
+ * Text is assembled in a caller-provided buffer and handed to a write
+ * callback only when the buffer fills or the caller flushes (normally
+ * once per output line). Integers are formatted by hand so no printf
+ * family call is needed on the hot path.
+ *
+ * Shared by libv4repl (C) and the v4-repl executable (C++).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*V4ReplOutWriteFn)(void* user, const char* data, size_t len);
+
+typedef struct V4ReplOutBuf {
+  char* data;
+  size_t size;
+  size_t len;
+  V4ReplOutWriteFn write;
+  void* user;
+} V4ReplOutBuf;
+
+/* Default sink: stdout through stdio, so ordering with printf is kept */
+static inline void v4repl_out_stdout(void* user, const char* data, size_t len) {
+  (void) user;
+  fwrite(data, 1, len, stdout);
+}
+
+static inline void v4repl_out_init(V4ReplOutBuf* out, char* data, size_t size,
+                                   V4ReplOutWriteFn write, void* user) {
+  out->data = data;
+  out->size = size;
+  out->len = 0;
+  out->write = write;
+  out->user = user;
+}
+
+static inline void v4repl_out_flush(V4ReplOutBuf* out) {
+  if (out->len > 0) {
+    out->write(out->user, out->data, out->len);
+    out->len = 0;
+  }
+}
+
+static inline void v4repl_out_write(V4ReplOutBuf* out, const char* s, size_t n) {
+  while (n > 0) {
+    if (out->len == out->size) {
+      v4repl_out_flush(out);
+    }
+    size_t room = out->size - out->len;
+    size_t chunk = (n < room) ? n : room;
+    memcpy(out->data + out->len, s, chunk);
+    out->len += chunk;
+    s += chunk;
+    n -= chunk;
+  }
+}
+
+static inline void v4repl_out_str(V4ReplOutBuf* out, const char* s) {
+  v4repl_out_write(out, s, strlen(s));
+}
+
+static inline void v4repl_out_char(V4ReplOutBuf* out, char c) {
+  if (out->len == out->size) {
+    v4repl_out_flush(out);
+  }
+  out->data[out->len++] = c;
+}
+
+/* Unsigned decimal; returns the number of characters written to dst */
+static inline size_t v4repl_fmt_u32(char* dst, uint32_t v) {
+  char tmp[10];
+  size_t n = 0;
+  do {
+    tmp[n++] = (char) ('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = tmp[n - 1 - i];
+  }
+  return n;
+}
+
+/* Signed decimal (INT32_MIN safe); dst needs 11 bytes */
+static inline size_t v4repl_fmt_i32(char* dst, int32_t v) {
+  if (v < 0) {
+    dst[0] = '-';
+    return 1 + v4repl_fmt_u32(dst + 1, 0u - (uint32_t) v);
+  }
+  return v4repl_fmt_u32(dst, (uint32_t) v);
+}
+
+/* Uppercase hex, zero-padded to exactly digits (1..8) characters */
+static inline size_t v4repl_fmt_hex(char* dst, uint32_t v, int digits) {
+  static const char hex[] = "0123456789ABCDEF";
+  for (int i = digits - 1; i >= 0; i--) {
+    dst[i] = hex[v & 0xF];
+    v >>= 4;
+  }
+  return (size_t) digits;
+}
+
+static inline void v4repl_out_i32(V4ReplOutBuf* out, int32_t v) {
+  char tmp[11];
+  v4repl_out_write(out, tmp, v4repl_fmt_i32(tmp, v));
+}
+
+static inline void v4repl_out_u32(V4ReplOutBuf* out, uint32_t v) {
+  char tmp[10];
+  v4repl_out_write(out, tmp, v4repl_fmt_u32(tmp, v));
+}
+
+static inline void v4repl_out_hex(V4ReplOutBuf* out, uint32_t v, int digits) {
+  char tmp[8];
+  v4repl_out_write(out, tmp, v4repl_fmt_hex(tmp, v, digits));
+}
+
+#ifdef __cplusplus
+}
+#endif
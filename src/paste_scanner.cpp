@@ -0,0 +1,103 @@
+#include "paste_scanner.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+PasteScanner::PasteScanner()
+    : buf_(nullptr),
+      size_(0),
+      capacity_(0),
+      commit_(0),
+      saved_('\0'),
+      lines_(0),
+      first_line_(1) {}
+
+PasteScanner::~PasteScanner() {
+  free(buf_);
+}
+
+void PasteScanner::reset() {
+  size_ = 0;
+  commit_ = 0;
+  if (buf_) {
+    buf_[0] = '\0';
+  }
+  lexer_.reset();
+  lines_ = 0;
+  first_line_ = 1;
+}
+
+bool PasteScanner::append(const char* line) {
+  size_t len = strlen(line);
+  size_t needed = size_ + len + 2;  // +2 for '\n' and '\0'
+
+  if (needed > capacity_) {
+    size_t new_cap = (capacity_ == 0) ? 1024 : capacity_ * 2;
+    while (new_cap < needed) {
+      new_cap *= 2;
+    }
+    char* new_buf = (char*) realloc(buf_, new_cap);
+    if (!new_buf) {
+      return false;
+    }
+    buf_ = new_buf;
+    capacity_ = new_cap;
+  }
+
+  size_t start = size_;
+  memcpy(buf_ + size_, line, len);
+  size_ += len;
+  buf_[size_++] = '\n';
+  buf_[size_] = '\0';
+  lines_++;
+
+  size_t end = lexer_.scan(buf_, start, size_);
+  if (end != 0) {
+    commit_ = end;
+  }
+  return true;
+}
+
+const char* PasteScanner::ready() {
+  if (commit_ == 0) {
+    return nullptr;
+  }
+
+  // Chunks of blank lines are dropped, not compiled
+  size_t i = 0;
+  while (i < commit_ && is_space(buf_[i])) {
+    i++;
+  }
+  saved_ = buf_[commit_];
+  if (i == commit_) {
+    consume();
+    return nullptr;
+  }
+  buf_[commit_] = '\0';
+  return buf_;
+}
+
+void PasteScanner::consume() {
+  buf_[commit_] = saved_;
+  for (size_t i = 0; i < commit_; i++) {
+    if (buf_[i] == '\n') {
+      first_line_++;
+    }
+  }
+  memmove(buf_, buf_ + commit_, size_ - commit_ + 1);
+  size_ -= commit_;
+  commit_ = 0;
+}
+
+const char* PasteScanner::rest() {
+  for (size_t i = 0; i < size_; i++) {
+    if (!is_space(buf_[i])) {
+      return buf_;
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+
+#include "chunk_lexer.hpp"
+
+/**
+ * @brief Splits PASTE-mode input into complete, compilable chunks
+ *
+ * Lines are appended as they arrive and scanned once by a ChunkLexer.
+ * Only the open fragment after the last chunk stays buffered, so a long
+ * paste is compiled piece by piece instead of all at once at ">>>".
+ */
+class PasteScanner {
+ public:
+  PasteScanner();
+  ~PasteScanner();
+
+  PasteScanner(const PasteScanner&) = delete;
+  PasteScanner& operator=(const PasteScanner&) = delete;
+
+  /**
+   * @brief Forget all buffered text and start a new paste
+   */
+  void reset();
+
+  /**
+   * @brief Append one line (a newline is added) and scan it
+   *
+   * @return false if out of memory (the line is dropped)
+   */
+  bool append(const char* line);
+
+  /**
+   * @brief Complete code at the front of the buffer, NUL-terminated
+   *
+   * @return The chunk, or nullptr if no complete chunk is buffered.
+   *         Valid until consume() or append().
+   */
+  const char* ready();
+
+  /**
+   * @brief Drop the chunk returned by ready()
+   */
+  void consume();
+
+  /**
+   * @brief Take whatever is left (an unterminated fragment) as a final chunk
+   *
+   * @return The text, or nullptr if only whitespace is buffered
+   */
+  const char* rest();
+
+  /**
+   * @brief 1-based paste line on which the buffered text starts
+   */
+  unsigned long first_line() const {
+    return first_line_;
+  }
+
+  /**
+   * @brief Number of lines appended since reset()
+   */
+  unsigned long line_count() const {
+    return lines_;
+  }
+
+ private:
+  char* buf_;
+  size_t size_;
+  size_t capacity_;
+  size_t commit_;  // Bytes at the front that form complete chunks
+  char saved_;     // Byte replaced by the NUL that ends a ready() chunk
+
+  ChunkLexer lexer_;  // State at the end of the buffered text
+
+  unsigned long lines_;
+  unsigned long first_line_;
+};
@@ -0,0 +1,454 @@
+#include "v4repl/pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+static const size_t DEFAULT_VM_MEM_SIZE = 16 * 1024;
+static const size_t DEFAULT_QUEUE_CAPACITY = 1024;
+static const int SPIN_BEFORE_SLEEP = 64;
+
+namespace {
+
+struct Job {
+  int session;
+  uint64_t tag;
+  char* line;  // malloc'd copy, freed by the worker
+};
+
+/**
+ * @brief Bounded lock-free multi-producer queue
+ *
+ * Vyukov's array queue: each cell carries a sequence number that tells
+ * producers and the consumer whose turn it is, so neither side locks.
+ * Only one worker consumes from each queue.
+ */
+class JobQueue {
+ public:
+  JobQueue() : cells_(nullptr), mask_(0), enqueue_pos_(0), dequeue_pos_(0) {}
+
+  ~JobQueue() {
+    delete[] cells_;
+  }
+
+  bool init(size_t capacity) {
+    cells_ = new (std::nothrow) Cell[capacity];
+    if (!cells_) {
+      return false;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mask_ = capacity - 1;
+    return true;
+  }
+
+  bool push(const Job& job) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell* cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell->job = job;
+          cell->seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool pop(Job* out) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = &cells_[pos & mask_];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+    if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) {
+      return false;  // Empty
+    }
+    *out = cell->job;
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool empty() const {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const Cell* cell = &cells_[pos & mask_];
+    return (intptr_t) cell->seq.load(std::memory_order_acquire) - (intptr_t) (pos + 1) < 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    Job job;
+  };
+
+  Cell* cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+struct Session {
+  uint8_t* vm_mem;
+  struct Vm* vm;
+  V4FrontContext* front_ctx;
+  V4ReplContext* repl;
+
+  // Output of the line being processed (filled by the sink)
+  char* out;
+  size_t out_len;
+  size_t out_cap;
+};
+
+struct Worker {
+  V4ReplPool* pool;
+  int index;
+  std::thread thread;
+  JobQueue queue;
+
+  // Only used to park an idle worker; submission stays lock-free
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<bool> sleeping{false};
+};
+
+}  // namespace
+
+struct V4ReplPool {
+  V4ReplPoolResultFn on_result;
+  void* user;
+
+  Session* sessions;
+  int session_count;
+
+  Worker* workers;
+  int worker_count;
+  bool pin_workers;
+
+  std::atomic<bool> stopping{false};
+
+  // Lines submitted but not yet reported
+  std::atomic<uint64_t> outstanding{0};
+  std::mutex idle_mutex;
+  std::condition_variable idle_cv;
+};
+
+static void session_write(void* user, const char* data, size_t len) {
+  Session* s = static_cast<Session*>(user);
+  if (s->out_len + len > s->out_cap) {
+    size_t new_cap = (s->out_cap == 0) ? 256 : s->out_cap;
+    while (new_cap < s->out_len + len) {
+      new_cap *= 2;
+    }
+    char* new_out = (char*) realloc(s->out, new_cap);
+    if (!new_out) {
+      return;  // Output truncated
+    }
+    s->out = new_out;
+    s->out_cap = new_cap;
+  }
+  memcpy(s->out + s->out_len, data, len);
+  s->out_len += len;
+}
+
+static bool session_init(Session* s, size_t vm_mem_size) {
+  s->vm_mem = (uint8_t*) calloc(1, vm_mem_size);
+  if (!s->vm_mem) {
+    return false;
+  }
+
+  VmConfig cfg = {0};
+  cfg.mem = s->vm_mem;
+  cfg.mem_size = vm_mem_size;
+  cfg.mmio = nullptr;
+  cfg.mmio_count = 0;
+  cfg.arena = nullptr;
+
+  s->vm = vm_create(&cfg);
+  if (!s->vm) {
+    return false;
+  }
+
+  s->front_ctx = v4front_context_create();
+  if (!s->front_ctx) {
+    return false;
+  }
+
+  V4ReplConfig repl_cfg;
+  memset(&repl_cfg, 0, sizeof(repl_cfg));
+  repl_cfg.vm = s->vm;
+  repl_cfg.front_ctx = s->front_ctx;
+  repl_cfg.write = session_write;
+  repl_cfg.write_user = s;
+
+  s->repl = v4_repl_create(&repl_cfg);
+  return s->repl != nullptr;
+}
+
+static void session_free(Session* s) {
+  if (s->repl) {
+    v4_repl_destroy(s->repl);
+  }
+  if (s->front_ctx) {
+    v4front_context_destroy(s->front_ctx);
+  }
+  if (s->vm) {
+    vm_destroy(s->vm);
+  }
+  free(s->vm_mem);
+  free(s->out);
+}
+
+static void run_job(V4ReplPool* pool, const Job& job) {
+  Session* s = &pool->sessions[job.session];
+
+  s->out_len = 0;
+  v4_err err = v4_repl_process_line(s->repl, job.line);
+  if (err == 0) {
+    v4_repl_print_stack(s->repl);
+  } else {
+    v4_repl_print_error(s->repl);
+  }
+  free(job.line);
+
+  if (pool->on_result) {
+    pool->on_result(pool->user, job.session, job.tag, err, s->out, s->out_len);
+  }
+
+  if (pool->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::lock_guard<std::mutex> lock(pool->idle_mutex);
+    pool->idle_cv.notify_all();
+  }
+}
+
+static void pin_to_cpu(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % CPU_SETSIZE, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void) cpu;
+#endif
+}
+
+static void worker_main(Worker* w) {
+  V4ReplPool* pool = w->pool;
+  if (pool->pin_workers) {
+    pin_to_cpu(w->index);
+  }
+
+  int idle_spins = 0;
+  while (true) {
+    Job job;
+    if (w->queue.pop(&job)) {
+      run_job(pool, job);
+      idle_spins = 0;
+      continue;
+    }
+
+    if (pool->stopping.load(std::memory_order_acquire)) {
+      // Queue drained after stop was requested
+      if (w->queue.empty()) {
+        break;
+      }
+      continue;
+    }
+
+    // Briefly spin before parking: bursts of lines avoid a wakeup each
+    if (++idle_spins < SPIN_BEFORE_SLEEP) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(w->mutex);
+    w->sleeping.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // Pairs with wake()
+    w->cv.wait(lock, [&] {
+      return !w->queue.empty() || pool->stopping.load(std::memory_order_acquire);
+    });
+    w->sleeping.store(false, std::memory_order_relaxed);
+    idle_spins = 0;
+  }
+}
+
+static void wake(Worker* w) {
+  // Either the worker sees the pushed job before parking, or we see it asleep
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (w->sleeping.load(std::memory_order_seq_cst)) {
+    std::lock_guard<std::mutex> lock(w->mutex);
+    w->cv.notify_one();
+  }
+}
+
+V4ReplPool* v4_repl_pool_create(const V4ReplPoolConfig* config) {
+  if (!config) {
+    return nullptr;
+  }
+
+  int workers = config->workers;
+  if (workers <= 0) {
+    workers = (int) std::thread::hardware_concurrency();
+    if (workers <= 0) {
+      workers = 1;
+    }
+  }
+  int sessions = (config->sessions > 0) ? config->sessions : workers;
+  size_t vm_mem_size = (config->vm_mem_size > 0) ? config->vm_mem_size : DEFAULT_VM_MEM_SIZE;
+  size_t queue_capacity =
+      (config->queue_capacity > 0) ? config->queue_capacity : DEFAULT_QUEUE_CAPACITY;
+  if ((queue_capacity & (queue_capacity - 1)) != 0 || queue_capacity < 2) {
+    return nullptr;  // Must be a power of two
+  }
+
+  V4ReplPool* pool = new (std::nothrow) V4ReplPool;
+  if (!pool) {
+    return nullptr;
+  }
+  pool->on_result = config->on_result;
+  pool->user = config->user;
+  pool->pin_workers = config->pin_workers != 0;
+  pool->workers = nullptr;
+  pool->worker_count = 0;
+  pool->session_count = 0;
+
+  pool->sessions = (Session*) calloc(sessions, sizeof(Session));
+  if (!pool->sessions) {
+    delete pool;
+    return nullptr;
+  }
+  for (int i = 0; i < sessions; i++) {
+    pool->session_count = i + 1;
+    if (!session_init(&pool->sessions[i], vm_mem_size)) {
+      v4_repl_pool_destroy(pool);
+      return nullptr;
+    }
+  }
+
+  pool->workers = new (std::nothrow) Worker[workers];
+  if (!pool->workers) {
+    v4_repl_pool_destroy(pool);
+    return nullptr;
+  }
+  for (int i = 0; i < workers; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    if (!pool->workers[i].queue.init(queue_capacity)) {
+      v4_repl_pool_destroy(pool);
+      return nullptr;
+    }
+  }
+
+  // Start threads only once every queue exists
+  for (int i = 0; i < workers; i++) {
+    pool->workers[i].thread = std::thread(worker_main, &pool->workers[i]);
+    pool->worker_count = i + 1;
+  }
+
+  return pool;
+}
+
+void v4_repl_pool_destroy(V4ReplPool* pool) {
+  if (!pool) {
+    return;
+  }
+
+  pool->stopping.store(true, std::memory_order_release);
+  for (int i = 0; i < pool->worker_count; i++) {
+    Worker* w = &pool->workers[i];
+    {
+      std::lock_guard<std::mutex> lock(w->mutex);
+      w->cv.notify_one();
+    }
+    w->thread.join();
+  }
+  delete[] pool->workers;
+
+  for (int i = 0; i < pool->session_count; i++) {
+    session_free(&pool->sessions[i]);
+  }
+  free(pool->sessions);
+
+  delete pool;
+}
+
+int v4_repl_pool_submit(V4ReplPool* pool, int session, const char* line, uint64_t tag) {
+  if (!pool || !line || session < 0 || session >= pool->session_count) {
+    return V4_REPL_POOL_ERR_SESSION;
+  }
+
+  size_t len = strlen(line);
+  char* copy = (char*) malloc(len + 1);
+  if (!copy) {
+    return V4_REPL_POOL_ERR_NOMEM;
+  }
+  memcpy(copy, line, len + 1);
+
+  Job job;
+  job.session = session;
+  job.tag = tag;
+  job.line = copy;
+
+  // Count first so wait_idle() never sees a queued job as finished
+  pool->outstanding.fetch_add(1, std::memory_order_acq_rel);
+
+  Worker* w = &pool->workers[session % pool->worker_count];
+  if (!w->queue.push(job)) {
+    free(copy);
+    if (pool->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::lock_guard<std::mutex> lock(pool->idle_mutex);
+      pool->idle_cv.notify_all();
+    }
+    return V4_REPL_POOL_ERR_FULL;
+  }
+
+  wake(w);
+  return 0;
+}
+
+void v4_repl_pool_interrupt(V4ReplPool* pool, int session) {
+  if (!pool || session < 0 || session >= pool->session_count) {
+    return;
+  }
+  v4_repl_interrupt(pool->sessions[session].repl);
+}
+
+void v4_repl_pool_wait_idle(V4ReplPool* pool) {
+  if (!pool) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(pool->idle_mutex);
+  pool->idle_cv.wait(lock,
+                     [&] { return pool->outstanding.load(std::memory_order_acquire) == 0; });
+}
+
+int v4_repl_pool_session_count(const V4ReplPool* pool) {
+  return pool ? pool->session_count : 0;
+}
+
+int v4_repl_pool_worker_count(const V4ReplPool* pool) {
+  return pool ? pool->worker_count : 0;
+}
+
+V4ReplContext* v4_repl_pool_context(V4ReplPool* pool, int session) {
+  if (!pool || session < 0 || session >= pool->session_count) {
+    return nullptr;
+  }
+  return pool->sessions[session].repl;
+}
@@ -0,0 +1,341 @@
+#include "profiler.hpp"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Sample buffer filled by the signal handler and drained after each
+// execution. Only the innermost frames are kept.
+static const int MAX_SAMPLE_FRAMES = 16;
+static const int MAX_SAMPLES = 4096;
+static const int RS_CAPACITY = 64;
+
+struct RawSample {
+  int depth;
+  int32_t frames[MAX_SAMPLE_FRAMES];  // Innermost return address first
+};
+
+static RawSample g_samples[MAX_SAMPLES];
+
+#ifndef _WIN32
+static volatile sig_atomic_t g_sample_count = 0;
+static volatile sig_atomic_t g_sample_dropped = 0;
+static struct Vm* volatile g_sample_vm = nullptr;  // Non-null while executing
+static struct sigaction g_old_sigprof;
+
+static void sigprof_handler(int sig) {
+  (void) sig;
+
+  struct Vm* vm = g_sample_vm;
+  if (!vm) {
+    return;  // Timer fired outside VM execution
+  }
+
+  int n = g_sample_count;
+  if (n >= MAX_SAMPLES) {
+    g_sample_dropped = g_sample_dropped + 1;
+    return;
+  }
+
+  // Plain copy of VM state; no allocation or locking
+  v4_i32 rs[RS_CAPACITY];
+  int depth = vm_rs_copy_to_array(vm, rs, RS_CAPACITY);
+  if (depth < 0) {
+    depth = 0;
+  }
+
+  RawSample* s = &g_samples[n];
+  int keep = (depth < MAX_SAMPLE_FRAMES) ? depth : MAX_SAMPLE_FRAMES;
+  for (int i = 0; i < keep; i++) {
+    s->frames[i] = rs[depth - 1 - i];
+  }
+  s->depth = keep;
+
+  g_sample_count = n + 1;
+}
+#endif
+
+Profiler::Profiler()
+    : running_(false),
+      hz_(0),
+      self_(nullptr),
+      incl_(nullptr),
+      counter_capacity_(0),
+      top_level_(0),
+      unresolved_(0),
+      dropped_(0),
+      total_(0) {}
+
+Profiler::~Profiler() {
+  stop();
+  free(self_);
+  free(incl_);
+}
+
+bool Profiler::supported() {
+#ifndef _WIN32
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool Profiler::start(unsigned int hz) {
+#ifndef _WIN32
+  if (running_ || hz == 0) {
+    return false;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sigprof_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &sa, &g_old_sigprof) != 0) {
+    return false;
+  }
+
+  long usec = 1000000L / (long) hz;
+  if (usec <= 0) {
+    usec = 1;
+  }
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = usec / 1000000L;
+  timer.it_interval.tv_usec = usec % 1000000L;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    sigaction(SIGPROF, &g_old_sigprof, nullptr);
+    return false;
+  }
+
+  running_ = true;
+  hz_ = hz;
+  return true;
+#else
+  (void) hz;
+  return false;
+#endif
+}
+
+void Profiler::stop() {
+#ifndef _WIN32
+  if (!running_) {
+    return;
+  }
+
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  sigaction(SIGPROF, &g_old_sigprof, nullptr);
+
+  g_sample_vm = nullptr;
+  running_ = false;
+#endif
+}
+
+void Profiler::reset() {
+  if (self_) {
+    memset(self_, 0, counter_capacity_ * sizeof(uint32_t));
+  }
+  if (incl_) {
+    memset(incl_, 0, counter_capacity_ * sizeof(uint32_t));
+  }
+  top_level_ = 0;
+  unresolved_ = 0;
+  dropped_ = 0;
+  total_ = 0;
+}
+
+void Profiler::begin_exec(struct Vm* vm) {
+#ifndef _WIN32
+  if (!running_) {
+    return;
+  }
+
+  g_sample_count = 0;
+  g_sample_dropped = 0;
+  g_sample_vm = vm;
+#else
+  (void) vm;
+#endif
+}
+
+void Profiler::end_exec(const CodeMap& map) {
+#ifndef _WIN32
+  if (!running_ || !g_sample_vm) {
+    return;
+  }
+
+  // From here on the handler ignores the timer
+  g_sample_vm = nullptr;
+
+  int count = g_sample_count;
+  dropped_ += (uint32_t) g_sample_dropped;
+
+  for (int i = 0; i < count; i++) {
+    record(map, g_samples[i].frames, g_samples[i].depth);
+  }
+
+  g_sample_count = 0;
+#else
+  (void) map;
+#endif
+}
+
+bool Profiler::ensure_counters(int wid) {
+  if (wid < counter_capacity_) {
+    return true;
+  }
+
+  int new_cap = (counter_capacity_ == 0) ? 64 : counter_capacity_;
+  while (new_cap <= wid) {
+    new_cap *= 2;
+  }
+
+  uint32_t* new_self = (uint32_t*) realloc(self_, new_cap * sizeof(uint32_t));
+  if (!new_self) {
+    return false;
+  }
+  self_ = new_self;
+
+  uint32_t* new_incl = (uint32_t*) realloc(incl_, new_cap * sizeof(uint32_t));
+  if (!new_incl) {
+    return false;
+  }
+  incl_ = new_incl;
+
+  size_t grown = (size_t) (new_cap - counter_capacity_) * sizeof(uint32_t);
+  memset(self_ + counter_capacity_, 0, grown);
+  memset(incl_ + counter_capacity_, 0, grown);
+  counter_capacity_ = new_cap;
+  return true;
+}
+
+void Profiler::record(const CodeMap& map, const int32_t* frames, int depth) {
+  total_++;
+
+  if (depth == 0) {
+    top_level_++;
+    return;
+  }
+
+  // Self: the word entered by the innermost CALL
+  const CodeMap::Range* caller = map.find((uint32_t) frames[0]);
+  int running = caller ? CodeMap::callee_at(caller, (uint32_t) frames[0]) : -1;
+  if (running < 0 || !ensure_counters(running)) {
+    unresolved_++;
+    return;
+  }
+  self_[running]++;
+
+  // Inclusive: the running word and every word on the chain, once each
+  // (recursive words appear many times in one sample)
+  int seen[MAX_SAMPLE_FRAMES + 1];
+  int seen_count = 0;
+  seen[seen_count++] = running;
+
+  for (int i = 0; i < depth; i++) {
+    const CodeMap::Range* r = map.find((uint32_t) frames[i]);
+    if (!r || r->wid < 0) {
+      continue;
+    }
+
+    bool dup = false;
+    for (int j = 0; j < seen_count; j++) {
+      if (seen[j] == r->wid) {
+        dup = true;
+        break;
+      }
+    }
+    if (!dup) {
+      seen[seen_count++] = r->wid;
+    }
+  }
+
+  for (int j = 0; j < seen_count; j++) {
+    if (ensure_counters(seen[j])) {
+      incl_[seen[j]]++;
+    }
+  }
+}
+
+struct HotEntry {
+  int wid;
+  uint32_t self;
+  uint32_t incl;
+};
+
+static int compare_hot(const void* a, const void* b) {
+  const HotEntry* x = (const HotEntry*) a;
+  const HotEntry* y = (const HotEntry*) b;
+  if (x->self != y->self) {
+    return (x->self < y->self) ? 1 : -1;
+  }
+  if (x->incl != y->incl) {
+    return (x->incl < y->incl) ? 1 : -1;
+  }
+  return x->wid - y->wid;
+}
+
+void Profiler::print_hot(const V4ReplWordIndex& words, int limit) const {
+  if (total_ == 0) {
+    printf("No samples collected.\n");
+    if (!running_) {
+      printf("Use '.sampling on' to start the profiler, then run some code.\n");
+    }
+    return;
+  }
+
+  HotEntry* entries = (HotEntry*) malloc((counter_capacity_ + 1) * sizeof(HotEntry));
+  if (!entries) {
+    printf("Out of memory\n");
+    return;
+  }
+
+  int count = 0;
+  for (int wid = 0; wid < counter_capacity_; wid++) {
+    if (self_[wid] > 0 || incl_[wid] > 0) {
+      entries[count].wid = wid;
+      entries[count].self = self_[wid];
+      entries[count].incl = incl_[wid];
+      count++;
+    }
+  }
+  qsort(entries, count, sizeof(HotEntry), compare_hot);
+
+  printf("Hot words (%u samples at %u Hz):\n", total_, hz_);
+  printf("   Self%%     Self     Incl  Word\n");
+  printf("  ------  -------  -------  ----------------\n");
+
+  int shown = (limit > 0 && limit < count) ? limit : count;
+  for (int i = 0; i < shown; i++) {
+    const char* name = v4repl_index_name(&words, entries[i].wid);
+    printf("  %5.1f%%  %7u  %7u  ", 100.0 * entries[i].self / total_, entries[i].self,
+           entries[i].incl);
+    if (name) {
+      printf("%s\n", name);
+    } else {
+      printf("<wid %d>\n", entries[i].wid);
+    }
+  }
+
+  if (shown < count) {
+    printf("  ... %d more\n", count - shown);
+  }
+
+  printf("\n  Top-level code: %u samples\n", top_level_);
+  if (unresolved_ > 0) {
+    printf("  Unattributed:   %u samples\n", unresolved_);
+  }
+  if (dropped_ > 0) {
+    printf("  Dropped:        %u samples (buffer full)\n", dropped_);
+  }
+
+  free(entries);
+}
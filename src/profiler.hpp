@@ -0,0 +1,141 @@
+#pragma once
+
+#include <v4/vm_api.h>
+#include <v4front/compile.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "code_map.hpp"
+#include "word_index.h"
+
+/**
+ * @brief Sampling profiler for bytecode executed by the REPL
+ *
+ * While enabled, a SIGPROF interval timer samples the VM return stack
+ * during execution. Each sample is attributed to dictionary words:
+ * - self: the word that was running when the timer fired
+ * - inclusive: every word on the call chain at that moment
+ *
+ * The running word is recovered from the innermost return address,
+ * which points just past the CALL that entered it. Samples taken in
+ * top-level line code (no call in progress) are counted separately.
+ *
+ * Sampling is only available on POSIX systems (setitimer/SIGPROF).
+ * Only one profiler can be active per process.
+ */
+class Profiler {
+ public:
+  Profiler();
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  /**
+   * @brief Check whether sampling is supported on this platform
+   */
+  static bool supported();
+
+  /**
+   * @brief Start sampling
+   *
+   * @param hz Sampling frequency (samples per second of CPU time)
+   * @return true on success, false if unsupported or the timer failed
+   */
+  bool start(unsigned int hz);
+
+  /**
+   * @brief Stop sampling (collected counts are kept)
+   */
+  void stop();
+
+  /**
+   * @brief Discard all collected counts
+   */
+  void reset();
+
+  /**
+   * @brief Check whether sampling is currently enabled
+   */
+  bool running() const {
+    return running_;
+  }
+
+  /**
+   * @brief Sampling frequency passed to start()
+   */
+  unsigned int hz() const {
+    return hz_;
+  }
+
+  /**
+   * @brief Mark the start of a VM execution
+   *
+   * Samples are only recorded between begin_exec() and end_exec().
+   *
+   * @param vm VM about to execute
+   */
+  void begin_exec(struct Vm* vm);
+
+  /**
+   * @brief Mark the end of a VM execution and attribute its samples
+   *
+   * @param map Code ranges of all words and of the executed top-level code
+   */
+  void end_exec(const CodeMap& map);
+
+  /**
+   * @brief Attribute one sample to words (end_exec() does this for each sample)
+   *
+   * @param map Code ranges the return addresses are resolved against
+   * @param frames Return addresses, innermost first
+   * @param depth Number of entries in @p frames (0 = in top-level code)
+   */
+  void record(const CodeMap& map, const int32_t* frames, int depth);
+
+  /**
+   * @brief Samples taken while @p wid itself was running
+   */
+  uint32_t self_samples(int wid) const {
+    return (wid >= 0 && wid < counter_capacity_) ? self_[wid] : 0;
+  }
+
+  /**
+   * @brief Samples taken while @p wid was anywhere on the call chain
+   */
+  uint32_t inclusive_samples(int wid) const {
+    return (wid >= 0 && wid < counter_capacity_) ? incl_[wid] : 0;
+  }
+
+  /**
+   * @brief Samples taken in top-level line code
+   */
+  uint32_t top_level_samples() const {
+    return top_level_;
+  }
+
+  /**
+   * @brief Print words sorted by self samples
+   *
+   * @param words Index used to name words (shadowed definitions included)
+   * @param limit Maximum number of words to print (0 = all)
+   */
+  void print_hot(const V4ReplWordIndex& words, int limit) const;
+
+ private:
+  bool running_;
+  unsigned int hz_;
+
+  // Per-word counters, indexed by VM word ID
+  uint32_t* self_;
+  uint32_t* incl_;
+  int counter_capacity_;
+
+  uint32_t top_level_;     // Samples in top-level line code
+  uint32_t unresolved_;    // Samples whose call chain could not be mapped
+  uint32_t dropped_;       // Samples lost to a full sample buffer
+  uint32_t total_;         // All recorded samples
+
+  bool ensure_counters(int wid);
+};
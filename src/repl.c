@@ -1,9 +1,23 @@
 #include "v4repl/repl.h"
 
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "batch_load.h"
+#include "lazy_defs.h"
+#include "out_buf.h"
+#include "snapshot.h"
+#include "vm_word.h"
+#include "word_index.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 /* Version: 0.4.0 */
 #define V4_REPL_VERSION 0x000400
 
@@ -11,6 +25,33 @@
 #define DEFAULT_LINE_BUFFER_SIZE 512
 #define DEFAULT_ERROR_BUFFER_SIZE 512
 #define WORD_BUF_INITIAL_CAPACITY 16
+#define CODE_ARENA_ALIGN 4
+#define OUT_LOCAL_BUFFER_SIZE 128
+
+/**
+ * @brief Steps a line goes through (see v4_repl_poll())
+ */
+typedef enum V4ReplStep {
+  STEP_IDLE = 0, /* No line pending */
+  STEP_COMPILE,  /* Look up the cache or compile the line */
+  STEP_REGISTER, /* Register the next word definition */
+  STEP_EXEC,     /* Execute the top-level code */
+} V4ReplStep;
+
+/**
+ * @brief State of the line being processed
+ */
+typedef struct V4ReplJob {
+  V4ReplStep step;
+  const char* line;            /* Source text (line_buf for submitted lines) */
+  uint32_t line_hash;          /* Cache key (valid when the cache is enabled) */
+  V4FrontBuf buf;              /* Compiler output */
+  int owns_buf;                /* buf must be freed when the line finishes */
+  int next_word;               /* Next definition to register */
+  const V4FrontBuf* main_code; /* Top-level code to execute */
+  V4ReplDoneFn on_done;        /* Completion callback (submitted lines only) */
+  void* on_done_user;
+} V4ReplJob;
 
 /**
  * @brief Internal REPL context structure
@@ -31,12 +72,238 @@ struct V4ReplContext {
   V4FrontBuf* word_bufs;
   int word_buf_count;
   int word_buf_capacity;
+
+  /* Caller-provided arena for definition bytecode (replaces word_bufs) */
+  uint8_t* code_arena;
+  size_t code_arena_size;
+  size_t code_arena_used;
+
+  /* Every registered word, for session images */
+  V4ReplDefLog defs;
+  uint8_t* image_code; /* Heap copy of restored bytecode (NULL if none) */
+
+  /* Name <-> word ID lookup, kept in step with registrations */
+  V4ReplWordIndex words;
+
+  /* Definitions recorded but not compiled yet (lazy_definitions mode) */
+  int lazy_enabled;
+  V4ReplLazyTable lazy;
+
+  /* VM RAM included in session images (optional, borrowed) */
+  uint8_t* vm_mem;
+  size_t vm_mem_size;
+
+  /* Set by v4_repl_interrupt() from any thread or signal handler
+     (sig_atomic_t rather than C11 atomics, which MSVC does not compile) */
+  volatile sig_atomic_t interrupt_requested;
+
+  /* Line in progress and the clock that bounds v4_repl_poll() */
+  V4ReplJob job;
+  uint64_t (*clock_ns)(void);
+
+  /* Output sink */
+  V4ReplWriteFn write;
+  void* write_user;
+  char* out_buf;
+  size_t out_buf_size;
+
+  /* Dictionary generation (bumped whenever definitions change) */
+  uint32_t dict_generation;
+
+  /* Compiled-line LRU cache (disabled when cache_capacity == 0) */
+  struct V4ReplCacheEntry* cache;
+  size_t cache_capacity;
+  size_t cache_count;
+  uint64_t cache_tick;
+  uint64_t cache_hits;
+  uint64_t cache_misses;
+
+#if V4_REPL_ENABLE_STATS
+  /* Per-phase instrumentation */
+  V4ReplStats stats;
+#endif
 };
 
+/**
+ * @brief Cached compilation result of one top-level line
+ */
+typedef struct V4ReplCacheEntry {
+  uint32_t hash;       /* Hash of line text and dictionary generation */
+  uint32_t generation; /* Dictionary generation the line was compiled against */
+  uint64_t last_used;  /* LRU tick */
+  char* line;          /* Owned copy of the source line */
+  V4FrontBuf buf;      /* Compiled code (never contains word definitions) */
+} V4ReplCacheEntry;
+
+/* ------------------------------------------------------------------------- */
+/* Instrumentation                                                           */
+/* ------------------------------------------------------------------------- */
+
+static uint64_t default_clock_ns(void) {
+#ifdef _WIN32
+  LARGE_INTEGER freq, now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (uint64_t) ((double) now.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+#if V4_REPL_ENABLE_STATS
+
+static void stats_count_error(V4ReplContext* ctx, int code) {
+  int slot = -code;
+  if (slot <= 0 || slot >= V4_REPL_STATS_ERROR_SLOTS) {
+    slot = 0; /* Out-of-range codes share slot 0 */
+  }
+  ctx->stats.errors++;
+  ctx->stats.error_counts[slot]++;
+}
+
+#define STATS_CLOCK(ctx) ((ctx)->clock_ns())
+#define STATS_RECORD(ctx, phase, start)              \
+  do {                                               \
+    uint64_t elapsed_ = (ctx)->clock_ns() - (start); \
+    (ctx)->stats.phase##_ns_last += elapsed_;        \
+    (ctx)->stats.phase##_ns_total += elapsed_;       \
+  } while (0)
+#define STATS_COUNT(ctx, field, n) ((ctx)->stats.field += (uint64_t) (n))
+#define STATS_ERROR(ctx, code) stats_count_error((ctx), (code))
+#define STATS_BEGIN_LINE(ctx)          \
+  do {                                 \
+    (ctx)->stats.lines++;              \
+    (ctx)->stats.compile_ns_last = 0;  \
+    (ctx)->stats.register_ns_last = 0; \
+    (ctx)->stats.exec_ns_last = 0;     \
+  } while (0)
+
+#else /* !V4_REPL_ENABLE_STATS */
+
+#define STATS_CLOCK(ctx) ((uint64_t) 0)
+#define STATS_RECORD(ctx, phase, start) ((void) (start))
+#define STATS_COUNT(ctx, field, n) ((void) 0)
+#define STATS_ERROR(ctx, code) ((void) 0)
+#define STATS_BEGIN_LINE(ctx) ((void) 0)
+
+#endif /* V4_REPL_ENABLE_STATS */
+
+/* ------------------------------------------------------------------------- */
+/* Bytecode cache                                                            */
+/* ------------------------------------------------------------------------- */
+
+/* FNV-1a over the line text, seeded with the dictionary generation */
+static uint32_t cache_hash(const char* line, uint32_t generation) {
+  uint32_t h = 2166136261u ^ generation;
+  for (; *line; ++line) {
+    h ^= (uint8_t) *line;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void cache_entry_free(V4ReplCacheEntry* entry) {
+  free(entry->line);
+  v4front_free(&entry->buf);
+  memset(entry, 0, sizeof(*entry));
+}
+
+/* The cache is small, so a linear scan over hashes beats a hash table */
+static V4ReplCacheEntry* cache_find(V4ReplContext* ctx, const char* line, uint32_t hash) {
+  for (size_t i = 0; i < ctx->cache_count; ++i) {
+    V4ReplCacheEntry* entry = &ctx->cache[i];
+    if (entry->hash == hash && entry->generation == ctx->dict_generation &&
+        strcmp(entry->line, line) == 0) {
+      entry->last_used = ++ctx->cache_tick;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Takes ownership of *buf on success; returns NULL if the line could not be copied */
+static V4ReplCacheEntry* cache_insert(V4ReplContext* ctx, const char* line, uint32_t hash,
+                                      const V4FrontBuf* buf) {
+  size_t len = strlen(line);
+  char* copy = (char*) malloc(len + 1);
+  if (!copy) {
+    return NULL;
+  }
+  memcpy(copy, line, len + 1);
+
+  V4ReplCacheEntry* entry;
+  if (ctx->cache_count < ctx->cache_capacity) {
+    entry = &ctx->cache[ctx->cache_count++];
+  } else {
+    /* Evict the least recently used entry */
+    entry = &ctx->cache[0];
+    for (size_t i = 1; i < ctx->cache_count; ++i) {
+      if (ctx->cache[i].last_used < entry->last_used) {
+        entry = &ctx->cache[i];
+      }
+    }
+    cache_entry_free(entry);
+  }
+
+  entry->hash = hash;
+  entry->generation = ctx->dict_generation;
+  entry->last_used = ++ctx->cache_tick;
+  entry->line = copy;
+  entry->buf = *buf;
+  return entry;
+}
+
+static void cache_flush(V4ReplContext* ctx) {
+  for (size_t i = 0; i < ctx->cache_count; ++i) {
+    cache_entry_free(&ctx->cache[i]);
+  }
+  ctx->cache_count = 0;
+}
+
+/* Called whenever word IDs or names may have changed */
+static void dictionary_changed(V4ReplContext* ctx) {
+  ctx->dict_generation++;
+  /* Entries from older generations can never hit again; release them now */
+  cache_flush(ctx);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Code arena                                                                */
+/* ------------------------------------------------------------------------- */
+
+static size_t code_arena_align(size_t n) {
+  return (n + CODE_ARENA_ALIGN - 1) & ~(size_t) (CODE_ARENA_ALIGN - 1);
+}
+
+/* Caller must have checked that the arena has room */
+static const uint8_t* code_arena_copy(V4ReplContext* ctx, const uint8_t* code, size_t len) {
+  uint8_t* dst = ctx->code_arena + ctx->code_arena_used;
+  memcpy(dst, code, len);
+  ctx->code_arena_used += code_arena_align(len);
+  return dst;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Output sink                                                               */
+/* ------------------------------------------------------------------------- */
+
+/* Start a line of output in the caller's buffer, or in local storage */
+static void out_begin(const V4ReplContext* ctx, V4ReplOutBuf* out, char* local) {
+  if (ctx->out_buf) {
+    v4repl_out_init(out, ctx->out_buf, ctx->out_buf_size, ctx->write, ctx->write_user);
+  } else {
+    v4repl_out_init(out, local, OUT_LOCAL_BUFFER_SIZE, ctx->write, ctx->write_user);
+  }
+}
+
 /* ------------------------------------------------------------------------- */
 /* Lifecycle                                                                 */
 /* ------------------------------------------------------------------------- */
 
+static void job_end(V4ReplContext* ctx);
+
 V4ReplContext* v4_repl_create(const V4ReplConfig* config) {
   if (!config || !config->vm || !config->front_ctx) {
     return NULL;
@@ -50,6 +317,23 @@ V4ReplContext* v4_repl_create(const V4ReplConfig* config) {
   /* Store VM and compiler context references */
   ctx->vm = config->vm;
   ctx->front_ctx = config->front_ctx;
+  ctx->interrupt_requested = 0;
+
+  ctx->clock_ns = config->clock_ns ? config->clock_ns : default_clock_ns;
+  ctx->lazy_enabled = config->lazy_definitions != 0;
+
+  if (config->vm_mem && config->vm_mem_size > 0) {
+    ctx->vm_mem = config->vm_mem;
+    ctx->vm_mem_size = config->vm_mem_size;
+  }
+
+  /* Output sink (stdout unless the platform provides one) */
+  ctx->write = config->write ? config->write : v4repl_out_stdout;
+  ctx->write_user = config->write_user;
+  if (config->out_buf && config->out_buf_size > 0) {
+    ctx->out_buf = config->out_buf;
+    ctx->out_buf_size = config->out_buf_size;
+  }
 
   /* Allocate line buffer */
   ctx->line_buf_size =
@@ -70,17 +354,43 @@ V4ReplContext* v4_repl_create(const V4ReplConfig* config) {
   }
   ctx->error_buf[0] = '\0';
 
-  /* Initialize word buffer tracking */
-  ctx->word_buf_capacity = WORD_BUF_INITIAL_CAPACITY;
-  ctx->word_bufs = (V4FrontBuf*) calloc(ctx->word_buf_capacity, sizeof(V4FrontBuf));
-  if (!ctx->word_bufs) {
-    free(ctx->error_buf);
-    free(ctx->line_buf);
-    free(ctx);
-    return NULL;
+  /* Definitions go either to the caller's arena or to tracked heap buffers */
+  if (config->code_arena && config->code_arena_size > 0) {
+    ctx->code_arena = config->code_arena;
+    ctx->code_arena_size = config->code_arena_size;
+    ctx->code_arena_used = 0;
+  } else {
+    ctx->word_buf_capacity = WORD_BUF_INITIAL_CAPACITY;
+    ctx->word_bufs = (V4FrontBuf*) calloc(ctx->word_buf_capacity, sizeof(V4FrontBuf));
+    if (!ctx->word_bufs) {
+      free(ctx->error_buf);
+      free(ctx->line_buf);
+      free(ctx);
+      return NULL;
+    }
   }
   ctx->word_buf_count = 0;
 
+  /* Allocate bytecode cache (optional) */
+  if (config->bytecode_cache_size > 0) {
+    ctx->cache = (V4ReplCacheEntry*) calloc(config->bytecode_cache_size, sizeof(V4ReplCacheEntry));
+    if (!ctx->cache) {
+      free(ctx->word_bufs);
+      free(ctx->error_buf);
+      free(ctx->line_buf);
+      free(ctx);
+      return NULL;
+    }
+    ctx->cache_capacity = config->bytecode_cache_size;
+  }
+
+  /* Register a precompiled bundle without running the compiler */
+  if (config->preload && config->preload_size > 0 &&
+      v4_repl_restore(ctx, config->preload, config->preload_size, V4_REPL_RESTORE_IN_PLACE) != 0) {
+    v4_repl_destroy(ctx);
+    return NULL;
+  }
+
   return ctx;
 }
 
@@ -89,11 +399,22 @@ void v4_repl_destroy(V4ReplContext* ctx) {
     return;
   }
 
+  /* Drop a submitted line that was never polled to completion */
+  job_end(ctx);
+
   /* Free all tracked word definition buffers */
   for (int i = 0; i < ctx->word_buf_count; ++i) {
     v4front_free(&ctx->word_bufs[i]);
   }
   free(ctx->word_bufs);
+  v4repl_deflog_free(&ctx->defs);
+  v4repl_index_free(&ctx->words);
+  v4repl_lazy_free(&ctx->lazy);
+  free(ctx->image_code);
+
+  /* Free cached bytecode */
+  cache_flush(ctx);
+  free(ctx->cache);
 
   /* Free buffers */
   free(ctx->error_buf);
@@ -107,131 +428,569 @@ void v4_repl_destroy(V4ReplContext* ctx) {
 /* Core REPL operations                                                      */
 /* ------------------------------------------------------------------------- */
 
-v4_err v4_repl_process_line(V4ReplContext* ctx, const char* line) {
-  if (!ctx || !line) {
-    return -1;
+/* Consume a pending interrupt request; clears the data stack if there was one */
+static int take_interrupt(V4ReplContext* ctx) {
+  if (!ctx->interrupt_requested) {
+    return 0;
+  }
+  /* A request arriving between the test and the clear is the same interrupt */
+  ctx->interrupt_requested = 0;
+  vm_ds_clear(ctx->vm);
+  snprintf(ctx->error_buf, ctx->error_buf_size, "Interrupted");
+  return 1;
+}
+
+/* Execute the top-level code of a compiled line */
+static v4_err exec_main_code(V4ReplContext* ctx, const V4FrontBuf* buf) {
+  if (!buf->data || buf->size == 0) {
+    return 0;
   }
 
+  if (take_interrupt(ctx)) {
+    return V4_REPL_ERR_INTERRUPTED;
+  }
+
+  /* Executed without registering it (a dictionary entry per line would
+     leak one VM word slot for every evaluated line) */
+  uint64_t exec_start = STATS_CLOCK(ctx);
+  v4_err exec_err = v4repl_exec_code(ctx->vm, buf->data, buf->size);
+  STATS_RECORD(ctx, exec, exec_start);
+
+  if (take_interrupt(ctx)) {
+    return V4_REPL_ERR_INTERRUPTED;
+  }
+
+  if (exec_err != 0) {
+    snprintf(ctx->error_buf, ctx->error_buf_size, "Execution failed: error %d", exec_err);
+  }
+  return exec_err;
+}
+
+/* Start processing a line; it then advances one step per job_step() call */
+static void job_begin(V4ReplContext* ctx, const char* line, V4ReplDoneFn on_done, void* user) {
+  V4ReplJob* job = &ctx->job;
+  memset(job, 0, sizeof(*job));
+  job->step = STEP_COMPILE;
+  job->line = line;
+  job->on_done = on_done;
+  job->on_done_user = user;
+
   /* Clear previous error */
   ctx->error_buf[0] = '\0';
+  if (line[0] != '\0' && line[0] != '\n') {
+    STATS_BEGIN_LINE(ctx);
+  }
+}
+
+/* Release the compiler output (if still owned) and return to idle */
+static void job_end(V4ReplContext* ctx) {
+  if (ctx->job.owns_buf) {
+    v4front_free(&ctx->job.buf);
+  }
+  memset(&ctx->job, 0, sizeof(ctx->job));
+}
+
+/* Finish the line: record the result and run the completion callback */
+static v4_err job_finish(V4ReplContext* ctx, v4_err err) {
+  V4ReplDoneFn on_done = ctx->job.on_done;
+  void* user = ctx->job.on_done_user;
+
+  job_end(ctx);
+  if (err != 0) {
+    STATS_ERROR(ctx, err);
+  }
+
+  /* The context is idle again, so the callback may submit the next line */
+  if (on_done) {
+    on_done(user, err, v4_repl_get_error(ctx));
+  }
+  return err;
+}
+
+/* Keep a buffer whose definitions the VM points into; returns the kept copy or NULL on OOM */
+static V4FrontBuf* keep_definitions(V4ReplContext* ctx, const V4FrontBuf* buf) {
+  if (ctx->word_buf_count >= ctx->word_buf_capacity) {
+    int new_cap = ctx->word_buf_capacity * 2;
+    V4FrontBuf* new_bufs = (V4FrontBuf*) realloc(ctx->word_bufs, new_cap * sizeof(V4FrontBuf));
+    if (!new_bufs) {
+      snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory tracking word definitions");
+      return NULL;
+    }
+    ctx->word_bufs = new_bufs;
+    ctx->word_buf_capacity = new_cap;
+  }
+  /* Save this buffer (will be freed in destructor) */
+  ctx->word_bufs[ctx->word_buf_count++] = *buf;
+  return &ctx->word_bufs[ctx->word_buf_count - 1];
+}
 
-  /* Skip empty lines */
-  if (line[0] == '\0' || line[0] == '\n') {
+/* Decide who owns the compiler output once all definitions are registered */
+static v4_err job_settle_buffer(V4ReplContext* ctx) {
+  V4ReplJob* job = &ctx->job;
+  V4FrontBuf* buf = &job->buf;
+  job->main_code = buf;
+
+  if (buf->word_count > 0 && !ctx->code_arena) {
+    /* VM holds pointers to the definitions: keep the buffer alive */
+    const V4FrontBuf* kept = keep_definitions(ctx, buf);
+    if (!kept) {
+      return -1;
+    }
+    job->main_code = kept;
+    job->owns_buf = 0;
+  } else if (buf->word_count == 0 && ctx->cache_capacity > 0) {
+    /* Plain code: hand the buffer to the cache */
+    V4ReplCacheEntry* entry = cache_insert(ctx, job->line, job->line_hash, buf);
+    if (entry) {
+      job->main_code = &entry->buf;
+      job->owns_buf = 0;
+    }
+  }
+  /* (Definitions in a code arena were copied; the buffer can go) */
+  return 0;
+}
+
+/* With a code arena, all definitions must fit before any is registered */
+static v4_err code_arena_check(V4ReplContext* ctx, const V4FrontBuf* buf) {
+  if (!ctx->code_arena) {
     return 0;
   }
+  size_t needed = 0;
+  for (int i = 0; i < buf->word_count; ++i) {
+    needed += code_arena_align(buf->words[i].code_len);
+  }
+  if (needed > ctx->code_arena_size - ctx->code_arena_used) {
+    snprintf(ctx->error_buf, ctx->error_buf_size, "Code arena exhausted: %u bytes needed, %u free",
+             (unsigned) needed, (unsigned) (ctx->code_arena_size - ctx->code_arena_used));
+    return -1;
+  }
+  return 0;
+}
 
-  /* Compile the input with context and detailed error information */
-  V4FrontBuf buf;
-  memset(&buf, 0, sizeof(buf));
+/* Register one compiled definition to the VM, the compiler context and the indexes */
+static v4_err register_word(V4ReplContext* ctx, const V4FrontWord* word) {
+  STATS_COUNT(ctx, bytecode_bytes, word->code_len);
 
-  V4FrontError error;
-  v4front_err err = v4front_compile_with_context_ex(ctx->front_ctx, line, &buf, &error);
+  /* Move bytecode into the arena, if configured */
+  const uint8_t* code = word->code;
+  if (ctx->code_arena) {
+    code = code_arena_copy(ctx, word->code, word->code_len);
+  }
+
+  /* Register to VM */
+  int wid = vm_register_word(ctx->vm, word->name, code, (int) word->code_len);
+
+  if (wid < 0) {
+    snprintf(ctx->error_buf, ctx->error_buf_size, "Failed to register word '%s': error %d",
+             word->name, wid);
+    return wid;
+  }
+
+  /* Register to compiler context */
+  v4front_err ctx_err = v4front_context_register_word(ctx->front_ctx, word->name, wid);
+  if (ctx_err != 0) {
+    snprintf(ctx->error_buf, ctx->error_buf_size,
+             "Failed to register word '%s' to compiler: error %d", word->name, ctx_err);
+    return ctx_err;
+  }
+
+  if (v4repl_deflog_append(&ctx->defs, wid, word->name, code, word->code_len) != 0 ||
+      v4repl_index_add(&ctx->words, word->name, wid) != 0) {
+    snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory tracking word definitions");
+    return -1;
+  }
 
+  /* A pending lazy definition of the same name is superseded */
+  v4repl_lazy_drop(&ctx->lazy, word->name);
+  return 0;
+}
+
+static int lazy_compile(void* user, const char* name, const char* source);
+
+/*
+ * Pending lazy words that use a name defined in job->buf keep its old
+ * meaning: compile them first. lazy_compile() times itself, so callers
+ * run this outside their own register timing.
+ */
+static v4_err job_redefine_lazy(V4ReplContext* ctx) {
+  for (int i = 0; i < ctx->job.buf.word_count; ++i) {
+    v4_err err = v4repl_lazy_redefine(&ctx->lazy, ctx->job.buf.words[i].name, &ctx->words,
+                                      lazy_compile, ctx);
+    if (err != 0) {
+      return err;
+    }
+  }
+  return 0;
+}
+
+/* Prepare to register the definitions in job->buf, one per step */
+static v4_err job_begin_register(V4ReplContext* ctx) {
+  v4_err err = code_arena_check(ctx, &ctx->job.buf);
   if (err != 0) {
-    /* Format and store error message */
-    v4front_format_error(&error, line, ctx->error_buf, ctx->error_buf_size);
     return err;
   }
 
-  /* Register any defined words to VM and compiler context */
-  for (int i = 0; i < buf.word_count; ++i) {
-    V4FrontWord* word = &buf.words[i];
+  /* Definitions change the dictionary: cached lines may now resolve differently */
+  dictionary_changed(ctx);
 
-    /* Register to VM */
-    int wid = vm_register_word(ctx->vm, word->name, word->code, (int) word->code_len);
+  ctx->job.step = STEP_REGISTER;
+  return 0;
+}
 
-    if (wid < 0) {
-      snprintf(ctx->error_buf, ctx->error_buf_size, "Failed to register word '%s': error %d",
-               word->name, wid);
-      v4front_free(&buf);
-      return wid;
-    }
+/*
+ * Compile a lazy definition the line being compiled refers to, and
+ * register it at once (V4ReplLazyCompileFn)
+ */
+static int lazy_compile(void* user, const char* name, const char* source) {
+  V4ReplContext* ctx = (V4ReplContext*) user;
+  V4FrontBuf buf;
+  V4FrontError error;
+  uint64_t compile_start = STATS_CLOCK(ctx);
+  v4front_err err = v4front_compile_with_context_ex(ctx->front_ctx, source, &buf, &error);
+  STATS_RECORD(ctx, compile, compile_start);
 
-    /* Register to compiler context */
-    v4front_err ctx_err = v4front_context_register_word(ctx->front_ctx, word->name, wid);
-    if (ctx_err != 0) {
-      snprintf(ctx->error_buf, ctx->error_buf_size,
-               "Failed to register word '%s' to compiler: error %d", word->name, ctx_err);
-      v4front_free(&buf);
-      return ctx_err;
-    }
+  if (err != 0) {
+    v4front_format_error(&error, source, ctx->error_buf, ctx->error_buf_size);
+    size_t len = strlen(ctx->error_buf);
+    snprintf(ctx->error_buf + len, ctx->error_buf_size - len, " (in lazy definition of %s)",
+             name);
+    STATS_COUNT(ctx, compile_errors, 1);
+    return err;
   }
 
-  /* If we defined any words, save the buffer (VM holds pointers to the bytecode) */
-  int has_word_defs = (buf.word_count > 0);
-  if (has_word_defs) {
-    /* Grow word_bufs array if needed */
-    if (ctx->word_buf_count >= ctx->word_buf_capacity) {
-      int new_cap = ctx->word_buf_capacity * 2;
-      V4FrontBuf* new_bufs = (V4FrontBuf*) realloc(ctx->word_bufs, new_cap * sizeof(V4FrontBuf));
-      if (!new_bufs) {
-        snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory tracking word definitions");
-        v4front_free(&buf);
-        return -1;
-      }
-      ctx->word_bufs = new_bufs;
-      ctx->word_buf_capacity = new_cap;
+  uint64_t register_start = STATS_CLOCK(ctx);
+  v4_err reg_err = code_arena_check(ctx, &buf);
+  if (reg_err == 0) {
+    dictionary_changed(ctx);
+    for (int i = 0; i < buf.word_count && reg_err == 0; ++i) {
+      reg_err = register_word(ctx, &buf.words[i]);
     }
-    /* Save this buffer (will be freed in destructor) */
-    ctx->word_bufs[ctx->word_buf_count++] = buf;
   }
+  /* Heap definitions stay alive; arena definitions were copied */
+  if (reg_err == 0 && buf.word_count > 0 && !ctx->code_arena) {
+    if (keep_definitions(ctx, &buf)) {
+      STATS_RECORD(ctx, register, register_start);
+      return 0;
+    }
+    reg_err = -1;
+  }
+  v4front_free(&buf);
+  STATS_RECORD(ctx, register, register_start);
+  return reg_err;
+}
 
-  /* Register and execute main code */
-  if (buf.data && buf.size > 0) {
-    int wid = vm_register_word(ctx->vm, NULL, buf.data, (int) buf.size);
+/* Compile the line (or find it in the cache) */
+static v4_err job_compile(V4ReplContext* ctx) {
+  V4ReplJob* job = &ctx->job;
 
-    if (wid < 0) {
-      snprintf(ctx->error_buf, ctx->error_buf_size, "Failed to register code: error %d", wid);
-      if (!has_word_defs) {
-        v4front_free(&buf);
-      }
-      return wid;
+  if (ctx->lazy_enabled) {
+    /* Definitions only: record them; nothing to compile or run yet */
+    int recorded = v4repl_lazy_record(&ctx->lazy, job->line, &ctx->words, lazy_compile, ctx);
+    if (recorded == -2) {
+      return -1; /* lazy_compile() reported it */
     }
-
-    struct Word* entry = vm_get_word(ctx->vm, wid);
-    if (!entry) {
-      snprintf(ctx->error_buf, ctx->error_buf_size, "Failed to get word entry");
-      if (!has_word_defs) {
-        v4front_free(&buf);
-      }
+    if (recorded < 0) {
+      snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory recording lazy definitions");
       return -1;
     }
+    if (recorded > 0) {
+      /* A cached line may refer to a word this replaces */
+      dictionary_changed(ctx);
+      job->main_code = &job->buf;
+      job->step = STEP_EXEC;
+      return 0;
+    }
+  }
 
-    v4_err exec_err = vm_exec(ctx->vm, entry);
+  /* Compile the lazy definitions this line uses (before the cache: they may change it) */
+  v4_err lazy_err = v4repl_lazy_resolve(&ctx->lazy, job->line, lazy_compile, ctx);
+  if (lazy_err != 0) {
+    return lazy_err;
+  }
 
-    if (exec_err != 0) {
-      snprintf(ctx->error_buf, ctx->error_buf_size, "Execution failed: error %d", exec_err);
-      if (!has_word_defs) {
-        v4front_free(&buf);
-      }
-      return exec_err;
+  /* Reuse bytecode of a previously compiled line */
+  if (ctx->cache_capacity > 0) {
+    job->line_hash = cache_hash(job->line, ctx->dict_generation);
+    V4ReplCacheEntry* hit = cache_find(ctx, job->line, job->line_hash);
+    if (hit) {
+      ctx->cache_hits++;
+      job->main_code = &hit->buf;
+      job->step = STEP_EXEC;
+      return 0;
     }
+    ctx->cache_misses++;
+  }
+
+  /* Compile the input with context and detailed error information */
+  V4FrontBuf* buf = &job->buf;
+  V4FrontError error;
+  uint64_t compile_start = STATS_CLOCK(ctx);
+  v4front_err err = v4front_compile_with_context_ex(ctx->front_ctx, job->line, buf, &error);
+  STATS_RECORD(ctx, compile, compile_start);
+
+  if (err != 0) {
+    /* Format and store error message */
+    v4front_format_error(&error, job->line, ctx->error_buf, ctx->error_buf_size);
+    STATS_COUNT(ctx, compile_errors, 1);
+    return err;
   }
+  job->owns_buf = 1;
+
+  v4_err lazy_redefine_err = job_redefine_lazy(ctx);
+  if (lazy_redefine_err != 0) {
+    return lazy_redefine_err;
+  }
+
+  uint64_t register_start = STATS_CLOCK(ctx);
+  STATS_COUNT(ctx, bytecode_bytes, buf->size);
 
-  /* Free compiler output if no word definitions */
-  if (!has_word_defs) {
-    v4front_free(&buf);
+  if (buf->word_count == 0) {
+    v4_err settle_err = job_settle_buffer(ctx);
+    STATS_RECORD(ctx, register, register_start);
+    job->step = STEP_EXEC;
+    return settle_err;
   }
 
+  v4_err begin_err = job_begin_register(ctx);
+  STATS_RECORD(ctx, register, register_start);
+  return begin_err;
+}
+
+/* Register one word definition to the VM and compiler context */
+static v4_err job_register_next(V4ReplContext* ctx) {
+  V4ReplJob* job = &ctx->job;
+  uint64_t register_start = STATS_CLOCK(ctx);
+
+  v4_err err = register_word(ctx, &job->buf.words[job->next_word++]);
+  if (err != 0) {
+    return err;
+  }
+
+  if (job->next_word == job->buf.word_count) {
+    err = job_settle_buffer(ctx);
+    job->step = STEP_EXEC;
+  }
+  STATS_RECORD(ctx, register, register_start);
+  return err;
+}
+
+/*
+ * Advance the pending line by one step. Returns 1 while the line is still
+ * in progress, 0 once it has finished (*result then holds its error code).
+ */
+static int job_step(V4ReplContext* ctx, v4_err* result) {
+  V4ReplJob* job = &ctx->job;
+  v4_err err = 0;
+
+  switch (job->step) {
+    case STEP_COMPILE:
+      /* Skip empty lines */
+      if (job->line[0] == '\0' || job->line[0] == '\n') {
+        break;
+      }
+      if (take_interrupt(ctx)) {
+        err = V4_REPL_ERR_INTERRUPTED;
+        break;
+      }
+      err = job_compile(ctx);
+      if (err == 0) {
+        return 1;
+      }
+      break;
+    case STEP_REGISTER:
+      err = job_register_next(ctx);
+      if (err == 0) {
+        return 1;
+      }
+      break;
+    case STEP_EXEC:
+      err = exec_main_code(ctx, job->main_code);
+      break;
+    case STEP_IDLE:
+      return 0;
+  }
+
+  *result = job_finish(ctx, err);
+  return 0;
+}
+
+v4_err v4_repl_process_line(V4ReplContext* ctx, const char* line) {
+  if (!ctx || !line) {
+    return -1;
+  }
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+
+  v4_err err = 0;
+  job_begin(ctx, line, NULL, NULL);
+  while (job_step(ctx, &err)) {
+  }
+  return err;
+}
+
+v4_err v4_repl_submit_line(V4ReplContext* ctx, const char* line, V4ReplDoneFn on_done,
+                           void* user) {
+  if (!ctx || !line) {
+    return -1;
+  }
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+
+  /* The caller's buffer may be reused as soon as this returns */
+  size_t len = strlen(line);
+  if (len >= ctx->line_buf_size) {
+    return V4_REPL_ERR_LINE_TOO_LONG;
+  }
+  memcpy(ctx->line_buf, line, len + 1);
+
+  job_begin(ctx, ctx->line_buf, on_done, user);
   return 0;
 }
 
+int v4_repl_poll(V4ReplContext* ctx, uint32_t budget_us) {
+  if (!ctx || ctx->job.step == STEP_IDLE) {
+    return 0;
+  }
+
+  /* Always make progress, then keep going while the budget lasts */
+  uint64_t deadline = budget_us > 0 ? ctx->clock_ns() + (uint64_t) budget_us * 1000u : 0;
+  v4_err err = 0;
+  while (job_step(ctx, &err)) {
+    if (budget_us == 0 || ctx->clock_ns() >= deadline) {
+      return 1;
+    }
+  }
+  /* The completion callback may already have submitted the next line */
+  return ctx->job.step != STEP_IDLE;
+}
+
+int v4_repl_busy(const V4ReplContext* ctx) {
+  return ctx && ctx->job.step != STEP_IDLE;
+}
+
+void v4_repl_interrupt(V4ReplContext* ctx) {
+  if (ctx) {
+    ctx->interrupt_requested = 1;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Source loading                                                            */
+/* ------------------------------------------------------------------------- */
+
+/* Register definitions compiled by the batch loader, as if a line had produced them */
+static v4_err batch_define(void* user, V4FrontBuf* buf) {
+  V4ReplContext* ctx = (V4ReplContext*) user;
+  v4_err err = 0;
+
+  job_begin(ctx, "", NULL, NULL);
+  ctx->job.buf = *buf;
+  ctx->job.owns_buf = 1;
+  if (buf->word_count == 0) {
+    job_end(ctx);
+    return 0;
+  }
+
+  err = job_redefine_lazy(ctx);
+  if (err != 0) {
+    return job_finish(ctx, err);
+  }
+  uint64_t register_start = STATS_CLOCK(ctx);
+  err = job_begin_register(ctx);
+  STATS_RECORD(ctx, register, register_start);
+  if (err != 0) {
+    return job_finish(ctx, err);
+  }
+  while (job_step(ctx, &err)) {
+  }
+  return err;
+}
+
+static v4_err batch_run(void* user, const char* code, unsigned long line) {
+  V4ReplContext* ctx = (V4ReplContext*) user;
+  v4_err err = v4_repl_process_line(ctx, code);
+  if (err != 0 && ctx->error_buf[0] != '\0') {
+    size_t len = strlen(ctx->error_buf);
+    snprintf(ctx->error_buf + len, ctx->error_buf_size - len, " (source line %lu)", line);
+  }
+  return err;
+}
+
+static void batch_compile_error(void* user, const V4FrontError* error, const char* source) {
+  V4ReplContext* ctx = (V4ReplContext*) user;
+  v4front_format_error(error, source, ctx->error_buf, ctx->error_buf_size);
+  STATS_COUNT(ctx, compile_errors, 1);
+  STATS_ERROR(ctx, error->code);
+}
+
+/* Lazy mode: record definition-only chunks instead of compiling them */
+static int batch_defer(void* user, const char* code) {
+  V4ReplContext* ctx = (V4ReplContext*) user;
+  int recorded = v4repl_lazy_record(&ctx->lazy, code, &ctx->words, lazy_compile, ctx);
+  if (recorded > 0) {
+    dictionary_changed(ctx);
+  }
+  return (recorded < 0) ? -1 : recorded; /* A compile error is already in error_buf */
+}
+
+v4_err v4_repl_load_source(V4ReplContext* ctx, const char* source, int threads) {
+  if (!ctx || !source) {
+    return -1;
+  }
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+
+  V4ReplBatchHooks hooks;
+  hooks.front_ctx = ctx->front_ctx;
+  hooks.user = ctx;
+  hooks.define = batch_define;
+  hooks.run = batch_run;
+  hooks.compile_error = batch_compile_error;
+  hooks.defer = ctx->lazy_enabled ? batch_defer : NULL;
+
+  ctx->error_buf[0] = '\0';
+  v4_err err = v4repl_batch_load(source, threads, &hooks);
+  if (err != 0 && ctx->error_buf[0] == '\0') {
+    snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory loading source");
+  }
+  return err;
+}
+
+/* Release the bytecode of all definitions (the dictionary no longer refers to it) */
+static void free_definitions(V4ReplContext* ctx) {
+  for (int i = 0; i < ctx->word_buf_count; ++i) {
+    v4front_free(&ctx->word_bufs[i]);
+  }
+  ctx->word_buf_count = 0;
+  v4repl_deflog_clear(&ctx->defs);
+  v4repl_index_clear(&ctx->words);
+  v4repl_lazy_clear(&ctx->lazy);
+  free(ctx->image_code);
+  ctx->image_code = NULL;
+
+  /* Rewind the code arena */
+  ctx->code_arena_used = 0;
+}
+
 void v4_repl_reset(V4ReplContext* ctx) {
   if (!ctx) {
     return;
   }
 
+  /* Abandon a line in progress (its callback is not called) */
+  job_end(ctx);
+
   /* Reset VM stacks */
   vm_reset_stacks(ctx->vm);
 
   /* Reset compiler context */
   v4front_context_reset(ctx->front_ctx);
+  dictionary_changed(ctx);
 
-  /* Free all word definition buffers */
-  for (int i = 0; i < ctx->word_buf_count; ++i) {
-    v4front_free(&ctx->word_bufs[i]);
-  }
-  ctx->word_buf_count = 0;
+  free_definitions(ctx);
 }
 
 void v4_repl_reset_dictionary(V4ReplContext* ctx) {
@@ -239,17 +998,159 @@ void v4_repl_reset_dictionary(V4ReplContext* ctx) {
     return;
   }
 
+  /* Abandon a line in progress (its callback is not called) */
+  job_end(ctx);
+
   /* Reset VM dictionary */
   vm_reset_dictionary(ctx->vm);
 
   /* Reset compiler context */
   v4front_context_reset(ctx->front_ctx);
+  dictionary_changed(ctx);
 
-  /* Free all word definition buffers */
-  for (int i = 0; i < ctx->word_buf_count; ++i) {
-    v4front_free(&ctx->word_bufs[i]);
+  free_definitions(ctx);
+}
+
+size_t v4_repl_code_arena_used(const V4ReplContext* ctx) {
+  if (!ctx) {
+    return 0;
   }
-  ctx->word_buf_count = 0;
+  return ctx->code_arena_used;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Session images                                                            */
+/* ------------------------------------------------------------------------- */
+
+v4_err v4_repl_snapshot(V4ReplContext* ctx, uint8_t* buf, size_t buf_size, size_t* out_len) {
+  if (!ctx || !out_len) {
+    return -1;
+  }
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+
+  /* The image holds bytecode only: compile what lazy mode has recorded */
+  ctx->error_buf[0] = '\0';
+  v4_err lazy_err = v4repl_lazy_resolve_all(&ctx->lazy, lazy_compile, ctx);
+  if (lazy_err != 0) {
+    *out_len = 0;
+    if (ctx->error_buf[0] == '\0') {
+      snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory compiling lazy definitions");
+    }
+    return lazy_err;
+  }
+
+  *out_len = v4repl_image_size(&ctx->defs, ctx->vm, ctx->vm_mem_size);
+  if (!buf) {
+    return 0; /* Size query */
+  }
+  if (buf_size < *out_len) {
+    return -1;
+  }
+  v4repl_image_write(&ctx->defs, ctx->vm, ctx->vm_mem, ctx->vm_mem_size, 0, buf, buf_size);
+  return 0;
+}
+
+v4_err v4_repl_restore(V4ReplContext* ctx, const uint8_t* image, size_t len, unsigned flags) {
+  if (!ctx || !image) {
+    return -1;
+  }
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+  ctx->error_buf[0] = '\0';
+
+  V4ReplImage img;
+  if (v4repl_image_open(&img, image, len, ctx->error_buf, ctx->error_buf_size) != 0) {
+    return V4_REPL_ERR_IMAGE;
+  }
+
+  /* Word IDs in the image are only reproducible from an empty dictionary */
+  v4_repl_reset_dictionary(ctx);
+
+  const uint8_t* code_base = img.code;
+  if (!(flags & V4_REPL_RESTORE_IN_PLACE) && img.code_size > 0) {
+    if (ctx->code_arena) {
+      if (img.code_size > ctx->code_arena_size) {
+        snprintf(ctx->error_buf, ctx->error_buf_size,
+                 "Code arena exhausted: %u bytes needed, %u free", (unsigned) img.code_size,
+                 (unsigned) ctx->code_arena_size);
+        return V4_REPL_ERR_IMAGE;
+      }
+      code_base = code_arena_copy(ctx, img.code, img.code_size);
+    } else {
+      ctx->image_code = (uint8_t*) malloc(img.code_size);
+      if (!ctx->image_code) {
+        snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory copying image bytecode");
+        return -1;
+      }
+      memcpy(ctx->image_code, img.code, img.code_size);
+      code_base = ctx->image_code;
+    }
+  }
+
+  int err = v4repl_image_apply(&img, ctx->vm, ctx->front_ctx, code_base, &ctx->defs, ctx->vm_mem,
+                               ctx->vm_mem_size, ctx->error_buf, ctx->error_buf_size);
+  if (err != 0) {
+    /* Do not leave a half-loaded dictionary behind */
+    char saved[128];
+    snprintf(saved, sizeof(saved), "%s", ctx->error_buf);
+    v4_repl_reset_dictionary(ctx);
+    snprintf(ctx->error_buf, ctx->error_buf_size, "%s", saved);
+    return err;
+  }
+
+  for (int i = 0; i < ctx->defs.count; ++i) {
+    if (v4repl_index_add(&ctx->words, ctx->defs.defs[i].name, ctx->defs.defs[i].wid) != 0) {
+      snprintf(ctx->error_buf, ctx->error_buf_size, "Out of memory tracking word definitions");
+      v4_repl_reset_dictionary(ctx);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Word lookup                                                               */
+/* ------------------------------------------------------------------------- */
+
+int v4_repl_find_word(const V4ReplContext* ctx, const char* name) {
+  if (!ctx || !name) {
+    return -1;
+  }
+  return v4repl_index_find(&ctx->words, name);
+}
+
+const char* v4_repl_word_name(const V4ReplContext* ctx, int wid) {
+  if (!ctx) {
+    return NULL;
+  }
+  return v4repl_index_name(&ctx->words, wid);
+}
+
+int v4_repl_complete(V4ReplContext* ctx, const char* prefix, const char** names, int max_names) {
+  if (!ctx || !prefix) {
+    return 0;
+  }
+  int first;
+  int count = v4repl_index_prefix(&ctx->words, prefix, &first);
+  if (count < 0) {
+    return 0;
+  }
+  for (int i = 0; names && i < count && i < max_names; ++i) {
+    names[i] = v4repl_index_sorted_name(&ctx->words, first + i);
+  }
+  return count;
+}
+
+int v4_repl_lazy_words(V4ReplContext* ctx, const char* prefix, const char** names,
+                       int max_names) {
+  if (!ctx || !prefix) {
+    return 0;
+  }
+  int count = v4repl_lazy_list(&ctx->lazy, prefix, names, max_names);
+  return count < 0 ? 0 : count;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -268,22 +1169,31 @@ void v4_repl_print_stack(const V4ReplContext* ctx) {
     return;
   }
 
+  char local[OUT_LOCAL_BUFFER_SIZE];
+  V4ReplOutBuf out;
+  out_begin(ctx, &out, local);
+
   int depth = vm_ds_depth_public(ctx->vm);
 
   if (depth == 0) {
-    printf(" ok\n");
+    v4repl_out_str(&out, " ok\n");
+    v4repl_out_flush(&out);
     return;
   }
 
-  printf(" ok [%d]:", depth);
+  v4repl_out_str(&out, " ok [");
+  v4repl_out_i32(&out, depth);
+  v4repl_out_str(&out, "]:");
 
   /* Print stack from bottom to top */
   for (int i = depth - 1; i >= 0; --i) {
     v4_i32 val = vm_ds_peek_public(ctx->vm, i);
-    printf(" %d", val);
+    v4repl_out_char(&out, ' ');
+    v4repl_out_i32(&out, val);
   }
 
-  printf("\n");
+  v4repl_out_char(&out, '\n');
+  v4repl_out_flush(&out);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -298,6 +1208,75 @@ const char* v4_repl_get_error(const V4ReplContext* ctx) {
   return (ctx->error_buf[0] != '\0') ? ctx->error_buf : NULL;
 }
 
+void v4_repl_print_error(const V4ReplContext* ctx) {
+  if (!ctx || ctx->error_buf[0] == '\0') {
+    return;
+  }
+
+  char local[OUT_LOCAL_BUFFER_SIZE];
+  V4ReplOutBuf out;
+  out_begin(ctx, &out, local);
+
+  v4repl_out_str(&out, "Error: ");
+  v4repl_out_str(&out, ctx->error_buf);
+  v4repl_out_char(&out, '\n');
+  v4repl_out_flush(&out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Bytecode cache                                                            */
+/* ------------------------------------------------------------------------- */
+
+void v4_repl_get_cache_stats(const V4ReplContext* ctx, V4ReplCacheStats* out) {
+  if (!out) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if (!ctx) {
+    return;
+  }
+
+  out->hits = ctx->cache_hits;
+  out->misses = ctx->cache_misses;
+  out->entries = ctx->cache_count;
+  out->capacity = ctx->cache_capacity;
+}
+
+v4_err v4_repl_clear_cache(V4ReplContext* ctx) {
+  if (!ctx) {
+    return -1;
+  }
+  /* A submitted line may be about to run a cached entry's bytecode */
+  if (ctx->job.step != STEP_IDLE) {
+    return V4_REPL_ERR_BUSY;
+  }
+  cache_flush(ctx);
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Instrumentation                                                           */
+/* ------------------------------------------------------------------------- */
+
+#if V4_REPL_ENABLE_STATS
+
+int v4_repl_get_stats(const V4ReplContext* ctx, V4ReplStats* out) {
+  if (!ctx || !out) {
+    return -1;
+  }
+  *out = ctx->stats;
+  return 0;
+}
+
+void v4_repl_reset_stats(V4ReplContext* ctx) {
+  if (!ctx) {
+    return;
+  }
+  memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
+#endif /* V4_REPL_ENABLE_STATS */
+
 /* ------------------------------------------------------------------------- */
 /* Version information                                                       */
 /* ------------------------------------------------------------------------- */
@@ -1,8 +1,18 @@
 #include "repl.hpp"
 
+#include "line_reader.hpp"
+#include "out_buf.h"
+#include "timing.hpp"
+#include "vm_word.h"
+
 #ifndef _WIN32
+#include <fcntl.h>
 #include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#else
+#include <sys/stat.h>
 #endif
 
 #include <cstdio>
@@ -57,6 +67,45 @@ static void sigint_handler(int sig) {
 static volatile int g_interrupted = 0;
 #endif
 
+#ifndef _WIN32
+// Unix: Tab completion of word names (linenoise callbacks take no user pointer)
+static const int MAX_COMPLETIONS = 64;
+static Repl* g_completion_repl = nullptr;
+
+static void complete_word(const char* buf, linenoiseCompletions* lc) {
+  if (!g_completion_repl) {
+    return;
+  }
+
+  // Complete the last token of the line
+  const char* token = buf + strlen(buf);
+  while (token > buf && token[-1] != ' ' && token[-1] != '\t') {
+    token--;
+  }
+  if (*token == '\0') {
+    return;
+  }
+
+  V4ReplWordIndex& index = g_completion_repl->word_index();
+  int first;
+  int count = v4repl_index_prefix(&index, token, &first);
+  if (count > MAX_COMPLETIONS) {
+    count = MAX_COMPLETIONS;
+  }
+
+  char line[1024];
+  size_t head = (size_t) (token - buf);
+  if (head >= sizeof(line)) {
+    return;
+  }
+  memcpy(line, buf, head);
+  for (int i = 0; i < count; i++) {
+    snprintf(line + head, sizeof(line) - head, "%s", v4repl_index_sorted_name(&index, first + i));
+    linenoiseAddCompletion(lc, line);
+  }
+}
+#endif
+
 #ifdef _WIN32
 // Windows: Simple line history vector
 static std::vector<std::string> g_history;
@@ -122,14 +171,25 @@ static char* read_line_simple(const char* prompt) {
 Repl::Repl()
     : vm_(nullptr),
       compiler_ctx_(nullptr),
-      meta_cmds_(nullptr, nullptr),
-      word_bufs_(nullptr),
-      word_buf_count_(0),
-      word_buf_capacity_(0),
-      paste_mode_(false),
-      paste_buffer_(nullptr),
-      paste_buffer_size_(0),
-      paste_buffer_capacity_(0) {
+      mem_watch_(vm_memory_, sizeof(vm_memory_)),
+      meta_cmds_(nullptr, nullptr, nullptr),
+      segment_(),
+      deps_(),
+      defs_(),
+      image_(nullptr),
+      image_size_(0),
+      words_(),
+      lazy_mode_(false),
+      lazy_(),
+      lazy_marks_(nullptr),
+      lazy_marks_capacity_(0),
+      lazy_entry_(-1),
+      code_map_stale_(true),
+      interactive_(true),
+      included_(nullptr),
+      included_count_(0),
+      included_capacity_(0),
+      paste_mode_(false) {
   // Initialize VM memory to zero
   memset(vm_memory_, 0, sizeof(vm_memory_));
 
@@ -157,7 +217,7 @@ Repl::Repl()
   }
 
   // Initialize meta-commands handler
-  meta_cmds_ = MetaCommands(vm_, compiler_ctx_);
+  meta_cmds_ = MetaCommands(vm_, compiler_ctx_, this);
 
 #ifndef _WIN32
   // Set up Ctrl+C signal handler (Unix only)
@@ -188,14 +248,12 @@ Repl::~Repl() {
     vm_ = nullptr;
   }
 
-  // Free all tracked word definition buffers
-  for (int i = 0; i < word_buf_count_; ++i) {
-    v4front_free(&word_bufs_[i]);
-  }
-  free(word_bufs_);
-
-  // Free PASTE buffer
-  free(paste_buffer_);
+  v4repl_deflog_free(&defs_);
+  v4repl_index_free(&words_);
+  v4repl_lazy_free(&lazy_);
+  free(lazy_marks_);
+  release_image();
+  free(included_);
 }
 
 #ifdef WITH_FILESYSTEM
@@ -235,22 +293,31 @@ void Repl::save_history() {
 #endif
 
 void Repl::print_stack() {
+  char data[256];
+  V4ReplOutBuf out;
+  v4repl_out_init(&out, data, sizeof(data), v4repl_out_stdout, nullptr);
+
   int depth = vm_ds_depth_public(vm_);
 
   if (depth == 0) {
-    printf(" ok\n");
+    v4repl_out_str(&out, " ok\n");
+    v4repl_out_flush(&out);
     return;
   }
 
-  printf(" ok [%d]:", depth);
+  v4repl_out_str(&out, " ok [");
+  v4repl_out_i32(&out, depth);
+  v4repl_out_str(&out, "]:");
 
   // Print stack from bottom to top
   for (int i = depth - 1; i >= 0; --i) {
     v4_i32 val = vm_ds_peek_public(vm_, i);
-    printf(" %d", val);
+    v4repl_out_char(&out, ' ');
+    v4repl_out_i32(&out, val);
   }
 
-  printf("\n");
+  v4repl_out_char(&out, '\n');
+  v4repl_out_flush(&out);
 }
 
 void Repl::print_error(const char* msg, int code) {
@@ -261,6 +328,33 @@ void Repl::print_error(const char* msg, int code) {
   }
 }
 
+void Repl::print_backtrace() {
+  v4_i32 rs[64];  // Max return stack size
+  int depth = vm_rs_copy_to_array(vm_, rs, 64);
+  if (depth <= 0) {
+    return;
+  }
+  code_map().print_trace(stderr, rs, depth, words_);
+}
+
+size_t Repl::read_memory(uint32_t addr, uint8_t* dst, size_t len) const {
+  // VM RAM is our own block mapped at address 0, so no per-cell VM calls
+  if (addr >= sizeof(vm_memory_)) {
+    return 0;
+  }
+  size_t avail = sizeof(vm_memory_) - addr;
+  size_t n = (len < avail) ? len : avail;
+  memcpy(dst, vm_memory_ + addr, n);
+  return n;
+}
+
+const CodeMap& Repl::code_map() {
+  if (code_map_stale_) {
+    code_map_stale_ = !code_map_.rebuild(vm_, defs_);
+  }
+  return code_map_;
+}
+
 bool Repl::is_paste_marker(const char* line) {
   // Skip leading whitespace
   while (*line == ' ' || *line == '\t') {
@@ -288,32 +382,58 @@ bool Repl::is_paste_marker(const char* line) {
 
 void Repl::enter_paste_mode() {
   paste_mode_ = true;
-  paste_buffer_size_ = 0;
-  if (paste_buffer_) {
-    paste_buffer_[0] = '\0';
+  paste_.reset();
+  if (interactive_) {
+    printf("Entering PASTE mode. Type '>>>' to compile and execute.\n");
   }
-  printf("Entering PASTE mode. Type '>>>' to compile and execute.\n");
 }
 
-void Repl::exit_paste_mode() {
+int Repl::exit_paste_mode() {
   paste_mode_ = false;
 
-  if (paste_buffer_size_ == 0 || !paste_buffer_) {
+  if (paste_.line_count() == 0) {
     printf("(empty PASTE buffer)\n");
-    return;
+    return 0;
   }
 
-  // Compile and execute the buffered code
-  int result = eval_line(paste_buffer_);
+  // Complete definitions already ran; compile an unterminated fragment
+  // as is, so its error is reported
+  int result = 0;
+  if (const char* rest = paste_.rest()) {
+    unsigned long first_line = paste_.first_line();
+    result = eval_code(rest, nullptr, nullptr);
+    if (result != 0) {
+      print_paste_location(first_line);
+    }
+  }
 
-  if (result == 0) {
+  if (result == 0 && interactive_) {
     print_stack();
   }
 
-  // Clear buffer
-  paste_buffer_size_ = 0;
-  if (paste_buffer_) {
-    paste_buffer_[0] = '\0';
+  paste_.reset();
+  return (result == 0) ? 0 : -1;
+}
+
+int Repl::eval_paste_chunks() {
+  int result = 0;
+  while (const char* chunk = paste_.ready()) {
+    unsigned long first_line = paste_.first_line();
+    if (eval_code(chunk, nullptr, nullptr) != 0) {
+      print_paste_location(first_line);
+      result = -1;
+    }
+    paste_.consume();
+  }
+  return result;
+}
+
+void Repl::print_paste_location(unsigned long first_line) {
+  unsigned long last_line = paste_.line_count();
+  if (first_line >= last_line) {
+    fprintf(stderr, "  in PASTE line %lu\n", last_line);
+  } else {
+    fprintf(stderr, "  in PASTE lines %lu-%lu\n", first_line, last_line);
   }
 }
 
@@ -341,43 +461,21 @@ int Repl::eval_line(const char* line) {
     } else {  // >>>
       if (!paste_mode_) {
         printf("Not in PASTE mode\n");
-      } else {
-        exit_paste_mode();
+        return 0;
       }
-      return 0;
+      return exit_paste_mode();
     }
   }
 
-  // If in PASTE mode, accumulate lines
+  // If in PASTE mode, buffer the line and compile whatever it completed
   if (paste_mode_) {
-    int line_len = strlen(line);
-    int needed = paste_buffer_size_ + line_len + 2;  // +2 for '\n' and '\0'
-
-    // Grow buffer if needed
-    if (needed > paste_buffer_capacity_) {
-      int new_cap = (paste_buffer_capacity_ == 0) ? 1024 : (paste_buffer_capacity_ * 2);
-      while (new_cap < needed) {
-        new_cap *= 2;
-      }
-
-      char* new_buf = (char*) realloc(paste_buffer_, new_cap);
-      if (!new_buf) {
-        fprintf(stderr, "Out of memory in PASTE mode\n");
-        paste_mode_ = false;
-        return -1;
-      }
-
-      paste_buffer_ = new_buf;
-      paste_buffer_capacity_ = new_cap;
+    if (!paste_.append(line)) {
+      fprintf(stderr, "Out of memory in PASTE mode\n");
+      paste_mode_ = false;
+      paste_.reset();
+      return -1;
     }
-
-    // Append line with newline
-    strcpy(paste_buffer_ + paste_buffer_size_, line);
-    paste_buffer_size_ += line_len;
-    paste_buffer_[paste_buffer_size_++] = '\n';
-    paste_buffer_[paste_buffer_size_] = '\0';
-
-    return 0;  // Continue accumulating
+    return eval_paste_chunks();
   }
 
   // Check for exit command
@@ -403,6 +501,51 @@ int Repl::eval_line(const char* line) {
     return -1;
   }
 
+  return eval_code(line, nullptr, nullptr);
+}
+
+// Compile one recorded definition on first use (V4ReplLazyCompileFn)
+int Repl::compile_lazy(void* user, const char* name, const char* source) {
+  Repl* self = static_cast<Repl*>(user);
+  char word_name[64];
+  snprintf(word_name, sizeof(word_name), "%s", name);  // name is scratch space
+  bool lazy_mode = self->lazy_mode_;
+  int lazy_entry = self->lazy_entry_;
+  self->lazy_mode_ = false;  // Compile it now, do not record it again
+  self->lazy_entry_ = v4repl_lazy_position(&self->lazy_, word_name);
+  int result = self->eval_code(source, nullptr, nullptr);
+  self->lazy_mode_ = lazy_mode;
+  self->lazy_entry_ = lazy_entry;
+  if (result != 0) {
+    fprintf(stderr, "  in lazy definition of %s\n", word_name);
+  }
+  return result;
+}
+
+int Repl::eval_code(const char* line, uint64_t* compile_ns, uint64_t* exec_ns,
+                    V4FrontError* compile_error) {
+  uint64_t compile_start = monotonic_ns();
+
+  // Lazy mode: definitions only are recorded, not compiled
+  if (lazy_mode_) {
+    int recorded = v4repl_lazy_record(&lazy_, line, &words_, compile_lazy, this);
+    if (recorded == -2) {
+      return -1;  // compile_lazy() reported it
+    }
+    if (recorded < 0) {
+      print_error("Out of memory recording lazy definitions", 0);
+      return -1;
+    }
+    if (recorded > 0) {
+      return 0;
+    }
+  }
+
+  // Compile the recorded words this line uses first
+  if (v4repl_lazy_resolve(&lazy_, line, compile_lazy, this) != 0) {
+    return -1;
+  }
+
   // Compile the input with context and detailed error information
   V4FrontBuf buf;
   memset(&buf, 0, sizeof(buf));
@@ -411,6 +554,11 @@ int Repl::eval_line(const char* line) {
   v4front_err err = v4front_compile_with_context_ex(compiler_ctx_, line, &buf, &error);
 
   if (err != 0) {
+    if (compile_error) {
+      *compile_error = error;  // The caller reports it with its own location
+      return -2;
+    }
+
     // Format and display detailed error message
     char formatted_error[1024];
     v4front_format_error(&error, line, formatted_error, sizeof(formatted_error));
@@ -418,98 +566,825 @@ int Repl::eval_line(const char* line) {
     return -1;
   }
 
-  // Register any defined words to VM and compiler context
+  // Recorded words that use a name defined here are compiled against its old meaning
+  for (int i = 0; i < buf.word_count; ++i) {
+    if (v4repl_lazy_redefine(&lazy_, buf.words[i].name, &words_, compile_lazy, this) != 0) {
+      v4front_free(&buf);
+      return -1;
+    }
+  }
+
+  // Register any defined words to VM and compiler context. Their bytecode
+  // is copied into the code segment, which is re-packed (and grown if
+  // need be) first when the words would not fit.
+  size_t code_size = 0;
+  for (int i = 0; i < buf.word_count; ++i) {
+    code_size += buf.words[i].code_len;
+  }
+  if (code_size > segment_.free_space() && !compact_code(code_size)) {
+    print_error("Out of memory growing the code segment", 0);
+    v4front_free(&buf);
+    return -1;
+  }
+
+  bool reg_ok = true;
   for (int i = 0; i < buf.word_count; ++i) {
     V4FrontWord* word = &buf.words[i];
+    const uint8_t* code = segment_.append(word->code, word->code_len);  // Room reserved above
 
     // Register to VM
-    int wid = vm_register_word(vm_, word->name, word->code, static_cast<int>(word->code_len));
+    int wid = vm_register_word(vm_, word->name, code, static_cast<int>(word->code_len));
 
     if (wid < 0) {
       print_error("Failed to register word definition", wid);
-      // Error during word registration - buffer not yet saved, must free
-      v4front_free(&buf);
-      return -1;
+      reg_ok = false;
+      break;
     }
 
     // Register to compiler context
     v4front_err ctx_err = v4front_context_register_word(compiler_ctx_, word->name, wid);
     if (ctx_err != 0) {
       print_error("Failed to register word to compiler context", ctx_err);
-      // Error during word registration - buffer not yet saved, must free
+      reg_ok = false;
+      break;
+    }
+
+    // Remember the registration for .save, name lookups and reclamation
+    int previous = v4repl_index_find(&words_, word->name);
+    if (v4repl_deflog_append(&defs_, wid, word->name, code, word->code_len) != 0 ||
+        !mark_lazy(defs_.count - 1) || v4repl_index_add(&words_, word->name, wid) != 0 ||
+        !deps_.add(wid, true, code, word->code_len)) {
+      print_error("Out of memory tracking word definitions", 0);
+      reg_ok = false;
+      break;
+    }
+
+    // A pending lazy definition of the same name is superseded
+    v4repl_lazy_drop(&lazy_, word->name);
+
+    // So is an earlier definition. Its bytecode stays until .compact or
+    // .forget: an execution token taken with ' may still refer to it
+    if (previous >= 0) {
+      deps_.set_bound(previous, false);
+    }
+  }
+
+  if (buf.word_count > 0) {
+    code_map_stale_ = true;
+  }
+  if (compile_ns) {
+    *compile_ns = monotonic_ns() - compile_start;
+  }
+
+  if (!reg_ok) {
+    v4front_free(&buf);
+    return -1;
+  }
+
+  // Execute main code without registering it
+  // (a dictionary entry per line would leak one VM word slot per line)
+  uint64_t exec_start = monotonic_ns();
+  if (buf.data && buf.size > 0) {
+    code_map_.set_top_level(buf.data, buf.size);
+    profiler_.begin_exec(vm_);
+    v4_err exec_err = v4repl_exec_code(vm_, buf.data, buf.size);
+    if (profiler_.running()) {
+      profiler_.end_exec(code_map());
+    }
+
+    // Symbolize the call chain while the line's bytecode is still mapped
+    if (exec_err != 0 && !g_interrupted) {
+      print_error("Execution failed", exec_err);
+      print_backtrace();
+    }
+    code_map_.set_top_level(nullptr, 0);
+
+    // Report watched words this line changed (even if it failed part-way)
+    if (mem_watch_.count() > 0) {
+      mem_watch_.check(stdout);
+    }
+
+    // Check for interrupt after execution
+    if (g_interrupted) {
+      fprintf(stderr, "Execution interrupted\n");
+      vm_ds_clear(vm_);
+      g_interrupted = 0;
+      v4front_free(&buf);
+      return -1;
+    }
+
+    if (exec_err != 0) {
       v4front_free(&buf);
       return -1;
     }
   }
 
-  // If we defined any words, save the buffer (VM holds pointers to the bytecode)
-  bool has_word_defs = (buf.word_count > 0);
-  if (has_word_defs) {
-    // Grow word_bufs_ array if needed
-    if (word_buf_count_ >= word_buf_capacity_) {
-      int new_cap = (word_buf_capacity_ == 0) ? 16 : (word_buf_capacity_ * 2);
-      V4FrontBuf* new_bufs = (V4FrontBuf*) realloc(word_bufs_, new_cap * sizeof(V4FrontBuf));
-      if (!new_bufs) {
-        print_error("Out of memory tracking word definitions", 0);
-        return -1;
-      }
-      word_bufs_ = new_bufs;
-      word_buf_capacity_ = new_cap;
+  if (exec_ns) {
+    *exec_ns = monotonic_ns() - exec_start;
+  }
+
+  // The words' bytecode lives on in the code segment
+  v4front_free(&buf);
+
+  return 0;  // Success
+}
+
+// Map (or on Windows, read) a whole file; released with unmap_file().
+// A writable mapping is private: writes are never seen by the file.
+static uint8_t* map_file(const char* path, size_t* size, bool writable = false) {
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void* map = mmap(nullptr, (size_t) st.st_size, prot, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping stays valid
+  if (map == MAP_FAILED) {
+    return nullptr;
+  }
+  *size = (size_t) st.st_size;
+  return static_cast<uint8_t*>(map);
+#else
+  (void) writable;  // Always a private copy
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    return nullptr;
+  }
+  fseek(in, 0, SEEK_END);
+  long len = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  uint8_t* data = (len > 0) ? static_cast<uint8_t*>(malloc((size_t) len)) : nullptr;
+  if (data && fread(data, 1, (size_t) len, in) != (size_t) len) {
+    free(data);
+    data = nullptr;
+  }
+  fclose(in);
+  if (data) {
+    *size = (size_t) len;
+  }
+  return data;
+#endif
+}
+
+static void unmap_file(uint8_t* data, size_t size) {
+#ifndef _WIN32
+  munmap(data, size);
+#else
+  (void) size;
+  free(data);
+#endif
+}
+
+void Repl::release_image() {
+  if (image_) {
+    unmap_file(image_, image_size_);
+    image_ = nullptr;
+    image_size_ = 0;
+  }
+}
+
+bool Repl::mark_lazy(int def) {
+  if (def >= lazy_marks_capacity_) {
+    int new_cap = lazy_marks_capacity_ ? lazy_marks_capacity_ : 64;
+    while (new_cap <= def) {
+      new_cap *= 2;
+    }
+    int* grown = static_cast<int*>(realloc(lazy_marks_, new_cap * sizeof(int)));
+    if (!grown) {
+      return false;
     }
-    // Save this buffer (will be freed in destructor)
-    word_bufs_[word_buf_count_++] = buf;
+    lazy_marks_ = grown;
+    lazy_marks_capacity_ = new_cap;
   }
+  lazy_marks_[def] = (lazy_entry_ >= 0) ? lazy_entry_ : lazy_.count;
+  return true;
+}
 
-  // Register and execute main code
-  if (buf.data && buf.size > 0) {
-    int wid = vm_register_word(vm_, nullptr, buf.data, static_cast<int>(buf.size));
+void Repl::clear_definitions() {
+  segment_.clear();
+  deps_.clear();
+  v4repl_deflog_clear(&defs_);
+  v4repl_index_clear(&words_);
+  v4repl_lazy_clear(&lazy_);
+  code_map_stale_ = true;
+  included_count_ = 0;  // Their definitions are gone, so files may be included again
+  release_image();
+}
 
-    if (wid < 0) {
-      print_error("Failed to register word", wid);
-      if (!has_word_defs) {
-        v4front_free(&buf);
+V4ReplDef* Repl::find_def(int wid) {
+  // Word IDs are handed out in increasing order, so the log is sorted by them
+  int lo = 0;
+  int hi = defs_.count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (defs_.defs[mid].wid < wid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < defs_.count && defs_.defs[lo].wid == wid) ? &defs_.defs[lo] : nullptr;
+}
+
+void Repl::reclaim(int wid) {
+  int count = deps_.sweep(wid);
+  if (count == 0) {
+    return;
+  }
+
+  // The VM entries stay (IDs cannot be reused) but no longer point at the bytecode
+  for (int i = 0; i < count; ++i) {
+    int retired = deps_.retired(i);
+    const uint8_t* stub = v4repl_retire_word(vm_, retired);
+    V4ReplDef* def = find_def(retired);
+    if (stub && def) {
+      def->code = stub;
+      def->code_len = V4REPL_RETIRED_CODE_LEN;
+    }
+  }
+  code_map_stale_ = true;  // Their space in the segment is reused by the next repack
+}
+
+void Repl::retire_superseded() {
+  for (int i = 0; i < defs_.count; ++i) {
+    reclaim(defs_.defs[i].wid);
+  }
+}
+
+bool Repl::compact_code(size_t extra) {
+  int word_count = 0;
+  while (v4repl_word_code(vm_, word_count, nullptr)) {
+    word_count++;
+  }
+  int capacity = (word_count > deps_.size()) ? word_count : deps_.size();
+  if (capacity == 0) {
+    capacity = 1;
+  }
+  CodeSegment::Item* items =
+      static_cast<CodeSegment::Item*>(malloc(capacity * sizeof(CodeSegment::Item)));
+  int* order = static_cast<int*>(malloc(capacity * sizeof(int)));
+  uint8_t* placed = static_cast<uint8_t*>(calloc(capacity, 1));
+  int ordered = (items && order && placed) ? deps_.layout_order(order) : -1;
+  if (ordered < 0) {
+    free(items);
+    free(order);
+    free(placed);
+    return false;
+  }
+
+  // Call-graph order first, then any segment word the VM has that is not
+  // tracked (tracking it ran out of memory). The VM entry is authoritative.
+  int count = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    int n = (pass == 0) ? ordered : word_count;
+    for (int i = 0; i < n; ++i) {
+      int wid = (pass == 0) ? order[i] : i;
+      size_t len = 0;
+      const uint8_t* code = v4repl_word_code(vm_, wid, &len);
+      if (placed[wid] || !segment_.contains(code)) {
+        continue;
       }
+      placed[wid] = 1;
+      items[count].wid = wid;
+      items[count].code = code;
+      items[count].len = static_cast<uint32_t>(len);
+      count++;
+    }
+  }
+  free(order);
+  free(placed);
+
+  if (!segment_.repack(items, count, extra)) {
+    free(items);
+    return false;
+  }
+  for (int i = 0; i < count; ++i) {
+    v4repl_move_word(vm_, items[i].wid, items[i].code);
+    deps_.set_code(items[i].wid, items[i].code);
+    V4ReplDef* def = find_def(items[i].wid);
+    if (def) {
+      def->code = items[i].code;
+    }
+  }
+  free(items);
+  code_map_stale_ = true;
+  return true;
+}
+
+size_t Repl::reclaimable_code_bytes() const {
+  size_t live = 0;
+  size_t len = 0;
+  const uint8_t* code;
+  for (int wid = 0; (code = v4repl_word_code(vm_, wid, &len)) != nullptr; ++wid) {
+    if (segment_.contains(code)) {
+      live += len;
+    }
+  }
+  return segment_.used() - live + deps_.unused_bytes();
+}
+
+int Repl::forget_word(const char* name) {
+  // A pending definition goes with the lazy ones after it and the words
+  // registered since it was recorded
+  int pending = v4repl_lazy_position(&lazy_, name);
+  int keep;
+  int lazy_keep;
+  int wid;
+  if (pending >= 0) {
+    lazy_keep = pending;
+    keep = 0;
+    while (keep < defs_.count && lazy_marks_[keep] <= pending) {
+      keep++;
+    }
+    wid = (keep < defs_.count) ? defs_.defs[keep].wid : deps_.size();
+  } else {
+    wid = v4repl_index_find(&words_, name);
+    V4ReplDef* def = (wid >= 0) ? find_def(wid) : nullptr;
+    if (!def) {
+      printf("Word '%s' not found.\n", name);
       return -1;
     }
+    keep = (int) (def - defs_.defs);
+    lazy_keep = lazy_marks_[keep];
+  }
+  int pending_before = lazy_.pending;
+  v4repl_lazy_truncate(&lazy_, lazy_keep);
+  int forgotten = defs_.count - keep + (pending_before - lazy_.pending);
+  if (keep == defs_.count) {
+    return forgotten;  // Only pending definitions went
+  }
 
-    struct Word* entry = vm_get_word(vm_, wid);
-    if (!entry) {
-      print_error("Failed to get word entry", 0);
-      if (!has_word_defs) {
-        v4front_free(&buf);
-      }
+  // The VM cannot drop single words: rebuild both dictionaries from the
+  // words defined before, which get their old IDs back
+  vm_reset_dictionary(vm_);
+  v4front_context_reset(compiler_ctx_);
+  v4repl_index_clear(&words_);
+  for (int i = 0; i < keep; ++i) {
+    const V4ReplDef* d = &defs_.defs[i];
+    int new_wid = vm_register_word(vm_, d->name, d->code, (int) d->code_len);
+    if (new_wid != d->wid) {
+      fprintf(stderr, "Word '%s' got ID %d while forgetting, expected %d; resetting\n", d->name,
+              new_wid, d->wid);
+      vm_reset_dictionary(vm_);
+      v4front_context_reset(compiler_ctx_);
+      clear_definitions();
+      profiler_.reset();
+      return -1;
+    }
+    // Retired words keep their ID but not their name
+    if (!deps_.is_retired(d->wid) &&
+        (v4front_context_register_word(compiler_ctx_, d->name, d->wid) != 0 ||
+         v4repl_index_add(&words_, d->name, d->wid) != 0)) {
+      fprintf(stderr, "Out of memory tracking word definitions; resetting\n");
+      vm_reset_dictionary(vm_);
+      v4front_context_reset(compiler_ctx_);
+      clear_definitions();
+      profiler_.reset();
       return -1;
     }
+  }
+  v4repl_deflog_truncate(&defs_, keep);
+
+  // Words the forgotten ones shadowed are visible again; the rest may now be unused
+  deps_.truncate(wid);
+  for (int i = 0; i < keep; ++i) {
+    const V4ReplDef* d = &defs_.defs[i];
+    deps_.set_bound(d->wid, v4repl_index_find(&words_, d->name) == d->wid);
+  }
+  retire_superseded();
+  compact_code();  // Best effort: on failure the holes stay until the next repack
+  code_map_stale_ = true;
 
-    v4_err exec_err = vm_exec(vm_, entry);
+  profiler_.reset();    // Forgotten word IDs will be handed out again
+  included_count_ = 0;  // Files may be included again
+  return forgotten;
+}
 
-    // Check for interrupt after execution
-    if (g_interrupted) {
-      fprintf(stderr, "Execution interrupted\n");
-      vm_ds_clear(vm_);
-      g_interrupted = 0;
-      if (!has_word_defs) {
-        v4front_free(&buf);
+int Repl::save_image(const char* path) {
+  // Images hold bytecode only: compile what lazy mode has recorded
+  if (v4repl_lazy_resolve_all(&lazy_, compile_lazy, this) != 0) {
+    fprintf(stderr, "Not saved: a lazy definition failed to compile\n");
+    return -1;
+  }
+
+  size_t size = v4repl_image_size(&defs_, vm_, sizeof(vm_memory_));
+  uint8_t* data = static_cast<uint8_t*>(malloc(size));
+  if (!data) {
+    print_error("Out of memory building image", 0);
+    return -1;
+  }
+  v4repl_image_write(&defs_, vm_, vm_memory_, sizeof(vm_memory_), 0, data, size);
+
+  FILE* out = fopen(path, "wb");
+  if (!out) {
+    fprintf(stderr, "Cannot open '%s' for writing\n", path);
+    free(data);
+    return -1;
+  }
+  bool ok = fwrite(data, 1, size, out) == size;
+  ok = (fclose(out) == 0) && ok;
+  free(data);
+  if (!ok) {
+    fprintf(stderr, "Failed to write '%s'\n", path);
+    return -1;
+  }
+
+  printf("Saved %d words, %d stack cells, %zu bytes to %s\n", defs_.count,
+         vm_ds_depth_public(vm_), size, path);
+  return 0;
+}
+
+// Hash of a source file as seen by the compiler (line endings normalized)
+static bool hash_source_file(const char* path, uint32_t* hash) {
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    return false;
+  }
+  LineReader reader(in);
+  uint32_t h = V4REPL_HASH_SEED ^ V4REPL_IMAGE_VERSION;
+  while (char* line = reader.next_line()) {
+    h = v4repl_hash(h, line, strlen(line));
+    h = v4repl_hash(h, "\n", 1);
+  }
+  fclose(in);
+  *hash = h;
+  return reader.ok();
+}
+
+int Repl::load_image(const char* path, const char* source_path, bool verbose) {
+  size_t size = 0;
+  uint8_t* data = map_file(path, &size);
+  if (!data) {
+    fprintf(stderr, "Cannot read '%s'\n", path);
+    return -1;
+  }
+
+  char err[256];
+  V4ReplImage img;
+  if (v4repl_image_open(&img, data, size, err, sizeof(err)) != 0) {
+    fprintf(stderr, "%s: %s\n", path, err);
+    unmap_file(data, size);
+    return -1;
+  }
+  if (img.mem_size != 0 && img.mem_size != sizeof(vm_memory_)) {
+    fprintf(stderr, "%s: image has %u bytes of VM memory, this REPL has %zu\n", path,
+            (unsigned) img.mem_size, sizeof(vm_memory_));
+    unmap_file(data, size);
+    return -1;
+  }
+
+  // A bundle whose source has changed since it was compiled is stale
+  uint32_t source_hash;
+  if (source_path && hash_source_file(source_path, &source_hash) &&
+      source_hash != img.source_hash) {
+    fprintf(stderr, "%s: stale, %s has changed since it was compiled (rerun --compile)\n",
+            path, source_path);
+    unmap_file(data, size);
+    return -1;
+  }
+
+  // Replace the session; old bytecode can go once the VM has forgotten it
+  vm_reset(vm_);
+  v4front_context_reset(compiler_ctx_);
+  profiler_.reset();
+  clear_definitions();
+
+  // Bytecode runs straight from the mapping, which is kept until the next reset
+  image_ = data;
+  image_size_ = size;
+  if (v4repl_image_apply(&img, vm_, compiler_ctx_, img.code, &defs_, vm_memory_,
+                         sizeof(vm_memory_), err, sizeof(err)) != 0) {
+    fprintf(stderr, "%s: %s\n", path, err);
+    vm_reset(vm_);
+    v4front_context_reset(compiler_ctx_);
+    clear_definitions();
+    return -1;
+  }
+  for (int i = 0; i < defs_.count; ++i) {
+    const V4ReplDef* d = &defs_.defs[i];
+    if (v4repl_index_add(&words_, d->name, d->wid) != 0 || !mark_lazy(i) ||
+        !deps_.add(d->wid, false, d->code, d->code_len)) {
+      fprintf(stderr, "%s: Out of memory tracking word definitions\n", path);
+      vm_reset(vm_);
+      v4front_context_reset(compiler_ctx_);
+      clear_definitions();
+      return -1;
+    }
+  }
+
+  // Image bytecode is never freed, but words redefined inside it no longer have a name
+  for (int i = 0; i < defs_.count; ++i) {
+    const V4ReplDef* d = &defs_.defs[i];
+    deps_.set_bound(d->wid, v4repl_index_find(&words_, d->name) == d->wid);
+  }
+
+  code_map_stale_ = true;
+  mem_watch_.sync();  // The image replaced memory; don't report it as changes
+
+  if (verbose) {
+    printf("Loaded %u words, %u stack cells from %s\n", (unsigned) img.word_count,
+           (unsigned) img.ds_depth, path);
+  }
+  return 0;
+}
+
+int Repl::compile_bundle(const char* source_path, const char* bundle_path) {
+  uint32_t source_hash;
+  if (!hash_source_file(source_path, &source_hash)) {
+    fprintf(stderr, "Cannot read '%s'\n", source_path);
+    return 1;
+  }
+
+  FILE* in = fopen(source_path, "rb");
+  if (!in) {
+    fprintf(stderr, "Cannot open '%s'\n", source_path);
+    return 1;
+  }
+  interactive_ = false;
+  int errors = 0;
+  {
+    LineReader reader(in);
+    while (char* line = reader.next_line()) {
+      int result = eval_line(line);
+      if (result == 1) {
+        break;  // 'bye' / 'quit'
+      }
+      if (result < 0) {
+        fprintf(stderr, "  at %s:%lu\n", source_path, reader.line_number());
+        errors++;
       }
+    }
+  }
+  fclose(in);
+  if (paste_mode_ && exit_paste_mode() != 0) {
+    errors++;
+  }
+  // A bundle holds bytecode only: compile what lazy mode has recorded
+  if (v4repl_lazy_resolve_all(&lazy_, compile_lazy, this) != 0) {
+    errors++;
+  }
+
+  if (errors > 0) {
+    fprintf(stderr, "%d error(s); %s not written\n", errors, bundle_path);
+    return 1;
+  }
+  if (vm_ds_depth_public(vm_) > 0) {
+    fprintf(stderr, "Warning: %d stack cells left by %s are not part of the bundle\n",
+            vm_ds_depth_public(vm_), source_path);
+  }
+
+  size_t size = v4repl_image_size(&defs_, nullptr, 0);
+  uint8_t* data = static_cast<uint8_t*>(malloc(size));
+  if (!data) {
+    fprintf(stderr, "Out of memory building bundle\n");
+    return 1;
+  }
+  v4repl_image_write(&defs_, nullptr, nullptr, 0, source_hash, data, size);
+
+  FILE* out = fopen(bundle_path, "wb");
+  bool ok = out && fwrite(data, 1, size, out) == size;
+  if (out) {
+    ok = (fclose(out) == 0) && ok;
+  }
+  free(data);
+  if (!ok) {
+    fprintf(stderr, "Failed to write '%s'\n", bundle_path);
+    return 1;
+  }
+
+  printf("Compiled %d words (%zu bytes) to %s\n", defs_.count, size, bundle_path);
+  return 0;
+}
+
+// Deepest chain of nested .include lines
+static const int MAX_INCLUDE_DEPTH = 16;
+
+static bool is_blank(const char* text, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// If the line is ".include <file>", copy the file name to name
+static bool parse_include_line(const char* text, size_t len, char* name, size_t name_size) {
+  size_t i = 0;
+  while (i < len && (text[i] == ' ' || text[i] == '\t')) {
+    i++;
+  }
+  if (len - i < 9 || strncmp(text + i, ".include", 8) != 0 ||
+      (text[i + 8] != ' ' && text[i + 8] != '\t')) {
+    return false;
+  }
+  i += 9;
+  while (i < len && (text[i] == ' ' || text[i] == '\t')) {
+    i++;
+  }
+  size_t end = len;
+  while (end > i && (text[end - 1] == '\n' || text[end - 1] == '\r' || text[end - 1] == ' ' ||
+                     text[end - 1] == '\t')) {
+    end--;
+  }
+  if (end == i || end - i >= name_size) {
+    return false;
+  }
+  memcpy(name, text + i, end - i);
+  name[end - i] = '\0';
+  return true;
+}
+
+// Resolve name relative to the directory of the including file
+static void resolve_include(const char* parent, const char* name, char* out, size_t out_size) {
+  const char* slash = strrchr(parent, '/');
+#ifdef _WIN32
+  const char* bslash = strrchr(parent, '\\');
+  if (bslash && (!slash || bslash > slash)) {
+    slash = bslash;
+  }
+  bool absolute = name[0] == '/' || name[0] == '\\' || (name[0] && name[1] == ':');
+#else
+  bool absolute = name[0] == '/';
+#endif
+  if (absolute || !slash) {
+    snprintf(out, out_size, "%s", name);
+  } else {
+    snprintf(out, out_size, "%.*s/%s", (int) (slash - parent), parent, name);
+  }
+}
+
+/*
+ * Compile text[start, end) in place. The chunk is NUL-terminated by
+ * overwriting its trailing newline (or the byte after it) in the private
+ * mapping, then restored; only a chunk that ends exactly at the end of
+ * the file without a newline is copied. line/column locate start.
+ */
+int Repl::eval_include_chunk(const char* path, char* text, size_t size, size_t start,
+                             size_t end, unsigned long line, unsigned long column) {
+  if (is_blank(text + start, end - start)) {
+    return 0;
+  }
+
+  size_t term = (text[end - 1] == '\n') ? end - 1 : end;
+  char* copy = nullptr;
+  char saved = '\0';
+  const char* code = text + start;
+  if (term < size) {
+    saved = text[term];
+    text[term] = '\0';
+  } else {
+    copy = static_cast<char*>(malloc(term - start + 1));
+    if (!copy) {
+      fprintf(stderr, "%s:%lu: Out of memory\n", path, line);
       return -1;
     }
+    memcpy(copy, text + start, term - start);
+    copy[term - start] = '\0';
+    code = copy;
+  }
 
-    if (exec_err != 0) {
-      print_error("Execution failed", exec_err);
-      if (!has_word_defs) {
-        v4front_free(&buf);
+  V4FrontError error;
+  int result = eval_code(code, nullptr, nullptr, &error);
+
+  if (result == -2) {
+    // Error positions are relative to the chunk; make them file positions
+    unsigned long err_line = line + (error.line > 1 ? (unsigned long) error.line - 1 : 0);
+    unsigned long err_col = (error.line <= 1 ? column : 0) + (unsigned long) error.column;
+    fprintf(stderr, "%s:%lu:%lu: error: %s\n", path, err_line, err_col, error.message);
+
+    // Show the offending source line with a caret
+    const char* p = code;
+    for (int l = 1; l < error.line && *p; p++) {
+      if (*p == '\n') {
+        l++;
       }
+    }
+    const char* eol = strchr(p, '\n');
+    int src_len = eol ? (int) (eol - p) : (int) strlen(p);
+    int caret = (error.column > 0) ? error.column - 1 : 0;
+    fprintf(stderr, "  %.*s\n  %*s^\n", src_len, p, caret, "");
+  } else if (result != 0) {
+    fprintf(stderr, "  at %s:%lu\n", path, line);  // Runtime error, already reported
+  }
+
+  if (copy) {
+    free(copy);
+  } else {
+    text[term] = saved;
+  }
+  return result == 0 ? 0 : -1;
+}
+
+int Repl::include_file(const char* path, int depth) {
+  if (depth >= MAX_INCLUDE_DEPTH) {
+    fprintf(stderr, "%s: includes nested more than %d deep\n", path, MAX_INCLUDE_DEPTH);
+    return -1;
+  }
+
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "Cannot read '%s'\n", path);
+    return -1;
+  }
+
+#ifndef _WIN32
+  // Include once per session, unless the file changed since
+  // (inode numbers are not meaningful on Windows)
+  IncludedFile key = {(uint64_t) st.st_dev, (uint64_t) st.st_ino, (int64_t) st.st_mtime};
+  for (int i = 0; i < included_count_; i++) {
+    if (included_[i].dev == key.dev && included_[i].ino == key.ino) {
+      if (included_[i].mtime == key.mtime) {
+        if (depth == 0) {
+          printf("%s already included\n", path);
+        }
+        return 0;
+      }
+      included_[i] = included_[--included_count_];  // Changed: include again
+      break;
+    }
+  }
+  if (included_count_ >= included_capacity_) {
+    int new_cap = (included_capacity_ == 0) ? 16 : included_capacity_ * 2;
+    IncludedFile* new_included =
+        static_cast<IncludedFile*>(realloc(included_, new_cap * sizeof(IncludedFile)));
+    if (!new_included) {
+      fprintf(stderr, "Out of memory\n");
       return -1;
     }
+    included_ = new_included;
+    included_capacity_ = new_cap;
   }
+  // Recorded before reading, so include cycles stop here
+  included_[included_count_++] = key;
+#endif
 
-  // Free compiler output if no word definitions
-  // (word definitions are kept alive and freed in destructor)
-  if (!has_word_defs) {
-    v4front_free(&buf);
+  if (st.st_size == 0) {
+    return 0;
+  }
+  size_t size = 0;
+  char* text = reinterpret_cast<char*>(map_file(path, &size, true));
+  if (!text) {
+    fprintf(stderr, "Cannot read '%s'\n", path);
+    return -1;
   }
 
-  return 0;  // Success
+  ChunkLexer lexer;
+  int errors = 0;
+  size_t chunk = 0;  // Start of the open chunk
+  unsigned long chunk_line = 1;
+  unsigned long chunk_col = 0;  // Columns before the chunk on its first line
+  unsigned long line = 0;
+
+  for (size_t pos = 0; pos < size;) {
+    const char* nl = static_cast<const char*>(memchr(text + pos, '\n', size - pos));
+    size_t line_end = nl ? (size_t) (nl - text) + 1 : size;
+    line++;
+
+    char name[1024];
+    if (chunk == pos && parse_include_line(text + pos, line_end - pos, name, sizeof(name))) {
+      char nested[2048];
+      resolve_include(path, name, nested, sizeof(nested));
+      if (include_file(nested, depth + 1) != 0) {
+        fprintf(stderr, "  included from %s:%lu\n", path, line);
+        errors++;
+      }
+      chunk = line_end;
+      chunk_line = line + 1;
+      chunk_col = 0;
+    } else {
+      size_t end = lexer.scan(text, pos, line_end);
+      if (end != 0) {
+        if (eval_include_chunk(path, text, size, chunk, end, chunk_line, chunk_col) != 0) {
+          errors++;
+        }
+        chunk = end;
+        chunk_line = (end == line_end) ? line + 1 : line;
+        chunk_col = (end == line_end) ? 0 : (unsigned long) (end - pos);
+      }
+    }
+    pos = line_end;
+  }
+
+  // Unterminated definition at end of file: compile it to report the error
+  if (chunk < size && !is_blank(text + chunk, size - chunk)) {
+    if (eval_include_chunk(path, text, size, chunk, size, chunk_line, chunk_col) != 0) {
+      errors++;
+    }
+  }
+
+  unmap_file(reinterpret_cast<uint8_t*>(text), size);
+
+  if (depth == 0 && interactive_) {
+    printf("Included %s (%lu lines, %d error%s)\n", path, line, errors, errors == 1 ? "" : "s");
+  }
+  return errors ? -1 : 0;
 }
 
 int Repl::run() {
@@ -522,6 +1397,11 @@ int Repl::run() {
   printf("Type '.help' for help\n");
   printf("Type '<<<' to enter PASTE mode\n\n");
 
+#ifndef _WIN32
+  g_completion_repl = this;
+  linenoiseSetCompletionCallback(complete_word);
+#endif
+
   while (true) {
 #ifndef _WIN32
     // Clear interrupt flag before reading input (Unix only)
@@ -541,7 +1421,7 @@ int Repl::run() {
       // If in PASTE mode, exit it
       if (paste_mode_) {
         paste_mode_ = false;
-        paste_buffer_size_ = 0;
+        paste_.reset();
         printf("PASTE mode interrupted\n");
       }
       g_interrupted = 0;
@@ -594,5 +1474,39 @@ int Repl::run() {
 #endif
   }
 
+#ifndef _WIN32
+  g_completion_repl = nullptr;
+#endif
   return 0;
 }
+
+int Repl::run_batch(FILE* in, const char* source_name) {
+  interactive_ = false;
+
+  LineReader reader(in);
+  if (!reader.ok()) {
+    fprintf(stderr, "Out of memory allocating input buffer\n");
+    return 1;
+  }
+
+  int errors = 0;
+  while (char* line = reader.next_line()) {
+    int result = eval_line(line);
+
+    if (result == 1) {
+      break;  // 'bye' / 'quit'
+    }
+    if (result < 0) {
+      fprintf(stderr, "  at %s:%lu\n", source_name, reader.line_number());
+      errors++;
+    }
+  }
+
+  // Unterminated PASTE block: compile what we have
+  if (paste_mode_ && exit_paste_mode() != 0) {
+    errors++;
+  }
+
+  print_stack();
+  return (errors > 0) ? 1 : 0;
+}
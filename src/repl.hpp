@@ -3,7 +3,19 @@
 #include <v4/vm_api.h>
 #include <v4front/compile.h>
 
+#include <cstdint>
+#include <cstdio>
+
+#include "code_map.hpp"
+#include "code_segment.hpp"
+#include "lazy_defs.h"
+#include "mem_watch.hpp"
+#include "paste_scanner.hpp"
 #include "meta_commands.hpp"
+#include "profiler.hpp"
+#include "snapshot.h"
+#include "word_deps.hpp"
+#include "word_index.h"
 
 /**
  * @brief Interactive REPL for V4 Forth VM
@@ -43,22 +55,265 @@ class Repl {
    */
   int run();
 
+  /**
+   * @brief Run the REPL non-interactively over a file or pipe
+   *
+   * Skips line editing, prompts and the per-line stack display.
+   * Only errors (with their input line number) and the final stack
+   * are reported. Stops at end of input or on 'bye'.
+   *
+   * @param in Input stream (e.g. stdin or an opened script file)
+   * @param source_name Name used in error locations (e.g. file path)
+   * @return Exit code (0 = success, 1 if any line failed)
+   */
+  int run_batch(FILE* in, const char* source_name);
+
+  /**
+   * @brief Compile, register and execute Forth code
+   *
+   * The evaluation core of eval_line(), without PASTE, meta-command or
+   * exit handling. Used directly by the .time meta-command.
+   *
+   * @param line Forth source to evaluate
+   * @param compile_ns If non-null, receives compile + registration time
+   * @param exec_ns If non-null, receives execution time
+   * @param compile_error If non-null, a compile error is stored here
+   *        instead of being printed, and -2 is returned
+   * @return 0 on success, -1 on error (already reported), -2 on an
+   *         unreported compile error
+   */
+  int eval_code(const char* line, uint64_t* compile_ns, uint64_t* exec_ns,
+                V4FrontError* compile_error = nullptr);
+
+  /**
+   * @brief Compile and execute a source file, definition by definition
+   *
+   * The file is memory-mapped and split in place into complete chunks
+   * (see ChunkLexer), which are compiled in order. Errors are reported
+   * as file:line:column. Lines of the form ".include <file>" include
+   * another file, relative to the including file. A file already
+   * included in this session is skipped unless it changed since.
+   *
+   * @param path File to include
+   * @param depth Nesting depth (0 for a top-level .include)
+   * @return 0 on success, -1 if the file could not be read or had errors
+   */
+  int include_file(const char* path, int depth = 0);
+
+  /**
+   * @brief Write words, data stack and VM memory to a session image
+   *
+   * Definitions recorded in lazy mode are compiled first; if one fails,
+   * nothing is written.
+   *
+   * @param path Output file
+   * @return 0 on success, -1 on error (already reported)
+   */
+  int save_image(const char* path);
+
+  /**
+   * @brief Replace the session with an image written by save_image()
+   *
+   * The file is mapped read-only (read into memory on Windows) and its
+   * bytecode is registered in place, so nothing is recompiled.
+   *
+   * @param path Image file
+   * @param source_path If non-null and the file exists, the image must
+   *                    have been compiled from its current contents
+   * @param verbose Print a summary on success
+   * @return 0 on success, -1 on error (already reported)
+   */
+  int load_image(const char* path, const char* source_path = nullptr, bool verbose = true);
+
+  /**
+   * @brief Compile a Forth source file into a bytecode bundle
+   *
+   * Evaluates @p source_path like batch mode, then writes the resulting
+   * word definitions to @p bundle_path together with a hash of the
+   * source. Stack contents and VM memory are not part of a bundle.
+   *
+   * @return Exit code (0 = bundle written)
+   */
+  int compile_bundle(const char* source_path, const char* bundle_path);
+
+  /**
+   * @brief Release all definitions after the VM dictionary was reset
+   */
+  void clear_definitions();
+
+  /**
+   * @brief Forget a word and every word defined after it (.forget)
+   *
+   * If @p name was redefined, its latest definition is forgotten and an
+   * earlier one that is still in use becomes visible again. Lazy
+   * definitions recorded after it are dropped; @p name may itself be a
+   * pending definition.
+   *
+   * @return Number of definitions forgotten, or -1 (already reported)
+   */
+  int forget_word(const char* name);
+
+  /**
+   * @brief Retire superseded words that no live word calls (.compact, .forget)
+   *
+   * Never done on redefinition alone: an execution token for the old
+   * word may still be on the stack or in memory. Once retired, executing
+   * such a token fails (see v4repl_retire_word()).
+   */
+  void retire_superseded();
+
+  /**
+   * @brief Re-pack word bytecode into a fresh code segment (.compact)
+   *
+   * Live words are copied back to back in call-graph order, closing the
+   * holes left by retired and forgotten words, and their VM entries are
+   * pointed at the copies. Superseded words are kept unless
+   * retire_superseded() ran first.
+   *
+   * @param extra Free space to leave for new definitions
+   * @return false on allocation failure (the old segment stays in use)
+   */
+  bool compact_code(size_t extra = 0);
+
+  /**
+   * @brief Segment holding the bytecode of words defined in this session
+   */
+  const CodeSegment& code_segment() const {
+    return segment_;
+  }
+
+  /**
+   * @brief Code segment bytes .compact would reclaim
+   *
+   * Holes left by retired and forgotten words, plus the superseded words
+   * retire_superseded() would retire.
+   */
+  size_t reclaimable_code_bytes() const;
+
+  /**
+   * @brief Sampling profiler attached to code executed by eval_code()
+   */
+  Profiler& profiler() {
+    return profiler_;
+  }
+
+  /**
+   * @brief Record definitions instead of compiling them until first use
+   *
+   * In lazy mode, code made only of colon definitions is kept as source
+   * (see lazy_defs.h); eval_code() compiles the pending words a line
+   * refers to just before compiling the line.
+   */
+  void set_lazy(bool on) {
+    lazy_mode_ = on;
+  }
+
+  /**
+   * @brief Definitions recorded in lazy mode and not compiled yet
+   */
+  V4ReplLazyTable& lazy_defs() {
+    return lazy_;
+  }
+
+  /**
+   * @brief Name <-> word ID index of every word defined in this session
+   */
+  V4ReplWordIndex& word_index() {
+    return words_;
+  }
+
+  /**
+   * @brief Memory regions reported after every evaluated line (.watch)
+   */
+  MemWatch& mem_watch() {
+    return mem_watch_;
+  }
+
+  /**
+   * @brief Copy a block of VM RAM in one call
+   *
+   * @param addr VM address of the first byte
+   * @param dst Destination buffer
+   * @param len Number of bytes requested
+   * @return Number of bytes copied (fewer than @p len at the end of RAM)
+   */
+  size_t read_memory(uint32_t addr, uint8_t* dst, size_t len) const;
+
+  /**
+   * @brief Size of VM RAM in bytes
+   */
+  size_t memory_size() const {
+    return sizeof(vm_memory_);
+  }
+
+  /**
+   * @brief Code ranges of all words, rebuilt if definitions changed
+   */
+  const CodeMap& code_map();
+
  private:
   struct Vm* vm_;
   V4FrontContext* compiler_ctx_;
   uint8_t vm_memory_[16384];  // 16KB RAM for VM
+  MemWatch mem_watch_;         // .watch regions over vm_memory_
   MetaCommands meta_cmds_;
+  Profiler profiler_;
+
+  // Bytecode of every word defined in this session (the VM points into it).
+  // Compiler output is copied here and freed once the line has run.
+  CodeSegment segment_;
+
+  // Location and callers of each word; superseded words nothing calls
+  // any more are retired by reclaim() on request and dropped by the next
+  // repack
+  WordDeps deps_;
+  void reclaim(int wid);
+
+  // Registered words in order, and the loaded image their bytecode may live in
+  V4ReplDefLog defs_;
+  uint8_t* image_;
+  size_t image_size_;
+  void release_image();
+  V4ReplDef* find_def(int wid);
+
+  // Hash index over defs_ for .see, .words <prefix> and tab completion
+  V4ReplWordIndex words_;
+
+  // Lazy mode: definitions waiting for their first use
+  bool lazy_mode_;
+  V4ReplLazyTable lazy_;
+  static int compile_lazy(void* user, const char* name, const char* source);
+
+  // Where each defs_ entry was entered relative to the lazy definitions
+  // (its own position if it was one, else lazy_.count when registered), so
+  // that .forget can tell which pending definitions came after a word
+  int* lazy_marks_;
+  int lazy_marks_capacity_;
+  int lazy_entry_;  // Position of the definition compile_lazy() is compiling, or -1
+  bool mark_lazy(int def);
+
+  // Address -> word table over defs_ for .rstack, backtraces and the profiler
+  CodeMap code_map_;
+  bool code_map_stale_;
 
-  // Track word definition buffers (must not be freed while VM is alive)
-  V4FrontBuf* word_bufs_;
-  int word_buf_count_;
-  int word_buf_capacity_;
+  // Interactive (linenoise) or batch input
+  bool interactive_;
 
-  // PASTE mode state
+  // Files loaded by .include, keyed by device and inode (include-once guard)
+  struct IncludedFile {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime;
+  };
+  IncludedFile* included_;
+  int included_count_;
+  int included_capacity_;
+  int eval_include_chunk(const char* path, char* text, size_t size, size_t start, size_t end,
+                         unsigned long line, unsigned long column);
+
+  // PASTE mode state: complete definitions are compiled as they arrive
   bool paste_mode_;
-  char* paste_buffer_;
-  int paste_buffer_size_;
-  int paste_buffer_capacity_;
+  PasteScanner paste_;
 
 #ifdef WITH_FILESYSTEM
   char history_path_[256];
@@ -81,6 +336,11 @@ class Repl {
    */
   void print_error(const char* msg, int code = 0);
 
+  /**
+   * @brief Print the return stack as a symbolized call trace (if non-empty)
+   */
+  void print_backtrace();
+
   /**
    * @brief Evaluate a single line of input
    *
@@ -103,8 +363,22 @@ class Repl {
 
   /**
    * @brief Exit PASTE mode and compile buffered input
+   *
+   * @return 0 on success, -1 if the unterminated rest failed (already reported)
+   */
+  int exit_paste_mode();
+
+  /**
+   * @brief Compile and execute PASTE input completed by the latest line
+   *
+   * @return 0 on success, -1 if a chunk failed (already reported)
+   */
+  int eval_paste_chunks();
+
+  /**
+   * @brief Note which PASTE lines a failed chunk came from
    */
-  void exit_paste_mode();
+  void print_paste_location(unsigned long first_line);
 
   /**
    * @brief Get the current prompt string
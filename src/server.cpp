@@ -0,0 +1,516 @@
+#include "server.hpp"
+
+#include <v4/vm_api.h>
+#include <v4front/compile.h>
+#include <v4repl/repl.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t FRAME_HEADER_SIZE = 4;
+static const size_t RESPONSE_PREFIX_SIZE = FRAME_HEADER_SIZE + 1;  // + status byte
+static const uint32_t MAX_FRAME_SIZE = 64 * 1024;
+static const size_t READ_CHUNK = 4096;
+
+// Queued output at which a session stops taking requests until the client
+// reads, and the most a session may queue before it is disconnected
+static const size_t OUTPUT_HIGH_WATER = 64 * 1024;
+static const size_t MAX_PENDING_OUTPUT = 1024 * 1024;
+static const int MAX_EVENTS = 64;
+
+static const uint8_t STATUS_OK = 0;
+static const uint8_t STATUS_ERROR = 1;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void stop_handler(int sig) {
+  (void) sig;
+  g_stop = 1;
+}
+
+/**
+ * @brief One client connection
+ *
+ * Everything except the fd and list links is allocated on demand: the
+ * VM on the first request, the I/O buffers only while they hold data.
+ */
+struct Server::Session {
+  int fd;
+  Session* prev;
+  Session* next;
+
+  // Created by start_session() on the first request
+  uint8_t* vm_mem;
+  struct Vm* vm;
+  V4FrontContext* front_ctx;
+  V4ReplContext* repl;
+
+  // Incoming bytes (capacity excludes one spare byte for a NUL)
+  char* rbuf;
+  size_t rlen;
+  size_t rcap;
+
+  // Outgoing frames
+  char* wbuf;
+  size_t wlen;
+  size_t woff;
+  size_t wcap;
+
+  uint32_t events;  // Registered epoll events
+  bool throttled;   // Requests held back until queued output drains
+  bool out_of_memory;
+  bool overflow;    // Output beyond MAX_PENDING_OUTPUT
+};
+
+static bool reserve(char** buf, size_t* cap, size_t needed, size_t spare) {
+  if (needed <= *cap) {
+    return true;
+  }
+
+  size_t new_cap = (*cap == 0) ? READ_CHUNK : *cap;
+  while (new_cap < needed) {
+    new_cap *= 2;
+  }
+
+  char* new_buf = (char*) realloc(*buf, new_cap + spare);
+  if (!new_buf) {
+    return false;
+  }
+  *buf = new_buf;
+  *cap = new_cap;
+  return true;
+}
+
+// libv4repl output sink: append to the session's pending response
+static void session_write(void* user, const char* data, size_t len) {
+  Server::Session* s = static_cast<Server::Session*>(user);
+  if (s->wlen - s->woff + len > MAX_PENDING_OUTPUT) {
+    s->overflow = true;
+    return;
+  }
+  if (!reserve(&s->wbuf, &s->wcap, s->wlen + len, 0)) {
+    s->out_of_memory = true;
+    return;
+  }
+  memcpy(s->wbuf + s->wlen, data, len);
+  s->wlen += len;
+}
+
+static void put_u32le(char* p, uint32_t v) {
+  p[0] = (char) (v & 0xFF);
+  p[1] = (char) ((v >> 8) & 0xFF);
+  p[2] = (char) ((v >> 16) & 0xFF);
+  p[3] = (char) ((v >> 24) & 0xFF);
+}
+
+static uint32_t get_u32le(const char* p) {
+  const uint8_t* u = (const uint8_t*) p;
+  return (uint32_t) u[0] | ((uint32_t) u[1] << 8) | ((uint32_t) u[2] << 16) |
+         ((uint32_t) u[3] << 24);
+}
+
+Server::Server(size_t session_mem_size)
+    : session_mem_size_(session_mem_size),
+      listen_fd_(-1),
+      epoll_fd_(-1),
+      socket_path_(nullptr),
+      sessions_(nullptr),
+      session_count_(0) {}
+
+Server::~Server() {
+  while (sessions_) {
+    close_session(sessions_);
+  }
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(socket_path_);
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+}
+
+bool Server::listen_on(const char* socket_path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", socket_path);
+    return false;
+  }
+  strcpy(addr.sun_path, socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return false;
+  }
+
+  // Replace a stale socket from a previous run, but never any other file
+  struct stat st;
+  if (lstat(socket_path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      fprintf(stderr, "%s exists and is not a socket; not replacing it\n", socket_path);
+      close(fd);
+      return false;
+    }
+    unlink(socket_path);
+  } else if (errno != ENOENT) {
+    perror(socket_path);
+    close(fd);
+    return false;
+  }
+
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+    perror("bind");
+    close(fd);
+    return false;
+  }
+  if (listen(fd, SOMAXCONN) != 0) {
+    perror("listen");
+    close(fd);
+    unlink(socket_path);
+    return false;
+  }
+
+  listen_fd_ = fd;
+  socket_path_ = socket_path;
+  return true;
+}
+
+int Server::run(const char* socket_path) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    perror("epoll_create1");
+    return 1;
+  }
+
+  if (!listen_on(socket_path)) {
+    return 1;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = nullptr;  // nullptr marks the listening socket
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) != 0) {
+    perror("epoll_ctl");
+    return 1;
+  }
+
+  // No SA_RESTART: epoll_wait must return so the loop sees g_stop
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop_handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  fprintf(stderr, "Serving on %s (%zu bytes VM RAM per session)\n", socket_path,
+          session_mem_size_);
+
+  struct epoll_event events[MAX_EVENTS];
+  while (!g_stop) {
+    int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait");
+      return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+      Session* s = static_cast<Session*>(events[i].data.ptr);
+      if (!s) {
+        accept_clients();
+        continue;
+      }
+
+      uint32_t flags = events[i].events;
+      bool ok = true;
+      if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ok = handle_readable(s);
+      }
+      if (ok && (flags & EPOLLOUT)) {
+        ok = handle_writable(s);
+      }
+      if (!ok) {
+        close_session(s);
+      }
+    }
+  }
+
+  fprintf(stderr, "Shutting down (%d sessions open)\n", session_count_);
+  return 0;
+}
+
+void Server::accept_clients() {
+  while (true) {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("accept4");  // e.g. EMFILE; retried on the next event
+      }
+      return;
+    }
+
+    Session* s = (Session*) calloc(1, sizeof(Session));
+    if (!s) {
+      close(fd);
+      continue;
+    }
+    s->fd = fd;
+    s->events = EPOLLIN;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = s->events;
+    ev.data.ptr = s;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      close(fd);
+      free(s);
+      continue;
+    }
+
+    s->next = sessions_;
+    if (sessions_) {
+      sessions_->prev = s;
+    }
+    sessions_ = s;
+    session_count_++;
+  }
+}
+
+bool Server::start_session(Session* s) {
+  s->vm_mem = (uint8_t*) calloc(1, session_mem_size_);
+  if (!s->vm_mem) {
+    return false;
+  }
+
+  VmConfig cfg = {0};
+  cfg.mem = s->vm_mem;
+  cfg.mem_size = session_mem_size_;
+  cfg.mmio = nullptr;
+  cfg.mmio_count = 0;
+  cfg.arena = nullptr;
+
+  s->vm = vm_create(&cfg);
+  if (!s->vm) {
+    return false;
+  }
+
+  s->front_ctx = v4front_context_create();
+  if (!s->front_ctx) {
+    return false;
+  }
+
+  V4ReplConfig repl_cfg;
+  memset(&repl_cfg, 0, sizeof(repl_cfg));
+  repl_cfg.vm = s->vm;
+  repl_cfg.front_ctx = s->front_ctx;
+  repl_cfg.write = session_write;
+  repl_cfg.write_user = s;
+
+  s->repl = v4_repl_create(&repl_cfg);
+  return s->repl != nullptr;
+}
+
+void Server::close_session(Session* s) {
+  close(s->fd);  // Also removes it from the epoll set
+
+  if (s->repl) {
+    v4_repl_destroy(s->repl);
+  }
+  if (s->front_ctx) {
+    v4front_context_destroy(s->front_ctx);
+  }
+  if (s->vm) {
+    vm_destroy(s->vm);
+  }
+  free(s->vm_mem);
+  free(s->rbuf);
+  free(s->wbuf);
+
+  if (s->prev) {
+    s->prev->next = s->next;
+  } else {
+    sessions_ = s->next;
+  }
+  if (s->next) {
+    s->next->prev = s->prev;
+  }
+  session_count_--;
+
+  free(s);
+}
+
+bool Server::handle_readable(Session* s) {
+  while (true) {
+    if (!reserve(&s->rbuf, &s->rcap, s->rlen + READ_CHUNK, 1)) {
+      return false;
+    }
+
+    ssize_t n = recv(s->fd, s->rbuf + s->rlen, s->rcap - s->rlen, 0);
+    if (n > 0) {
+      s->rlen += (size_t) n;
+      if (!process_frames(s)) {
+        return false;
+      }
+      if (s->throttled) {
+        break;  // Leave further requests in the socket until output drains
+      }
+      continue;
+    }
+    if (n == 0) {
+      return false;  // Peer closed
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    return false;
+  }
+
+  // Idle sessions keep no read buffer
+  if (s->rlen == 0) {
+    free(s->rbuf);
+    s->rbuf = nullptr;
+    s->rcap = 0;
+  }
+
+  return handle_writable(s);
+}
+
+bool Server::process_frames(Session* s) {
+  size_t pos = 0;
+
+  while (s->rlen - pos >= FRAME_HEADER_SIZE) {
+    uint32_t len = get_u32le(s->rbuf + pos);
+    if (len > MAX_FRAME_SIZE) {
+      return false;  // Protocol error
+    }
+    if (s->rlen - pos - FRAME_HEADER_SIZE < len) {
+      break;  // Incomplete frame
+    }
+
+    // A client that does not read its responses gets no more answers until it does
+    if (s->wlen - s->woff >= OUTPUT_HIGH_WATER) {
+      s->throttled = true;
+      break;
+    }
+
+    if (!s->repl && !start_session(s)) {
+      return false;
+    }
+
+    // NUL-terminate the payload in place (rbuf has a spare byte)
+    char* payload = s->rbuf + pos + FRAME_HEADER_SIZE;
+    char saved = payload[len];
+    payload[len] = '\0';
+
+    // Reserve the response header; the sink appends the text after it
+    size_t start = s->wlen;
+    if (!reserve(&s->wbuf, &s->wcap, start + RESPONSE_PREFIX_SIZE, 0)) {
+      return false;
+    }
+    s->wlen += RESPONSE_PREFIX_SIZE;
+
+    v4_err err = v4_repl_process_line(s->repl, payload);
+    if (err == 0) {
+      v4_repl_print_stack(s->repl);
+    } else {
+      v4_repl_print_error(s->repl);
+    }
+    payload[len] = saved;
+
+    if (s->out_of_memory || s->overflow) {
+      return false;
+    }
+
+    put_u32le(s->wbuf + start, (uint32_t) (s->wlen - start - FRAME_HEADER_SIZE));
+    s->wbuf[start + FRAME_HEADER_SIZE] = (char) (err == 0 ? STATUS_OK : STATUS_ERROR);
+
+    pos += FRAME_HEADER_SIZE + len;
+  }
+
+  if (pos > 0) {
+    memmove(s->rbuf, s->rbuf + pos, s->rlen - pos);
+    s->rlen -= pos;
+  }
+  return true;
+}
+
+bool Server::handle_writable(Session* s) {
+  while (true) {
+    while (s->woff < s->wlen) {
+      ssize_t n = send(s->fd, s->wbuf + s->woff, s->wlen - s->woff, MSG_NOSIGNAL);
+      if (n > 0) {
+        s->woff += (size_t) n;
+        continue;
+      }
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return update_events(s, true);
+      }
+      return false;
+    }
+
+    // Everything sent: drop the buffer until the next response
+    free(s->wbuf);
+    s->wbuf = nullptr;
+    s->wlen = 0;
+    s->woff = 0;
+    s->wcap = 0;
+
+    // Requests held back while the client was not reading can run now
+    if (!s->throttled) {
+      break;
+    }
+    s->throttled = false;
+    if (!process_frames(s)) {
+      return false;
+    }
+  }
+  return update_events(s, false);
+}
+
+bool Server::update_events(Session* s, bool want_write) {
+  // A throttled session is not read from until its output drains
+  uint32_t events = s->throttled ? 0 : (uint32_t) EPOLLIN;
+  if (want_write) {
+    events |= EPOLLOUT;
+  }
+  if (s->events == events) {
+    return true;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.ptr = s;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, s->fd, &ev) != 0) {
+    return false;
+  }
+  s->events = events;
+  return true;
+}
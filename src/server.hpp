@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Multi-session REPL server over a Unix domain socket
+ *
+ * Accepts many clients on one socket and serves them from a single
+ * epoll event loop. Every connection is an independent session with its
+ * own VM, compiler context and libv4repl context, created lazily when
+ * the first request arrives, so idle connections cost only a few bytes.
+ *
+ * Wire format (both directions): a 4-byte little-endian payload length
+ * followed by the payload.
+ * - Request payload:  Forth source to evaluate (one or more lines)
+ * - Response payload: status byte (0 = ok, 1 = error) followed by text,
+ *                     either the stack line (" ok [n]: ...\n") or
+ *                     "Error: ...\n"
+ *
+ * Responses are sent in request order. A client that stops reading is
+ * not served further requests until its queued responses drain, and is
+ * disconnected if one request queues more than the output limit (1 MB).
+ * Meta-commands and PASTE markers are not interpreted, and output from
+ * Forth words that print (e.g. ".") still goes to the server's stdout.
+ *
+ * Sessions are independent in state, not in time: requests are evaluated
+ * inline on the event loop thread, and the VM has no instruction budget
+ * or way to interrupt running bytecode. A request that runs for a long
+ * time (or never ends, e.g. `: L BEGIN AGAIN ; L`) stalls every other
+ * session until it finishes. Only serve trusted clients.
+ *
+ * Available on Linux only.
+ */
+class Server {
+ public:
+  /**
+   * @brief Construct a server
+   *
+   * @param session_mem_size Bytes of VM RAM per session
+   */
+  explicit Server(size_t session_mem_size);
+
+  /**
+   * @brief Close all sessions and the listening socket
+   */
+  ~Server();
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  /**
+   * @brief Bind @p socket_path and serve until SIGINT or SIGTERM
+   *
+   * An existing socket at @p socket_path is replaced; any other kind of
+   * file there is an error. The socket is removed again on exit.
+   *
+   * @return Exit code (0 = clean shutdown)
+   */
+  int run(const char* socket_path);
+
+  struct Session;  // Per-connection state (defined in server.cpp)
+
+ private:
+  size_t session_mem_size_;
+  int listen_fd_;
+  int epoll_fd_;
+  const char* socket_path_;
+  Session* sessions_;  // Doubly linked list of open sessions
+  int session_count_;
+
+  bool listen_on(const char* socket_path);
+  void accept_clients();
+  void close_session(Session* s);
+  bool start_session(Session* s);
+  bool handle_readable(Session* s);
+  bool handle_writable(Session* s);
+  bool process_frames(Session* s);
+  bool update_events(Session* s, bool want_write);
+};
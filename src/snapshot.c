@@ -0,0 +1,303 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_MAGIC "V4RI"
+#define IMAGE_HEADER_SIZE 36
+#define IMAGE_WORD_SIZE 16
+#define DEFLOG_INITIAL_CAPACITY 16
+
+/* ------------------------------------------------------------------------- */
+/* Definition log                                                            */
+/* ------------------------------------------------------------------------- */
+
+int v4repl_deflog_append(V4ReplDefLog* log, int32_t wid, const char* name, const uint8_t* code,
+                         uint32_t code_len) {
+  if (log->count >= log->capacity) {
+    int new_cap = log->capacity ? log->capacity * 2 : DEFLOG_INITIAL_CAPACITY;
+    V4ReplDef* new_defs = (V4ReplDef*) realloc(log->defs, new_cap * sizeof(V4ReplDef));
+    if (!new_defs) {
+      return -1;
+    }
+    log->defs = new_defs;
+    log->capacity = new_cap;
+  }
+
+  size_t name_len = strlen(name);
+  char* name_copy = (char*) malloc(name_len + 1);
+  if (!name_copy) {
+    return -1;
+  }
+  memcpy(name_copy, name, name_len + 1);
+
+  V4ReplDef* def = &log->defs[log->count++];
+  def->wid = wid;
+  def->name = name_copy;
+  def->code = code;
+  def->code_len = code_len;
+  return 0;
+}
+
+void v4repl_deflog_truncate(V4ReplDefLog* log, int count) {
+  for (int i = count; i < log->count; ++i) {
+    free((char*) log->defs[i].name);
+  }
+  if (count < log->count) {
+    log->count = count;
+  }
+}
+
+void v4repl_deflog_clear(V4ReplDefLog* log) {
+  v4repl_deflog_truncate(log, 0);
+}
+
+void v4repl_deflog_free(V4ReplDefLog* log) {
+  v4repl_deflog_clear(log);
+  free(log->defs);
+  log->defs = NULL;
+  log->capacity = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Encoding helpers                                                          */
+/* ------------------------------------------------------------------------- */
+
+static size_t align4(size_t n) {
+  return (n + 3) & ~(size_t) 3;
+}
+
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t) v;
+  p[1] = (uint8_t) (v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t) v;
+  p[1] = (uint8_t) (v >> 8);
+  p[2] = (uint8_t) (v >> 16);
+  p[3] = (uint8_t) (v >> 24);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+  return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+         ((uint32_t) p[3] << 24);
+}
+
+uint32_t v4repl_hash(uint32_t h, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*) data;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* Section sizes shared by v4repl_image_size() and v4repl_image_write() */
+static void section_sizes(const V4ReplDefLog* log, size_t* names_size, size_t* code_size) {
+  *names_size = 0;
+  *code_size = 0;
+  for (int i = 0; i < log->count; ++i) {
+    *names_size += strlen(log->defs[i].name) + 1;
+    *code_size += align4(log->defs[i].code_len);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Writing                                                                   */
+/* ------------------------------------------------------------------------- */
+
+size_t v4repl_image_size(const V4ReplDefLog* log, struct Vm* vm, size_t mem_size) {
+  size_t names_size, code_size;
+  section_sizes(log, &names_size, &code_size);
+  size_t ds_depth = vm ? (size_t) vm_ds_depth_public(vm) : 0;
+  return IMAGE_HEADER_SIZE + (size_t) log->count * IMAGE_WORD_SIZE + ds_depth * 4 +
+         align4(names_size) + code_size + align4(mem_size);
+}
+
+size_t v4repl_image_write(const V4ReplDefLog* log, struct Vm* vm, const uint8_t* mem,
+                          size_t mem_size, uint32_t source_hash, uint8_t* out, size_t out_size) {
+  if (!mem) {
+    mem_size = 0;
+  }
+  size_t total = v4repl_image_size(log, vm, mem_size);
+  if (!out || out_size < total) {
+    return 0;
+  }
+  memset(out, 0, total);
+
+  size_t names_size, code_size;
+  section_sizes(log, &names_size, &code_size);
+  int ds_depth = vm ? vm_ds_depth_public(vm) : 0;
+
+  uint8_t* words = out + IMAGE_HEADER_SIZE;
+  uint8_t* stack = words + (size_t) log->count * IMAGE_WORD_SIZE;
+  uint8_t* names = stack + (size_t) ds_depth * 4;
+  uint8_t* code = names + align4(names_size);
+  uint8_t* mem_out = code + code_size;
+
+  size_t name_off = 0;
+  size_t code_off = 0;
+  for (int i = 0; i < log->count; ++i) {
+    const V4ReplDef* def = &log->defs[i];
+    uint8_t* entry = words + (size_t) i * IMAGE_WORD_SIZE;
+    put_u32(entry, (uint32_t) def->wid);
+    put_u32(entry + 4, (uint32_t) name_off);
+    put_u32(entry + 8, (uint32_t) code_off);
+    put_u32(entry + 12, def->code_len);
+
+    size_t name_len = strlen(def->name) + 1;
+    memcpy(names + name_off, def->name, name_len);
+    name_off += name_len;
+
+    if (def->code_len > 0) {
+      memcpy(code + code_off, def->code, def->code_len);
+    }
+    code_off += align4(def->code_len);
+  }
+
+  /* Bottom of the stack first, so a restore can push in order */
+  for (int i = 0; i < ds_depth; ++i) {
+    put_u32(stack + (size_t) i * 4, (uint32_t) vm_ds_peek_public(vm, ds_depth - 1 - i));
+  }
+
+  if (mem_size > 0) {
+    memcpy(mem_out, mem, mem_size);
+  }
+
+  memcpy(out, IMAGE_MAGIC, 4);
+  put_u16(out + 4, V4REPL_IMAGE_VERSION);
+  put_u32(out + 8, (uint32_t) log->count);
+  put_u32(out + 12, (uint32_t) ds_depth);
+  put_u32(out + 16, (uint32_t) mem_size);
+  put_u32(out + 20, (uint32_t) names_size);
+  put_u32(out + 24, (uint32_t) code_size);
+  put_u32(out + 28, source_hash);
+  put_u32(out + 32,
+          v4repl_hash(V4REPL_HASH_SEED, out + IMAGE_HEADER_SIZE, total - IMAGE_HEADER_SIZE));
+  return total;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reading                                                                   */
+/* ------------------------------------------------------------------------- */
+
+int v4repl_image_open(V4ReplImage* img, const uint8_t* data, size_t len, char* err,
+                      size_t err_size) {
+  memset(img, 0, sizeof(*img));
+
+  if (!data || len < IMAGE_HEADER_SIZE || memcmp(data, IMAGE_MAGIC, 4) != 0) {
+    snprintf(err, err_size, "Not a V4 REPL image");
+    return -1;
+  }
+  uint16_t version = get_u16(data + 4);
+  if (version != V4REPL_IMAGE_VERSION) {
+    snprintf(err, err_size, "Unsupported image version %u (expected %u)", (unsigned) version,
+             (unsigned) V4REPL_IMAGE_VERSION);
+    return -1;
+  }
+
+  img->word_count = get_u32(data + 8);
+  img->ds_depth = get_u32(data + 12);
+  img->mem_size = get_u32(data + 16);
+  img->names_size = get_u32(data + 20);
+  img->code_size = get_u32(data + 24);
+  img->source_hash = get_u32(data + 28);
+
+  /* 64-bit arithmetic: a corrupt header must not wrap the bounds check */
+  uint64_t expected = (uint64_t) IMAGE_HEADER_SIZE +
+                      (uint64_t) img->word_count * IMAGE_WORD_SIZE +
+                      (uint64_t) img->ds_depth * 4 + align4(img->names_size) + img->code_size +
+                      align4(img->mem_size);
+  if (expected != len) {
+    snprintf(err, err_size, "Image size mismatch: header describes %llu bytes, got %llu",
+             (unsigned long long) expected, (unsigned long long) len);
+    return -1;
+  }
+  if (get_u32(data + 32) != v4repl_hash(V4REPL_HASH_SEED, data + IMAGE_HEADER_SIZE,
+                                        len - IMAGE_HEADER_SIZE)) {
+    snprintf(err, err_size, "Image checksum mismatch");
+    return -1;
+  }
+
+  img->words = data + IMAGE_HEADER_SIZE;
+  img->stack = img->words + (size_t) img->word_count * IMAGE_WORD_SIZE;
+  img->names = (const char*) (img->stack + (size_t) img->ds_depth * 4);
+  img->code = (const uint8_t*) img->names + align4(img->names_size);
+  img->mem = img->code + img->code_size;
+
+  /* Every word must point inside its sections, with a terminated name */
+  for (uint32_t i = 0; i < img->word_count; ++i) {
+    const uint8_t* entry = img->words + (size_t) i * IMAGE_WORD_SIZE;
+    uint32_t name_off = get_u32(entry + 4);
+    uint32_t code_off = get_u32(entry + 8);
+    uint32_t code_len = get_u32(entry + 12);
+    if (name_off >= img->names_size ||
+        !memchr(img->names + name_off, '\0', img->names_size - name_off) ||
+        (uint64_t) code_off + code_len > img->code_size) {
+      snprintf(err, err_size, "Corrupt word table entry %u", (unsigned) i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int v4repl_image_apply(const V4ReplImage* img, struct Vm* vm, V4FrontContext* front,
+                       const uint8_t* code_base, V4ReplDefLog* log, uint8_t* mem, size_t mem_size,
+                       char* err, size_t err_size) {
+  if (mem && img->mem_size > 0 && img->mem_size != mem_size) {
+    snprintf(err, err_size, "Image has %u bytes of VM memory, session has %u",
+             (unsigned) img->mem_size, (unsigned) mem_size);
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < img->word_count; ++i) {
+    const uint8_t* entry = img->words + (size_t) i * IMAGE_WORD_SIZE;
+    int32_t saved_wid = (int32_t) get_u32(entry);
+    const char* name = img->names + get_u32(entry + 4);
+    const uint8_t* code = code_base + get_u32(entry + 8);
+    uint32_t code_len = get_u32(entry + 12);
+
+    int wid = vm_register_word(vm, name, code, (int) code_len);
+    if (wid < 0) {
+      snprintf(err, err_size, "Failed to register word '%s': error %d", name, wid);
+      return wid;
+    }
+    /* Bytecode calls words by ID, so IDs must line up exactly */
+    if (wid != saved_wid) {
+      snprintf(err, err_size, "Word '%s' got ID %d, image expects %d", name, wid, (int) saved_wid);
+      return -1;
+    }
+
+    v4front_err ctx_err = v4front_context_register_word(front, name, wid);
+    if (ctx_err != 0) {
+      snprintf(err, err_size, "Failed to register word '%s' to compiler: error %d", name,
+               ctx_err);
+      return ctx_err;
+    }
+
+    if (v4repl_deflog_append(log, wid, name, code, code_len) != 0) {
+      snprintf(err, err_size, "Out of memory tracking word definitions");
+      return -1;
+    }
+  }
+
+  vm_ds_clear(vm);
+  for (uint32_t i = 0; i < img->ds_depth; ++i) {
+    v4_err push_err = vm_ds_push(vm, (v4_i32) get_u32(img->stack + (size_t) i * 4));
+    if (push_err != 0) {
+      snprintf(err, err_size, "Failed to restore data stack: error %d", push_err);
+      return push_err;
+    }
+  }
+
+  if (mem && img->mem_size > 0) {
+    memcpy(mem, img->mem, img->mem_size);
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+/*
+ * Session images
+ *
+ * A session image holds everything needed to rebuild a REPL session
+ * without recompiling: every registered word (in registration order,
+ * with its VM word ID and bytecode), the data stack and, optionally, VM
+ * memory. The layout is position-independent so an image can be mapped
+ * read-only and its bytecode registered in place.
+ *
+ * A bytecode bundle is an image without stack or memory whose
+ * source_hash identifies the Forth source it was compiled from.
+ *
+ * Layout (all integers little-endian, sections 4-byte aligned):
+ *
+ *   header   36 bytes: magic "V4RI", u16 version, u16 reserved,
+ *            u32 word_count, ds_depth, mem_size, names_size, code_size,
+ *            source_hash (0 = none), checksum (FNV-1a over everything
+ *            after the header)
+ *   words    word_count x { i32 wid, u32 name_off, u32 code_off, u32 code_len }
+ *   stack    ds_depth x i32, bottom first
+ *   names    NUL-terminated names, name_off relative to this section
+ *   code     bytecode, code_off relative to this section
+ *   memory   mem_size bytes of VM RAM
+ *
+ * Shared by libv4repl (C) and the v4-repl executable (C++).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "v4/vm_api.h"
+#include "v4front/compile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define V4REPL_IMAGE_VERSION 1
+
+/* FNV-1a, used for image checksums and bundle source hashes */
+#define V4REPL_HASH_SEED 2166136261u
+uint32_t v4repl_hash(uint32_t h, const void* data, size_t len);
+
+/**
+ * @brief One registered word
+ */
+typedef struct V4ReplDef {
+  int32_t wid;         /* VM word ID returned by vm_register_word() */
+  const char* name;    /* Owned by the log; borrowed in image views */
+  const uint8_t* code; /* Bytecode the VM executes (not owned) */
+  uint32_t code_len;
+} V4ReplDef;
+
+/**
+ * @brief Words in the order they were registered
+ *
+ * Replaying the log into an empty dictionary reproduces the same word IDs,
+ * so bytecode that calls words by ID stays valid.
+ */
+typedef struct V4ReplDefLog {
+  V4ReplDef* defs;
+  int count;
+  int capacity;
+} V4ReplDefLog;
+
+/* Record a registration (the name is copied); returns 0 or -1 on OOM */
+int v4repl_deflog_append(V4ReplDefLog* log, int32_t wid, const char* name, const uint8_t* code,
+                         uint32_t code_len);
+
+/* Forget the entries from index count on */
+void v4repl_deflog_truncate(V4ReplDefLog* log, int count);
+
+/* Forget all entries but keep the allocation */
+void v4repl_deflog_clear(V4ReplDefLog* log);
+
+/* Release everything */
+void v4repl_deflog_free(V4ReplDefLog* log);
+
+/**
+ * @brief Validated, read-only view of an image
+ */
+typedef struct V4ReplImage {
+  const uint8_t* words;
+  const uint8_t* stack;
+  const char* names;
+  const uint8_t* code;
+  const uint8_t* mem;
+  uint32_t word_count;
+  uint32_t ds_depth;
+  uint32_t names_size;
+  uint32_t code_size;
+  uint32_t mem_size;
+  uint32_t source_hash;
+} V4ReplImage;
+
+/*
+ * Bytes needed for an image of the log, the VM's data stack (none if vm
+ * is NULL) and mem_size bytes of RAM
+ */
+size_t v4repl_image_size(const V4ReplDefLog* log, struct Vm* vm, size_t mem_size);
+
+/*
+ * Serialize into out (at least v4repl_image_size() bytes).
+ * vm may be NULL to leave the data stack out, mem to leave VM memory out.
+ * Returns the number of bytes written, or 0 if out is too small.
+ */
+size_t v4repl_image_write(const V4ReplDefLog* log, struct Vm* vm, const uint8_t* mem,
+                          size_t mem_size, uint32_t source_hash, uint8_t* out, size_t out_size);
+
+/*
+ * Check magic, version, bounds and checksum and fill in a view.
+ * Returns 0 on success, -1 with a message in err otherwise.
+ */
+int v4repl_image_open(V4ReplImage* img, const uint8_t* data, size_t len, char* err,
+                      size_t err_size);
+
+/*
+ * Rebuild the session from a view into an empty dictionary.
+ *
+ * Words are registered with bytecode at code_base + code_off, where
+ * code_base is img->code (run in place) or a copy of that section. Each
+ * word must receive the ID it had when the image was written. Registered
+ * words are appended to log. The data stack is replaced; VM memory is
+ * copied only when mem is non-NULL and the image contains memory.
+ *
+ * Returns 0 on success, or a negative error with a message in err.
+ */
+int v4repl_image_apply(const V4ReplImage* img, struct Vm* vm, V4FrontContext* front,
+                       const uint8_t* code_base, V4ReplDefLog* log, uint8_t* mem, size_t mem_size,
+                       char* err, size_t err_size);
+
+#ifdef __cplusplus
+}
+#endif
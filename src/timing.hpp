@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @brief Read a monotonic clock in nanoseconds
+ */
+inline uint64_t monotonic_ns() {
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Format a duration with a unit suited to its magnitude
+ *
+ * @param buf Output buffer
+ * @param size Size of @p buf
+ * @param ns Duration in nanoseconds
+ * @return @p buf
+ */
+inline const char* format_duration(char* buf, size_t size, uint64_t ns) {
+  if (ns < 1000) {
+    snprintf(buf, size, "%u ns", (unsigned int) ns);
+  } else if (ns < 1000000) {
+    snprintf(buf, size, "%.2f us", ns / 1e3);
+  } else if (ns < 1000000000) {
+    snprintf(buf, size, "%.2f ms", ns / 1e6);
+  } else {
+    snprintf(buf, size, "%.3f s", ns / 1e9);
+  }
+  return buf;
+}
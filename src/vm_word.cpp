@@ -0,0 +1,46 @@
+#include "vm_word.h"
+
+#include <v4/internal/vm.h>  // For Word structure definition
+#include <v4/opcodes.hpp>
+
+extern "C" v4_err v4repl_exec_code(struct Vm* vm, const uint8_t* code, size_t len) {
+  // The entry only lives for the duration of vm_exec(); nothing in the
+  // dictionary refers to it, so there is no slot to reclaim afterwards.
+  Word entry = {};
+  entry.code = code;
+  entry.code_len = static_cast<int>(len);
+  return vm_exec(vm, &entry);
+}
+
+// 0 DUP / : a retired word fails with a division by zero instead of running
+static const uint8_t RETIRED_CODE[V4REPL_RETIRED_CODE_LEN] = {
+    static_cast<uint8_t>(v4::Op::LIT), 0, 0, 0, 0, static_cast<uint8_t>(v4::Op::DUP),
+    static_cast<uint8_t>(v4::Op::DIV), static_cast<uint8_t>(v4::Op::RET)};
+
+extern "C" const uint8_t* v4repl_retire_word(struct Vm* vm, int wid) {
+  Word* word = vm_get_word(vm, wid);
+  if (!word) {
+    return nullptr;
+  }
+  word->code = RETIRED_CODE;
+  word->code_len = V4REPL_RETIRED_CODE_LEN;
+  return RETIRED_CODE;
+}
+
+extern "C" const uint8_t* v4repl_word_code(struct Vm* vm, int wid, size_t* len) {
+  Word* word = vm_get_word(vm, wid);
+  if (!word) {
+    return nullptr;
+  }
+  if (len) {
+    *len = static_cast<size_t>(word->code_len);
+  }
+  return word->code;
+}
+
+extern "C" void v4repl_move_word(struct Vm* vm, int wid, const uint8_t* code) {
+  Word* word = vm_get_word(vm, wid);
+  if (word) {
+    word->code = code;
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "v4/vm_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file vm_word.h
+ * @brief Internal helpers that need the V4 `Word` layout
+ *
+ * The `Word` structure is only defined in the C++ internal VM header,
+ * so everything that touches its fields lives in vm_word.cpp and is
+ * exposed to the C library through this header.
+ */
+
+/**
+ * @brief Execute bytecode without registering it in the VM dictionary
+ *
+ * Runs @p code through vm_exec() using a temporary word entry, so
+ * top-level code of a REPL line does not consume a dictionary slot.
+ *
+ * @param vm   VM instance
+ * @param code Bytecode to execute (must end with RET)
+ * @param len  Bytecode length in bytes
+ * @return 0 on success, negative V4 error code on failure
+ */
+v4_err v4repl_exec_code(struct Vm* vm, const uint8_t* code, size_t len);
+
+/* Length of the stub returned by v4repl_retire_word() */
+#define V4REPL_RETIRED_CODE_LEN 8
+
+/**
+ * @brief Point a registered word at a shared stub that traps
+ *
+ * The VM cannot unregister a word, so before a word's own bytecode is
+ * freed its entry is redirected here. The REPL only retires words on
+ * request (.compact, .forget); anything still holding the word ID then
+ * (an execution token kept in memory) gets a division by zero error
+ * instead of running freed memory or silently doing nothing.
+ *
+ * @param vm  VM instance
+ * @param wid Word ID
+ * @return The stub (V4REPL_RETIRED_CODE_LEN bytes), or NULL if @p wid is not registered
+ */
+const uint8_t* v4repl_retire_word(struct Vm* vm, int wid);
+
+/**
+ * @brief Bytecode a registered word currently runs
+ *
+ * @param vm  VM instance
+ * @param wid Word ID
+ * @param len If non-NULL, receives the bytecode length
+ * @return The bytecode, or NULL if @p wid is not registered
+ */
+const uint8_t* v4repl_word_code(struct Vm* vm, int wid, size_t* len);
+
+/**
+ * @brief Point a registered word at a copy of its bytecode
+ *
+ * @param vm   VM instance
+ * @param wid  Word ID
+ * @param code Same bytecode (and length) at its new address
+ */
+void v4repl_move_word(struct Vm* vm, int wid, const uint8_t* code);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,320 @@
+#include "word_deps.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "disasm.hpp"
+
+/*
+ * Calls in a word's bytecode, in order. An opcode without known operands
+ * (or a truncated one) loses the instruction boundaries: from there on,
+ * every CALL opcode byte with room for a word ID counts as a call, which
+ * keeps too much alive rather than too little, and exact is cleared.
+ */
+struct CallScan {
+  const uint8_t* code;
+  uint32_t len;
+  uint32_t offset;
+  bool exact;
+
+  CallScan(const uint8_t* c, uint32_t n) : code(c), len(n), offset(0), exact(true) {}
+
+  bool next(int* callee) {
+    Disassembler::Insn insn;
+    while (exact && offset < len) {
+      if (!Disassembler::decode(code, len, offset, &insn) ||
+          (insn.info->flags & Disassembler::OPF_UNKNOWN)) {
+        exact = false;
+        break;
+      }
+      offset += insn.size;
+      if (insn.info->flags & Disassembler::OPF_CALL) {
+        *callee = insn.imm;
+        return true;
+      }
+    }
+    for (; offset < len; offset++) {
+      if ((Disassembler::op_info(code[offset])->flags & Disassembler::OPF_CALL) &&
+          Disassembler::decode(code, len, offset, &insn)) {
+        offset++;
+        *callee = insn.imm;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+WordDeps::WordDeps()
+    : entries_(nullptr), count_(0), capacity_(0), retired_(nullptr), retired_capacity_(0) {}
+
+WordDeps::~WordDeps() {
+  clear();
+  free(entries_);
+  free(retired_);
+}
+
+void WordDeps::clear() {
+  for (int i = 0; i < count_; i++) {
+    free(entries_[i].callers);
+  }
+  count_ = 0;
+}
+
+bool WordDeps::add(int wid, bool in_segment, const uint8_t* code, uint32_t len) {
+  if (wid < count_) {
+    return false;  // IDs only grow between resets
+  }
+  if (wid >= capacity_) {
+    int new_cap = capacity_ ? capacity_ : 64;
+    while (new_cap <= wid) {
+      new_cap *= 2;
+    }
+    Entry* grown = (Entry*) realloc(entries_, new_cap * sizeof(Entry));
+    if (!grown) {
+      return false;
+    }
+    entries_ = grown;
+    capacity_ = new_cap;
+  }
+
+  // Words registered without being tracked (if any) are never retired
+  for (int i = count_; i <= wid; i++) {
+    Entry* e = &entries_[i];
+    memset(e, 0, sizeof(*e));
+    e->bound = true;
+  }
+  count_ = wid + 1;
+
+  Entry* e = &entries_[wid];
+  e->code = code;
+  e->len = len;
+  e->in_segment = in_segment;
+
+  bool ok = true;
+  CallScan scan(code, len);
+  int callee;
+  while (scan.next(&callee)) {
+    if (!add_caller(callee, wid)) {
+      ok = false;
+    }
+  }
+  // Bytecode that cannot be fully decoded may call words not recorded above
+  if (!scan.exact) {
+    e->pinned = true;
+  }
+  return ok;
+}
+
+bool WordDeps::add_caller(int callee, int caller) {
+  if (callee < 0 || callee >= count_ || callee == caller) {
+    return true;
+  }
+  Entry* e = &entries_[callee];
+  if (e->caller_count > 0 && e->callers[e->caller_count - 1] == caller) {
+    return true;  // Called more than once by the same word
+  }
+  if (e->caller_count >= e->caller_capacity) {
+    int new_cap = e->caller_capacity ? e->caller_capacity * 2 : 4;
+    int* grown = (int*) realloc(e->callers, new_cap * sizeof(int));
+    if (!grown) {
+      e->pinned = true;  // Cannot tell when it becomes unused: never retire it
+      return false;
+    }
+    e->callers = grown;
+    e->caller_capacity = new_cap;
+  }
+  e->callers[e->caller_count++] = caller;
+  return true;
+}
+
+void WordDeps::remove_caller(int callee, int caller) {
+  if (callee < 0 || callee >= count_) {
+    return;
+  }
+  Entry* e = &entries_[callee];
+  for (int i = 0; i < e->caller_count; i++) {
+    if (e->callers[i] == caller) {
+      e->callers[i] = e->callers[--e->caller_count];
+      return;
+    }
+  }
+}
+
+void WordDeps::set_bound(int wid, bool bound) {
+  if (wid >= 0 && wid < count_) {
+    entries_[wid].bound = bound;
+  }
+}
+
+void WordDeps::set_code(int wid, const uint8_t* code) {
+  if (wid >= 0 && wid < count_) {
+    entries_[wid].code = code;
+  }
+}
+
+bool WordDeps::reachable(int wid) const {
+  // Retiring a word outside the code segment would free nothing
+  const Entry* e = &entries_[wid];
+  return e->bound || e->pinned || !e->in_segment || e->caller_count > 0;
+}
+
+int WordDeps::sweep(int wid) {
+  if (wid < 0 || wid >= count_ || entries_[wid].retired || reachable(wid)) {
+    return 0;
+  }
+  if (retired_capacity_ < count_) {
+    int* grown = (int*) realloc(retired_, count_ * sizeof(int));
+    if (!grown) {
+      return 0;  // Nothing retired; tried again on the next redefinition
+    }
+    retired_ = grown;
+    retired_capacity_ = count_;
+  }
+
+  // Breadth-first over the retired words' callees; each word is listed once
+  int n = 0;
+  entries_[wid].retired = true;
+  retired_[n++] = wid;
+  for (int i = 0; i < n; i++) {
+    const Entry* e = &entries_[retired_[i]];
+    CallScan scan(e->code, e->len);
+    int callee;
+    while (scan.next(&callee)) {
+      if (callee < 0 || callee >= count_) {
+        continue;
+      }
+      remove_caller(callee, retired_[i]);
+      if (!entries_[callee].retired && !reachable(callee)) {
+        entries_[callee].retired = true;
+        retired_[n++] = callee;
+      }
+    }
+  }
+  return n;
+}
+
+uint32_t WordDeps::unused_bytes() const {
+  uint8_t* unused = (uint8_t*) calloc(count_ ? count_ : 1, 1);
+  if (!unused) {
+    return 0;
+  }
+  // Same outcome as sweep(): a word goes once every caller has gone
+  uint32_t bytes = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int wid = 0; wid < count_; wid++) {
+      const Entry* e = &entries_[wid];
+      if (unused[wid] || e->retired || e->bound || e->pinned || !e->in_segment) {
+        continue;
+      }
+      bool called = false;
+      for (int i = 0; i < e->caller_count && !called; i++) {
+        called = !unused[e->callers[i]];
+      }
+      if (!called) {
+        unused[wid] = 1;
+        bytes += e->len;
+        changed = true;
+      }
+    }
+  }
+  free(unused);
+  return bytes;
+}
+
+void WordDeps::truncate(int count) {
+  if (count >= count_) {
+    return;
+  }
+  for (int i = count; i < count_; i++) {
+    free(entries_[i].callers);
+  }
+  count_ = count;
+
+  // Forgotten words no longer call anything
+  for (int i = 0; i < count_; i++) {
+    Entry* e = &entries_[i];
+    for (int j = 0; j < e->caller_count;) {
+      if (e->callers[j] >= count) {
+        e->callers[j] = e->callers[--e->caller_count];
+      } else {
+        j++;
+      }
+    }
+  }
+}
+
+bool WordDeps::placeable(int wid) const {
+  return wid >= 0 && wid < count_ && entries_[wid].in_segment && !entries_[wid].retired;
+}
+
+int WordDeps::layout_order(int* order) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  // Every word is pushed at most once per caller; count_ entries cover the
+  // common case and the stack grows for the rest
+  int stack_capacity = count_;
+  int* stack = (int*) malloc(stack_capacity * sizeof(int));
+  uint8_t* placed = (uint8_t*) calloc(count_, 1);
+  if (!stack || !placed) {
+    free(stack);
+    free(placed);
+    return -1;
+  }
+
+  // Roots first (words nothing live calls), then words only reachable
+  // through a cycle
+  int n = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int root = 0; root < count_; root++) {
+      if (placed[root] || !placeable(root) || (pass == 0 && entries_[root].caller_count > 0)) {
+        continue;
+      }
+
+      int depth = 0;
+      stack[depth++] = root;
+      while (depth > 0) {
+        int wid = stack[--depth];
+        if (placed[wid]) {
+          continue;
+        }
+        placed[wid] = 1;
+        order[n++] = wid;
+
+        // Push callees, then reverse them so the first call is placed next
+        const Entry* e = &entries_[wid];
+        int first = depth;
+        CallScan scan(e->code, e->len);
+        int callee;
+        while (scan.next(&callee)) {
+          if (!placeable(callee) || placed[callee]) {
+            continue;
+          }
+          if (depth >= stack_capacity) {
+            int* grown = (int*) realloc(stack, stack_capacity * 2 * sizeof(int));
+            if (!grown) {
+              free(stack);
+              free(placed);
+              return -1;
+            }
+            stack = grown;
+            stack_capacity *= 2;
+          }
+          stack[depth++] = callee;
+        }
+        for (int i = first, j = depth - 1; i < j; i++, j--) {
+          int t = stack[i];
+          stack[i] = stack[j];
+          stack[j] = t;
+        }
+      }
+    }
+  }
+
+  free(stack);
+  free(placed);
+  return n;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Word liveness and reverse dependencies, for reclaiming bytecode
+ *
+ * Entries are indexed by VM word ID. Each records where the word's
+ * bytecode is and which words call it (found by scanning the callers'
+ * bytecode for CALL). A word stays live while its name still refers to
+ * it (bound) or while a live word calls it. Once a redefinition leaves
+ * it unbound and uncalled, sweep() can retire it, together with any
+ * callees that only it kept alive, and its space in the code segment
+ * can be reused.
+ *
+ * Calls a word makes to itself do not keep it alive. Words whose
+ * bytecode is not in the code segment (loaded from an image) are never
+ * retired, nor are words with an opcode the disassembler has no operand
+ * facts for: past it, every CALL byte is taken as a call, so their
+ * callees stay alive too.
+ */
+class WordDeps {
+ public:
+  WordDeps();
+  ~WordDeps();
+
+  WordDeps(const WordDeps&) = delete;
+  WordDeps& operator=(const WordDeps&) = delete;
+
+  /**
+   * @brief Track a newly registered (bound) word
+   *
+   * Word IDs must be added in increasing order, as the VM assigns them.
+   *
+   * @param wid VM word ID
+   * @param in_segment Whether @p code lives in the code segment (movable and reclaimable)
+   * @param code Bytecode, scanned for calls to earlier words
+   * @param len Bytecode length
+   * @return false on allocation failure
+   */
+  bool add(int wid, bool in_segment, const uint8_t* code, uint32_t len);
+
+  /**
+   * @brief Mark whether @p wid is what its name currently refers to
+   */
+  void set_bound(int wid, bool bound);
+
+  /**
+   * @brief Record that the bytecode of @p wid moved to @p code
+   */
+  void set_code(int wid, const uint8_t* code);
+
+  /**
+   * @brief Retire @p wid if it is unreachable, then callees left unreachable
+   *
+   * The bytecode of every word still tracked must be intact, since
+   * retired words are scanned to find their callees.
+   *
+   * @return Number of words retired, listed by retired()
+   */
+  int sweep(int wid);
+
+  /**
+   * @brief Bytecode that sweeping every unbound word would retire
+   *
+   * A dry run of sweep(), for reporting: nothing is retired.
+   */
+  uint32_t unused_bytes() const;
+
+  /**
+   * @brief Word retired by the last sweep(), 0 <= @p i < its result
+   */
+  int retired(int i) const {
+    return retired_[i];
+  }
+
+  /**
+   * @brief Forget every word with an ID of @p count or above
+   *
+   * Their calls no longer keep earlier words alive; sweep() those
+   * afterwards to retire what became unreachable.
+   */
+  void truncate(int count);
+
+  /**
+   * @brief Live code segment words in call-graph order
+   *
+   * Depth first from the words nothing calls, each word followed by the
+   * callees it reaches first, so that a call chain ends up contiguous.
+   *
+   * @param order Receives the word IDs (room for size() entries)
+   * @return Number of IDs written, or -1 on allocation failure
+   */
+  int layout_order(int* order) const;
+
+  /**
+   * @brief Number of tracked word IDs (one past the highest)
+   */
+  int size() const {
+    return count_;
+  }
+
+  bool is_retired(int wid) const {
+    return wid >= 0 && wid < count_ && entries_[wid].retired;
+  }
+
+  /**
+   * @brief Forget everything (after a dictionary reset)
+   */
+  void clear();
+
+ private:
+  struct Entry {
+    const uint8_t* code;
+    uint32_t len;
+    bool in_segment;
+    bool bound;
+    bool retired;
+    bool pinned;   // Callers or callees may be missing: never retired
+    int* callers;  // Live words whose bytecode calls this one
+    int caller_count;
+    int caller_capacity;
+  };
+
+  Entry* entries_;
+  int count_;
+  int capacity_;
+
+  int* retired_;  // Results of the last sweep(), doubling as its work list
+  int retired_capacity_;
+
+  bool add_caller(int callee, int caller);
+  void remove_caller(int callee, int caller);
+  bool reachable(int wid) const;
+  bool placeable(int wid) const;
+};
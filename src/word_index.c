@@ -0,0 +1,270 @@
+#include "word_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_INITIAL_CAPACITY 16
+
+static int fold(int c) {
+  return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+static uint32_t name_hash(const char* name) {
+  uint32_t h = 2166136261u;
+  for (; *name; ++name) {
+    h ^= (uint8_t) fold((uint8_t) *name);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static int name_compare(const char* a, const char* b) {
+  for (;; ++a, ++b) {
+    int ca = fold((uint8_t) *a);
+    int cb = fold((uint8_t) *b);
+    if (ca != cb || ca == 0) {
+      return ca - cb;
+    }
+  }
+}
+
+/* Non-zero if name starts with prefix */
+static int has_prefix(const char* name, const char* prefix) {
+  for (; *prefix; ++name, ++prefix) {
+    if (fold((uint8_t) *name) != fold((uint8_t) *prefix)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Slot holding name, or the empty slot where it would go */
+static size_t find_slot(const V4ReplWordIndex* index, const char* name, uint32_t hash) {
+  size_t mask = index->slot_count - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    int32_t e = index->slots[i];
+    if (e == 0) {
+      return i;
+    }
+    const V4ReplWordEntry* entry = &index->entries[e - 1];
+    if (entry->hash == hash && name_compare(entry->name, name) == 0) {
+      return i;
+    }
+  }
+}
+
+/* Keep the table at most half full */
+static int grow_slots(V4ReplWordIndex* index) {
+  size_t new_count = index->slot_count ? index->slot_count * 2 : INDEX_INITIAL_CAPACITY * 2;
+  int32_t* new_slots = (int32_t*) calloc(new_count, sizeof(int32_t));
+  if (!new_slots) {
+    return -1;
+  }
+  free(index->slots);
+  index->slots = new_slots;
+  index->slot_count = new_count;
+
+  /* Entries are unique by name, so rehashing only needs empty slots */
+  size_t mask = new_count - 1;
+  for (int e = 0; e < index->count; ++e) {
+    size_t i = index->entries[e].hash & mask;
+    while (index->slots[i] != 0) {
+      i = (i + 1) & mask;
+    }
+    index->slots[i] = e + 1;
+  }
+  return 0;
+}
+
+static int map_wid(V4ReplWordIndex* index, int32_t wid, int entry) {
+  if (wid < 0) {
+    return 0;
+  }
+  if (wid >= index->wid_capacity) {
+    int new_cap = index->wid_capacity ? index->wid_capacity : INDEX_INITIAL_CAPACITY;
+    while (new_cap <= wid) {
+      new_cap *= 2;
+    }
+    int32_t* new_map = (int32_t*) realloc(index->by_wid, new_cap * sizeof(int32_t));
+    if (!new_map) {
+      return -1;
+    }
+    for (int i = index->wid_capacity; i < new_cap; ++i) {
+      new_map[i] = -1;
+    }
+    index->by_wid = new_map;
+    index->wid_capacity = new_cap;
+  }
+  index->by_wid[wid] = entry;
+  return 0;
+}
+
+int v4repl_index_add(V4ReplWordIndex* index, const char* name, int32_t wid) {
+  if ((size_t) (index->count + 1) * 2 > index->slot_count && grow_slots(index) != 0) {
+    return -1;
+  }
+
+  uint32_t hash = name_hash(name);
+  size_t slot = find_slot(index, name, hash);
+  if (index->slots[slot] != 0) {
+    /* Redefinition: the name now means the new word; the old ID keeps its name */
+    int e = index->slots[slot] - 1;
+    index->entries[e].wid = wid;
+    return map_wid(index, wid, e);
+  }
+
+  if (index->count >= index->capacity) {
+    int new_cap = index->capacity ? index->capacity * 2 : INDEX_INITIAL_CAPACITY;
+    V4ReplWordEntry* new_entries =
+        (V4ReplWordEntry*) realloc(index->entries, new_cap * sizeof(V4ReplWordEntry));
+    if (!new_entries) {
+      return -1;
+    }
+    index->entries = new_entries;
+    index->capacity = new_cap;
+  }
+
+  size_t len = strlen(name);
+  char* copy = (char*) malloc(len + 1);
+  if (!copy) {
+    return -1;
+  }
+  memcpy(copy, name, len + 1);
+
+  int e = index->count;
+  if (map_wid(index, wid, e) != 0) {
+    free(copy);
+    return -1;
+  }
+  index->entries[e].name = copy;
+  index->entries[e].hash = hash;
+  index->entries[e].wid = wid;
+  index->count++;
+  index->slots[slot] = e + 1;
+  index->sorted_count = 0; /* Sorted view is stale */
+  return 0;
+}
+
+int32_t v4repl_index_find(const V4ReplWordIndex* index, const char* name) {
+  if (index->count == 0) {
+    return -1;
+  }
+  int32_t e = index->slots[find_slot(index, name, name_hash(name))];
+  return e ? index->entries[e - 1].wid : -1;
+}
+
+const char* v4repl_index_name(const V4ReplWordIndex* index, int32_t wid) {
+  if (wid < 0 || wid >= index->wid_capacity || index->by_wid[wid] < 0) {
+    return NULL;
+  }
+  return index->entries[index->by_wid[wid]].name;
+}
+
+/*
+ * Bottom-up merge sort of entry indices by name. qsort() has no context
+ * argument and sessions in a pool sort concurrently, so no globals.
+ * scratch must hold n indices; the result ends up in order.
+ */
+static void sort_by_name(const V4ReplWordEntry* entries, int32_t* order, int32_t* scratch,
+                         int n) {
+  int32_t* src = order;
+  int32_t* dst = scratch;
+  for (int width = 1; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2 * width) {
+      int mid = lo + width < n ? lo + width : n;
+      int hi = lo + 2 * width < n ? lo + 2 * width : n;
+      int i = lo, j = mid, k = lo;
+      while (i < mid && j < hi) {
+        dst[k++] = name_compare(entries[src[j]].name, entries[src[i]].name) < 0 ? src[j++]
+                                                                                 : src[i++];
+      }
+      while (i < mid) {
+        dst[k++] = src[i++];
+      }
+      while (j < hi) {
+        dst[k++] = src[j++];
+      }
+    }
+    int32_t* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if (src != order) {
+    memcpy(order, src, (size_t) n * sizeof(int32_t));
+  }
+}
+
+static int ensure_sorted(V4ReplWordIndex* index) {
+  if (index->sorted_count == index->count) {
+    return 0;
+  }
+  /* Second half is merge scratch */
+  int32_t* sorted =
+      (int32_t*) realloc(index->sorted, (size_t) (index->capacity + 1) * 2 * sizeof(int32_t));
+  if (!sorted) {
+    return -1;
+  }
+  index->sorted = sorted;
+  for (int i = 0; i < index->count; ++i) {
+    sorted[i] = i;
+  }
+  sort_by_name(index->entries, sorted, sorted + index->capacity + 1, index->count);
+  index->sorted_count = index->count;
+  return 0;
+}
+
+int v4repl_index_prefix(V4ReplWordIndex* index, const char* prefix, int* first) {
+  *first = 0;
+  if (ensure_sorted(index) != 0) {
+    return -1;
+  }
+
+  /* Lower bound: first name not ordered before the prefix */
+  int lo = 0;
+  int hi = index->count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (name_compare(index->entries[index->sorted[mid]].name, prefix) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *first = lo;
+
+  int end = lo;
+  while (end < index->count && has_prefix(index->entries[index->sorted[end]].name, prefix)) {
+    end++;
+  }
+  return end - lo;
+}
+
+const char* v4repl_index_sorted_name(const V4ReplWordIndex* index, int pos) {
+  if (pos < 0 || pos >= index->sorted_count) {
+    return NULL;
+  }
+  return index->entries[index->sorted[pos]].name;
+}
+
+void v4repl_index_clear(V4ReplWordIndex* index) {
+  for (int i = 0; i < index->count; ++i) {
+    free(index->entries[i].name);
+  }
+  index->count = 0;
+  index->sorted_count = 0;
+  if (index->slots) {
+    memset(index->slots, 0, index->slot_count * sizeof(int32_t));
+  }
+  for (int i = 0; i < index->wid_capacity; ++i) {
+    index->by_wid[i] = -1;
+  }
+}
+
+void v4repl_index_free(V4ReplWordIndex* index) {
+  v4repl_index_clear(index);
+  free(index->entries);
+  free(index->slots);
+  free(index->by_wid);
+  free(index->sorted);
+  memset(index, 0, sizeof(*index));
+}
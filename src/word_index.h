@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+ * Word index
+ *
+ * Name -> word ID lookup through an open-addressing hash table (linear
+ * probing, power-of-two size, at most half full), word ID -> name
+ * through a dense array, and prefix queries through a name-sorted view
+ * that is rebuilt lazily after registrations. Names are matched without
+ * regard to ASCII case, like the V4 compiler.
+ *
+ * Shared by libv4repl (C) and the v4-repl executable (C++).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct V4ReplWordEntry {
+  char* name;    /* Owned copy, original spelling */
+  uint32_t hash; /* Case-folded name hash */
+  int32_t wid;   /* Latest word ID registered under this name */
+} V4ReplWordEntry;
+
+typedef struct V4ReplWordIndex {
+  V4ReplWordEntry* entries; /* One per distinct name, in first-definition order */
+  int count;
+  int capacity;
+
+  int32_t* slots; /* Hash table: entry index + 1, 0 = empty */
+  size_t slot_count;
+
+  int32_t* by_wid; /* Word ID -> entry index, -1 = unknown */
+  int wid_capacity;
+
+  int32_t* sorted; /* Entry indices ordered by name */
+  int sorted_count;
+} V4ReplWordIndex;
+
+/* Record a registration; redefinitions move the name to the new ID. Returns 0 or -1 on OOM */
+int v4repl_index_add(V4ReplWordIndex* index, const char* name, int32_t wid);
+
+/* Latest word ID for name, or -1 */
+int32_t v4repl_index_find(const V4ReplWordIndex* index, const char* name);
+
+/* Name a word ID was registered under, or NULL */
+const char* v4repl_index_name(const V4ReplWordIndex* index, int32_t wid);
+
+/*
+ * Names starting with prefix, in name order: sets *first to the position
+ * of the first match for v4repl_index_sorted_name() and returns the
+ * number of matches (or -1 on OOM).
+ */
+int v4repl_index_prefix(V4ReplWordIndex* index, const char* prefix, int* first);
+
+/* Name at a position of the sorted view (valid after v4repl_index_prefix()) */
+const char* v4repl_index_sorted_name(const V4ReplWordIndex* index, int pos);
+
+/* Forget all words but keep the allocations */
+void v4repl_index_clear(V4ReplWordIndex* index);
+
+/* Release everything */
+void v4repl_index_free(V4ReplWordIndex* index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -102,10 +102,11 @@ else
     exit 1
 fi
 
-# Test 8: Error message with position
+# Test 8: Error message with position (a failed line makes the exit status non-zero)
 echo "  Test 8: Error message with position..."
-OUTPUT=$(echo -e "NONEXISTENT\nbye" | $REPL 2>&1)
-if echo "$OUTPUT" | grep -q "unknown token at line 1, column 1"; then
+STATUS=0
+OUTPUT=$(echo -e "NONEXISTENT\nbye" | $REPL 2>&1) || STATUS=$?
+if echo "$OUTPUT" | grep -q "unknown token at line 1, column 1" && [ "$STATUS" -ne 0 ]; then
     echo "  ✅ Test 8 passed"
 else
     echo "  ❌ Test 8 failed"
@@ -113,4 +114,186 @@ else
     exit 1
 fi
 
+# Test 9: Batch mode from a script file
+echo "  Test 9: Batch mode (-f)..."
+SCRIPT=$(mktemp)
+printf ': SQUARE DUP * ;\n3 SQUARE\n4 SQUARE\n' > "$SCRIPT"
+OUTPUT=$($REPL -f "$SCRIPT" 2>&1)
+rm -f "$SCRIPT"
+if echo "$OUTPUT" | grep -qF "ok [2]: 9 16" && ! echo "$OUTPUT" | grep -qF "ok [1]: 9"; then
+    echo "  ✅ Test 9 passed"
+else
+    echo "  ❌ Test 9 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 10: Multi-session server (Linux, needs python3 as the client)
+if [ "$(uname -s)" = "Linux" ] && command -v python3 >/dev/null 2>&1; then
+    echo "  Test 10: Server mode (--serve)..."
+    SOCK=$(mktemp -u /tmp/v4repl-XXXXXX.sock)
+    $REPL --serve "$SOCK" 2>/dev/null &
+    SERVER_PID=$!
+    OUTPUT=$(python3 - "$SOCK" <<'PY'
+import socket, struct, sys, time
+path = sys.argv[1]
+for _ in range(50):
+    try:
+        a = socket.socket(socket.AF_UNIX); a.connect(path); break
+    except OSError:
+        time.sleep(0.1)
+b = socket.socket(socket.AF_UNIX); b.connect(path)
+def call(s, src):
+    data = src.encode()
+    s.sendall(struct.pack("<I", len(data)) + data)
+    n = struct.unpack("<I", s.recv(4, socket.MSG_WAITALL))[0]
+    body = s.recv(n, socket.MSG_WAITALL)
+    return body[0], body[1:].decode()
+call(a, ": SQUARE DUP * ;")
+print("A", call(a, "7 SQUARE")[1].strip())
+print("B", call(b, "7 SQUARE")[0])
+PY
+)
+    kill $SERVER_PID 2>/dev/null
+    wait $SERVER_PID 2>/dev/null
+    if echo "$OUTPUT" | grep -qF "A ok [1]: 49" && echo "$OUTPUT" | grep -qF "B 1"; then
+        echo "  ✅ Test 10 passed"
+    else
+        echo "  ❌ Test 10 failed"
+        echo "$OUTPUT"
+        exit 1
+    fi
+fi
+
+# Test 11: Session image round trip
+echo "  Test 11: Session image (.save / .load)..."
+IMAGE=$(mktemp)
+printf ': SQUARE DUP * ;\n7\n.save %s\n' "$IMAGE" | $REPL > /dev/null 2>&1
+OUTPUT=$(printf '.load %s\nSQUARE\n' "$IMAGE" | $REPL 2>&1)
+rm -f "$IMAGE"
+if echo "$OUTPUT" | grep -qF "Loaded 1 words" && echo "$OUTPUT" | grep -qF "ok [1]: 49"; then
+    echo "  ✅ Test 11 passed"
+else
+    echo "  ❌ Test 11 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 12: Precompiled bundle (--compile / --preload), stale bundles rejected
+echo "  Test 12: Bytecode bundle (--compile / --preload)..."
+LIBDIR=$(mktemp -d)
+printf ': SQUARE DUP * ;\n: CUBE DUP SQUARE * ;\n' > "$LIBDIR/lib.fs"
+$REPL --compile "$LIBDIR/lib.fs" > /dev/null 2>&1
+OUTPUT=$(echo "3 CUBE" | $REPL --preload "$LIBDIR/lib.v4b" 2>&1)
+printf ': SQUARE DUP DUP * * ;\n' > "$LIBDIR/lib.fs"
+STALE=$(echo "3 CUBE" | $REPL --preload "$LIBDIR/lib.v4b" 2>&1 || true)
+rm -rf "$LIBDIR"
+if echo "$OUTPUT" | grep -qF "ok [1]: 27" && echo "$STALE" | grep -qF "stale"; then
+    echo "  ✅ Test 12 passed"
+else
+    echo "  ❌ Test 12 failed"
+    echo "$OUTPUT"
+    echo "$STALE"
+    exit 1
+fi
+
+# Test 13: Prefix filter backed by the word index
+echo "  Test 13: Word index (.words <prefix>)..."
+OUTPUT=$(printf ': SQUARE DUP * ;\n: SQRT-EST 2 / ;\n: CUBE DUP SQUARE * ;\n.words sq\n' | $REPL 2>&1)
+if echo "$OUTPUT" | grep -qF "Words starting with 'sq' (2)" && ! echo "$OUTPUT" | grep -qF "  CUBE"; then
+    echo "  ✅ Test 13 passed"
+else
+    echo "  ❌ Test 13 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 14: Memory watch reports changed words after each line
+echo "  Test 14: Memory watch (.watch / .diff)..."
+OUTPUT=$(printf '.watch 256 8\n42 256 !\n.diff\n' | $REPL 2>&1)
+if echo "$OUTPUT" | grep -qF "Watched memory changed" && \
+   echo "$OUTPUT" | grep -qF "0x00000100: 0x00000000 -> 0x0000002A"; then
+    echo "  ✅ Test 14 passed"
+else
+    echo "  ❌ Test 14 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 15: PASTE mode compiles each definition as it completes
+echo "  Test 15: Incremental PASTE mode..."
+OUTPUT=$(printf '<<<\n: SQ\n  DUP * ;\n: BAD NO-SUCH-WORD ;\n5 SQ\n>>>\n' | $REPL 2>&1 || true)
+if echo "$OUTPUT" | grep -qF "in PASTE line 3" && echo "$OUTPUT" | grep -qF "ok [1]: 25"; then
+    echo "  ✅ Test 15 passed"
+else
+    echo "  ❌ Test 15 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 16: .include with nested files and file:line errors
+echo "  Test 16: Source include (.include)..."
+INCDIR=$(mktemp -d)
+printf ': SQUARE DUP * ;\n.include more.fs\n: BROKEN NO-SUCH-WORD ;\n' > "$INCDIR/main.fs"
+printf '.include main.fs\n: CUBE DUP SQUARE * ;\n' > "$INCDIR/more.fs"
+OUTPUT=$(printf '.include %s/main.fs\n3 CUBE\n' "$INCDIR" | $REPL 2>&1)
+rm -rf "$INCDIR"
+if echo "$OUTPUT" | grep -qF "main.fs:3:" && echo "$OUTPUT" | grep -qF "ok [1]: 27"; then
+    echo "  ✅ Test 16 passed"
+else
+    echo "  ❌ Test 16 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 17: --lazy compiles a definition only when a line uses it (binding names as entered)
+echo "  Test 17: Lazy definitions (--lazy)..."
+OUTPUT=$(printf ': SQ DUP * ;\n: UNUSED 1 ;\n5 SQ\n: BASE 1 ;\n: PLUS10 BASE 10 + ;\n: BASE 2 ;\nPLUS10 BASE\n.words\n' | $REPL --lazy 2>&1)
+if echo "$OUTPUT" | grep -qF "UNUSED (not compiled)" && echo "$OUTPUT" | grep -qF "ok [3]: 25 11 2" && \
+   ! echo "$OUTPUT" | grep -qF "SQ (not compiled)"; then
+    echo "  ✅ Test 17 passed"
+else
+    echo "  ❌ Test 17 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 18: Superseded bytecode is reclaimed; .forget drops later words
+echo "  Test 18: Redefinition reclamation (.forget)..."
+OUTPUT=$(printf ': SQ DUP * ;\n: CUBE DUP SQ * ;\n: SQ DUP DUP * * ;\n: CUBE 1 ;\n.memory\n: D 4 ;\n.forget CUBE\n3 SQ\n' | $REPL 2>&1)
+if echo "$OUTPUT" | grep -qF "reclaimable by .compact" && \
+   echo "$OUTPUT" | grep -qF "Forgot 2 definitions from CUBE on." && \
+   echo "$OUTPUT" | grep -qF "ok [1]: 27"; then
+    echo "  ✅ Test 18 passed"
+else
+    echo "  ❌ Test 18 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 19: .compact re-packs the code segment without the retired words
+echo "  Test 19: Code segment compaction (.compact)..."
+OUTPUT=$(printf ': SQ DUP * ;\n: CUBE DUP SQ * ;\n: SQ DUP DUP * * ;\n: CUBE DUP SQ * ;\n.compact\n.memory\n2 CUBE\n' | $REPL 2>&1)
+if echo "$OUTPUT" | grep -qF "Code segment: " && \
+   echo "$OUTPUT" | grep -qF " 0 reclaimable by .compact" && \
+   echo "$OUTPUT" | grep -qF "ok [1]: 16"; then
+    echo "  ✅ Test 19 passed"
+else
+    echo "  ❌ Test 19 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
+# Test 20: .forget in lazy mode also drops definitions recorded after the word
+echo "  Test 20: Lazy definitions and .forget..."
+OUTPUT=$(printf ': A 1 ;\n: B 2 ;\nA\n: C 3 ;\n.forget B\n.words\nA\n' | $REPL --lazy 2>&1)
+if echo "$OUTPUT" | grep -qF "Forgot 2 definitions from B on." && \
+   echo "$OUTPUT" | grep -qF "Defined words (1):" && echo "$OUTPUT" | grep -qF "ok [2]: 1 1"; then
+    echo "  ✅ Test 20 passed"
+else
+    echo "  ❌ Test 20 failed"
+    echo "$OUTPUT"
+    exit 1
+fi
+
 echo "✅ All smoke tests passed!"
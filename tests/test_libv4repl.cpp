@@ -16,7 +16,18 @@ extern "C" {
 #include "v4front/compile.h"
 }
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
+
+#if V4REPL_WITH_POOL
+#include <atomic>
+#include <thread>
+
+#include "v4repl/pool.h"
+#endif
 
 /**
  * Test fixture for libv4repl tests
@@ -54,13 +65,20 @@ protected:
 
         // Create REPL context
         V4ReplConfig repl_config;
+        memset(&repl_config, 0, sizeof(repl_config));
         repl_config.vm = vm;
         repl_config.front_ctx = compiler_ctx;
         repl_config.line_buffer_size = 512;
+        configure(repl_config);
         repl = v4_repl_create(&repl_config);
         REQUIRE(repl != nullptr);
     }
 
+    // Hook for fixtures that enable optional REPL features
+    virtual void configure(V4ReplConfig& config) {
+        (void) config;
+    }
+
     void teardown() {
         if (repl) {
             v4_repl_destroy(repl);
@@ -76,7 +94,7 @@ protected:
         }
     }
 
-    ~V4ReplFixture() {
+    virtual ~V4ReplFixture() {
         teardown();
     }
 };
@@ -475,3 +493,927 @@ TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Task system support (V4 v0.9.1, V4-
         CHECK(result == -1);  // TRUE (-1)
     }
 }
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Top-level code does not consume dictionary slots") {
+    setup();
+
+    // Every line used to leave an anonymous word behind; run far more lines
+    // than the VM dictionary can hold
+    for (int i = 0; i < 5000; ++i) {
+        v4_err err = v4_repl_process_line(repl, "1 2 + DROP");
+        REQUIRE(err == 0);
+    }
+
+    // Definitions still work after the long run
+    v4_err err = v4_repl_process_line(repl, ": SQUARE DUP * ;");
+    CHECK(err == 0);
+    err = v4_repl_process_line(repl, "7 SQUARE");
+    CHECK(err == 0);
+
+    v4_i32 result;
+    vm_ds_pop(vm, &result);
+    CHECK(result == 49);
+}
+
+class V4ReplCacheFixture : public V4ReplFixture {
+protected:
+    void configure(V4ReplConfig& config) override {
+        config.bytecode_cache_size = 4;
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplCacheFixture, "libv4repl: Bytecode cache") {
+    setup();
+
+    SUBCASE("Repeated lines hit the cache") {
+        for (int i = 0; i < 10; ++i) {
+            CHECK(v4_repl_process_line(repl, "2 3 +") == 0);
+        }
+        CHECK(v4_repl_stack_depth(repl) == 10);
+
+        V4ReplCacheStats stats;
+        v4_repl_get_cache_stats(repl, &stats);
+        CHECK(stats.misses == 1);
+        CHECK(stats.hits == 9);
+        CHECK(stats.entries == 1);
+        CHECK(stats.capacity == 4);
+    }
+
+    SUBCASE("Redefinition invalidates cached lines") {
+        CHECK(v4_repl_process_line(repl, ": VAL 1 ;") == 0);
+        CHECK(v4_repl_process_line(repl, "VAL") == 0);
+        CHECK(v4_repl_process_line(repl, ": VAL 2 ;") == 0);
+        CHECK(v4_repl_process_line(repl, "VAL") == 0);
+
+        v4_i32 second, first;
+        vm_ds_pop(vm, &second);
+        vm_ds_pop(vm, &first);
+        CHECK(first == 1);
+        CHECK(second == 2);
+    }
+
+    SUBCASE("Least recently used entry is evicted") {
+        const char* lines[] = {"1 DROP", "2 DROP", "3 DROP", "4 DROP", "5 DROP"};
+        for (const char* line : lines) {
+            CHECK(v4_repl_process_line(repl, line) == 0);
+        }
+        CHECK(v4_repl_process_line(repl, "1 DROP") == 0);  // Evicted: miss
+
+        V4ReplCacheStats stats;
+        v4_repl_get_cache_stats(repl, &stats);
+        CHECK(stats.misses == 6);
+        CHECK(stats.hits == 0);
+        CHECK(stats.entries == 4);
+    }
+
+    SUBCASE("Clearing waits for a submitted line that hit the cache") {
+        CHECK(v4_repl_process_line(repl, "2 3 +") == 0);
+        CHECK(v4_repl_submit_line(repl, "2 3 +", nullptr, nullptr) == 0);
+        CHECK(v4_repl_poll(repl, 0) == 1);  // Cache hit, execution still to come
+        CHECK(v4_repl_clear_cache(repl) == V4_REPL_ERR_BUSY);
+
+        V4ReplCacheStats stats;
+        v4_repl_get_cache_stats(repl, &stats);
+        CHECK(stats.hits == 1);
+        CHECK(stats.entries == 1);
+
+        while (v4_repl_poll(repl, 0)) {
+        }
+        CHECK(v4_repl_stack_depth(repl) == 2);
+        CHECK(vm_ds_peek_public(vm, 0) == 5);
+
+        CHECK(v4_repl_clear_cache(repl) == 0);
+        v4_repl_get_cache_stats(repl, &stats);
+        CHECK(stats.entries == 0);
+    }
+
+    SUBCASE("Dictionary reset empties the cache") {
+        CHECK(v4_repl_process_line(repl, "1 DROP") == 0);
+        v4_repl_reset_dictionary(repl);
+
+        V4ReplCacheStats stats;
+        v4_repl_get_cache_stats(repl, &stats);
+        CHECK(stats.entries == 0);
+    }
+}
+
+class V4ReplCodeArenaFixture : public V4ReplFixture {
+protected:
+    uint8_t code_arena[64];
+
+    void configure(V4ReplConfig& config) override {
+        config.code_arena = code_arena;
+        config.code_arena_size = sizeof(code_arena);
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplCodeArenaFixture, "libv4repl: Definitions in a code arena") {
+    setup();
+
+    SUBCASE("Definitions are copied into the arena") {
+        CHECK(v4_repl_code_arena_used(repl) == 0);
+        CHECK(v4_repl_process_line(repl, ": SQUARE DUP * ;") == 0);
+        CHECK(v4_repl_code_arena_used(repl) > 0);
+        CHECK(v4_repl_code_arena_used(repl) % 4 == 0);
+
+        // Top-level code does not consume arena space
+        size_t used = v4_repl_code_arena_used(repl);
+        CHECK(v4_repl_process_line(repl, "6 SQUARE") == 0);
+        CHECK(v4_repl_code_arena_used(repl) == used);
+
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 36);
+    }
+
+    SUBCASE("Exhausted arena rejects the definition") {
+        v4_err err = 0;
+        for (int i = 0; i < 64 && err == 0; ++i) {
+            err = v4_repl_process_line(repl, ": FILLER 1 2 3 4 5 6 7 8 + + + + + + + ;");
+        }
+        CHECK(err != 0);
+        CHECK(v4_repl_get_error(repl) != nullptr);
+        CHECK(v4_repl_code_arena_used(repl) <= sizeof(code_arena));
+    }
+
+    SUBCASE("Dictionary reset rewinds the arena") {
+        CHECK(v4_repl_process_line(repl, ": DOUBLE 2 * ;") == 0);
+        v4_repl_reset_dictionary(repl);
+        CHECK(v4_repl_code_arena_used(repl) == 0);
+
+        CHECK(v4_repl_process_line(repl, ": TRIPLE 3 * ;") == 0);
+        CHECK(v4_repl_process_line(repl, "5 TRIPLE") == 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 15);
+    }
+}
+
+struct CapturedOutput {
+    char text[256];
+    size_t len;
+    int calls;
+};
+
+static void capture_write(void* user, const char* data, size_t len) {
+    CapturedOutput* out = static_cast<CapturedOutput*>(user);
+    if (out->len + len < sizeof(out->text)) {
+        memcpy(out->text + out->len, data, len);
+        out->len += len;
+        out->text[out->len] = '\0';
+    }
+    out->calls++;
+}
+
+class V4ReplOutputFixture : public V4ReplFixture {
+protected:
+    CapturedOutput captured;
+    char out_buf[64];
+
+    void configure(V4ReplConfig& config) override {
+        memset(&captured, 0, sizeof(captured));
+        config.write = capture_write;
+        config.write_user = &captured;
+        config.out_buf = out_buf;
+        config.out_buf_size = sizeof(out_buf);
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplOutputFixture, "libv4repl: Output sink") {
+    setup();
+
+    SUBCASE("Empty stack") {
+        v4_repl_print_stack(repl);
+        CHECK(strcmp(captured.text, " ok\n") == 0);
+        CHECK(captured.calls == 1);
+    }
+
+    SUBCASE("Stack line is written in one call") {
+        CHECK(v4_repl_process_line(repl, "1 0 -2147483647 1 - 300") == 0);
+        v4_repl_print_stack(repl);
+        CHECK(strcmp(captured.text, " ok [4]: 1 0 -2147483648 300\n") == 0);
+        CHECK(captured.calls == 1);
+    }
+
+    SUBCASE("Long lines are flushed when the buffer fills") {
+        for (int i = 0; i < 20; ++i) {
+            CHECK(v4_repl_process_line(repl, "1000000") == 0);
+        }
+        v4_repl_print_stack(repl);
+        CHECK(captured.len == strlen(" ok [20]:") + 20 * strlen(" 1000000") + 1);
+        CHECK(captured.calls > 1);
+    }
+
+    SUBCASE("Errors go through the sink") {
+        CHECK(v4_repl_process_line(repl, "NO_SUCH_WORD") != 0);
+        v4_repl_print_error(repl);
+        CHECK(strncmp(captured.text, "Error: ", 7) == 0);
+        CHECK(captured.text[captured.len - 1] == '\n');
+    }
+}
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Interrupt request") {
+    setup();
+
+    SUBCASE("Pending interrupt abandons the next line and clears the stack") {
+        CHECK(v4_repl_process_line(repl, "1 2") == 0);
+        v4_repl_interrupt(repl);
+        CHECK(v4_repl_process_line(repl, "3") == V4_REPL_ERR_INTERRUPTED);
+        CHECK(v4_repl_stack_depth(repl) == 0);
+        CHECK(v4_repl_get_error(repl) != nullptr);
+    }
+
+    SUBCASE("Interrupt is consumed once") {
+        v4_repl_interrupt(repl);
+        CHECK(v4_repl_process_line(repl, "1") == V4_REPL_ERR_INTERRUPTED);
+        CHECK(v4_repl_process_line(repl, "1") == 0);
+        CHECK(v4_repl_stack_depth(repl) == 1);
+    }
+}
+
+struct DoneRecord {
+    int calls = 0;
+    v4_err err = 0;
+    bool has_error = false;
+};
+
+static void record_done(void* user, v4_err err, const char* error) {
+    DoneRecord* r = static_cast<DoneRecord*>(user);
+    r->calls++;
+    r->err = err;
+    r->has_error = error != nullptr;
+}
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Non-blocking evaluation") {
+    setup();
+    DoneRecord done;
+
+    SUBCASE("Line advances one step per zero-budget poll") {
+        CHECK(v4_repl_submit_line(repl, ": SQ DUP * ; : CUBE DUP SQ * ; 3 CUBE", record_done,
+                                  &done) == 0);
+        CHECK(v4_repl_busy(repl) == 1);
+        CHECK(v4_repl_stack_depth(repl) == 0);  // Nothing runs before the first poll
+
+        // compile, register SQ, register CUBE, execute
+        int polls = 1;
+        while (v4_repl_poll(repl, 0)) {
+            CHECK(done.calls == 0);
+            polls++;
+        }
+        CHECK(polls == 4);
+        CHECK(done.calls == 1);
+        CHECK(done.err == 0);
+        CHECK_FALSE(done.has_error);
+        CHECK(v4_repl_busy(repl) == 0);
+
+        v4_i32 val;
+        vm_ds_pop(vm, &val);
+        CHECK(val == 27);
+    }
+
+    SUBCASE("Large budget finishes in one poll") {
+        CHECK(v4_repl_submit_line(repl, "2 3 +", record_done, &done) == 0);
+        CHECK(v4_repl_poll(repl, 1000000) == 0);
+        CHECK(done.calls == 1);
+        CHECK(v4_repl_stack_depth(repl) == 1);
+    }
+
+    SUBCASE("Errors are delivered to the callback") {
+        CHECK(v4_repl_submit_line(repl, "UNDEFINED-WORD", record_done, &done) == 0);
+        CHECK(v4_repl_poll(repl, 0) == 0);
+        CHECK(done.calls == 1);
+        CHECK(done.err != 0);
+        CHECK(done.has_error);
+    }
+
+    SUBCASE("Only one line at a time") {
+        CHECK(v4_repl_submit_line(repl, "1", nullptr, nullptr) == 0);
+        CHECK(v4_repl_submit_line(repl, "2", nullptr, nullptr) == V4_REPL_ERR_BUSY);
+        CHECK(v4_repl_process_line(repl, "2") == V4_REPL_ERR_BUSY);
+        while (v4_repl_poll(repl, 0)) {
+        }
+        CHECK(v4_repl_process_line(repl, "2") == 0);
+        CHECK(v4_repl_stack_depth(repl) == 2);
+    }
+
+    SUBCASE("Submitted line is copied") {
+        char line[16];
+        strcpy(line, "7");
+        CHECK(v4_repl_submit_line(repl, line, nullptr, nullptr) == 0);
+        strcpy(line, "UNDEFINED");
+        while (v4_repl_poll(repl, 0)) {
+        }
+        CHECK(v4_repl_stack_depth(repl) == 1);
+    }
+
+    SUBCASE("Reset drops a pending line") {
+        CHECK(v4_repl_submit_line(repl, ": SQ DUP * ; 4 SQ", record_done, &done) == 0);
+        CHECK(v4_repl_poll(repl, 0) == 1);
+        v4_repl_reset(repl);
+        CHECK(v4_repl_busy(repl) == 0);
+        CHECK(v4_repl_poll(repl, 0) == 0);
+        CHECK(done.calls == 0);
+    }
+}
+
+class V4ReplSnapshotFixture : public V4ReplFixture {
+protected:
+    void configure(V4ReplConfig& config) override {
+        config.vm_mem = vm_memory;
+        config.vm_mem_size = VM_MEMORY_SIZE;
+    }
+
+    std::vector<uint8_t> snapshot() {
+        size_t len = 0;
+        REQUIRE(v4_repl_snapshot(repl, nullptr, 0, &len) == 0);
+        std::vector<uint8_t> image(len);
+        REQUIRE(v4_repl_snapshot(repl, image.data(), image.size(), &len) == 0);
+        REQUIRE(len == image.size());
+        return image;
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplSnapshotFixture, "libv4repl: Session snapshot and restore") {
+    setup();
+
+    // CUBE calls the first SQ by word ID; the redefinition must not change that
+    REQUIRE(v4_repl_process_line(repl, ": SQ DUP * ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": CUBE DUP SQ * ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": SQ 1 + ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, "5 6") == 0);
+    vm_memory[64] = 0xAB;
+
+    std::vector<uint8_t> image = snapshot();
+
+    auto wipe = [&]() {
+        v4_repl_reset(repl);
+        v4_repl_reset_dictionary(repl);
+        vm_memory[64] = 0;
+        REQUIRE(v4_repl_stack_depth(repl) == 0);
+    };
+
+    auto check_session = [&]() {
+        CHECK(vm_memory[64] == 0xAB);
+        v4_i32 val;
+        REQUIRE(v4_repl_stack_depth(repl) == 2);
+        vm_ds_pop(vm, &val);
+        CHECK(val == 6);
+        vm_ds_pop(vm, &val);
+        CHECK(val == 5);
+
+        CHECK(v4_repl_process_line(repl, "2 CUBE") == 0);
+        vm_ds_pop(vm, &val);
+        CHECK(val == 8);
+        CHECK(v4_repl_process_line(repl, "2 SQ") == 0);
+        vm_ds_pop(vm, &val);
+        CHECK(val == 3);
+    };
+
+    SUBCASE("Restore copies bytecode") {
+        wipe();
+        REQUIRE(v4_repl_restore(repl, image.data(), image.size(), 0) == 0);
+        std::fill(image.begin(), image.end(), 0);  // Image no longer needed
+        check_session();
+    }
+
+    SUBCASE("Restore in place") {
+        wipe();
+        REQUIRE(v4_repl_restore(repl, image.data(), image.size(), V4_REPL_RESTORE_IN_PLACE) == 0);
+        check_session();
+    }
+
+    SUBCASE("Restored session can be snapshotted again") {
+        wipe();
+        REQUIRE(v4_repl_restore(repl, image.data(), image.size(), 0) == 0);
+        CHECK(snapshot() == image);
+    }
+
+    SUBCASE("Corrupt or truncated images are rejected") {
+        std::vector<uint8_t> corrupt = image;
+        corrupt[corrupt.size() / 2] ^= 0xFF;
+        CHECK(v4_repl_restore(repl, corrupt.data(), corrupt.size(), 0) == V4_REPL_ERR_IMAGE);
+        CHECK(v4_repl_get_error(repl) != nullptr);
+
+        CHECK(v4_repl_restore(repl, image.data(), image.size() - 1, 0) == V4_REPL_ERR_IMAGE);
+        CHECK(v4_repl_restore(repl, image.data(), 8, 0) == V4_REPL_ERR_IMAGE);
+    }
+
+    SUBCASE("Snapshot reports the size it needs") {
+        uint8_t small[8];
+        size_t len = 0;
+        CHECK(v4_repl_snapshot(repl, small, sizeof(small), &len) == -1);
+        CHECK(len == image.size());
+    }
+}
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Preloaded bundle") {
+    setup();
+
+    REQUIRE(v4_repl_process_line(repl, ": SQ DUP * ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": CUBE DUP SQ * ;") == 0);
+    size_t len = 0;
+    REQUIRE(v4_repl_snapshot(repl, nullptr, 0, &len) == 0);
+    std::vector<uint8_t> bundle(len);
+    REQUIRE(v4_repl_snapshot(repl, bundle.data(), bundle.size(), &len) == 0);
+
+    // A second session boots from the bundle without compiling anything
+    static uint8_t boot_memory[VM_MEMORY_SIZE];
+    VmConfig vm_config;
+    memset(&vm_config, 0, sizeof(vm_config));
+    vm_config.mem = boot_memory;
+    vm_config.mem_size = VM_MEMORY_SIZE;
+    struct Vm* boot_vm = vm_create(&vm_config);
+    REQUIRE(boot_vm != nullptr);
+    V4FrontContext* boot_front = v4front_context_create();
+    REQUIRE(boot_front != nullptr);
+
+    V4ReplConfig config;
+    memset(&config, 0, sizeof(config));
+    config.vm = boot_vm;
+    config.front_ctx = boot_front;
+
+    SUBCASE("Words are available immediately") {
+        config.preload = bundle.data();
+        config.preload_size = bundle.size();
+        V4ReplContext* boot = v4_repl_create(&config);
+        REQUIRE(boot != nullptr);
+        CHECK(v4_repl_process_line(boot, "3 CUBE") == 0);
+        v4_i32 val;
+        vm_ds_pop(boot_vm, &val);
+        CHECK(val == 27);
+        v4_repl_destroy(boot);
+    }
+
+    SUBCASE("Invalid bundle fails creation") {
+        bundle[bundle.size() - 1] ^= 0xFF;
+        config.preload = bundle.data();
+        config.preload_size = bundle.size();
+        CHECK(v4_repl_create(&config) == nullptr);
+    }
+
+    v4front_context_destroy(boot_front);
+    vm_destroy(boot_vm);
+}
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Word lookup index") {
+    setup();
+
+    REQUIRE(v4_repl_process_line(repl, ": SQUARE DUP * ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": SQRT-EST 2 / ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": CUBE DUP SQUARE * ;") == 0);
+
+    SUBCASE("Names map to word IDs and back") {
+        int sq = v4_repl_find_word(repl, "SQUARE");
+        REQUIRE(sq >= 0);
+        CHECK(v4_repl_find_word(repl, "square") == sq);
+        CHECK(v4_repl_word_name(repl, sq) == std::string("SQUARE"));
+        CHECK(v4_repl_find_word(repl, "SQUAREX") == -1);
+        CHECK(v4_repl_find_word(repl, "DUP") == -1);  // Primitives are not indexed
+        CHECK(v4_repl_word_name(repl, 9999) == nullptr);
+    }
+
+    SUBCASE("Redefinition moves the name to the new ID") {
+        int old_wid = v4_repl_find_word(repl, "SQUARE");
+        REQUIRE(v4_repl_process_line(repl, ": SQUARE 1 + ;") == 0);
+        int new_wid = v4_repl_find_word(repl, "SQUARE");
+        CHECK(new_wid != old_wid);
+        CHECK(v4_repl_word_name(repl, old_wid) == std::string("SQUARE"));
+        CHECK(v4_repl_complete(repl, "SQUARE", nullptr, 0) == 1);
+    }
+
+    SUBCASE("Prefix completion is sorted and case-insensitive") {
+        const char* names[4];
+        REQUIRE(v4_repl_complete(repl, "sq", names, 4) == 2);
+        CHECK(names[0] == std::string("SQRT-EST"));
+        CHECK(names[1] == std::string("SQUARE"));
+        CHECK(v4_repl_complete(repl, "", nullptr, 0) == 3);
+        CHECK(v4_repl_complete(repl, "X", names, 4) == 0);
+
+        // Only max_names are written, but the total is returned
+        CHECK(v4_repl_complete(repl, "", names, 1) == 3);
+        CHECK(names[0] == std::string("CUBE"));
+    }
+
+    SUBCASE("Many words") {
+        char line[64];
+        for (int i = 0; i < 500; i++) {
+            snprintf(line, sizeof(line), ": W%d %d ;", i, i);
+            REQUIRE(v4_repl_process_line(repl, line) == 0);
+        }
+        for (int i = 0; i < 500; i += 37) {
+            snprintf(line, sizeof(line), "w%d", i);
+            int wid = v4_repl_find_word(repl, line);
+            REQUIRE(wid >= 0);
+            snprintf(line, sizeof(line), "W%d", i);
+            CHECK(v4_repl_word_name(repl, wid) == std::string(line));
+        }
+        CHECK(v4_repl_complete(repl, "W4", nullptr, 0) == 111);  // W4, W40-49, W400-499
+    }
+
+    SUBCASE("Reset clears the index") {
+        v4_repl_reset_dictionary(repl);
+        CHECK(v4_repl_find_word(repl, "SQUARE") == -1);
+        CHECK(v4_repl_complete(repl, "", nullptr, 0) == 0);
+    }
+
+    SUBCASE("Restore rebuilds the index") {
+        size_t len = 0;
+        REQUIRE(v4_repl_snapshot(repl, nullptr, 0, &len) == 0);
+        std::vector<uint8_t> image(len);
+        REQUIRE(v4_repl_snapshot(repl, image.data(), image.size(), &len) == 0);
+        int cube = v4_repl_find_word(repl, "CUBE");
+
+        v4_repl_reset_dictionary(repl);
+        REQUIRE(v4_repl_restore(repl, image.data(), image.size(), 0) == 0);
+        CHECK(v4_repl_find_word(repl, "CUBE") == cube);
+        CHECK(v4_repl_complete(repl, "", nullptr, 0) == 3);
+    }
+}
+
+TEST_CASE_FIXTURE(V4ReplFixture, "libv4repl: Batch source load") {
+    setup();
+
+    // QUAD and SQ+1 wait for the words they use; TRIPLE must see the
+    // second DOUBLE and QUAD must keep the first
+    const char* source =
+        ": SQUARE DUP * ;\n"
+        ": DOUBLE 2 * ;\n"
+        ": QUAD DOUBLE DOUBLE ;\n"
+        ": SQ+1 SQUARE 1 + ;\n"
+        "3 SQ+1\n"
+        ": DOUBLE 3 * ;  ( redefined )\n"
+        ": TRIPLE DOUBLE ;\n"
+        "5 QUAD 5 TRIPLE\n";
+
+    SUBCASE("Results match line-by-line evaluation") {
+        for (int threads : {1, 4}) {
+            CAPTURE(threads);
+            v4_repl_reset_dictionary(repl);
+            vm_ds_clear(vm);
+
+            REQUIRE(v4_repl_load_source(repl, source, threads) == 0);
+            REQUIRE(v4_repl_stack_depth(repl) == 3);
+            v4_i32 result;
+            vm_ds_pop(vm, &result);
+            CHECK(result == 15);
+            vm_ds_pop(vm, &result);
+            CHECK(result == 20);
+            vm_ds_pop(vm, &result);
+            CHECK(result == 10);
+            CHECK(v4_repl_complete(repl, "", nullptr, 0) == 5);
+        }
+    }
+
+    SUBCASE("Earlier uses keep the meaning a name had before its redefinition") {
+        REQUIRE(v4_repl_process_line(repl, ": BASE 1 ;") == 0);
+        REQUIRE(v4_repl_load_source(repl, ": OLD BASE ;\n: BASE 2 ;\n: NEW BASE ;\nOLD NEW\n",
+                                    4) == 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 2);
+        vm_ds_pop(vm, &result);
+        CHECK(result == 1);
+    }
+
+    SUBCASE("A redefinition waits for later users of the name defined earlier") {
+        // U compiles in a late wave; the second X must not be registered before it
+        const char* shape =
+            ": X 1 ;\n"
+            ": Y0 0 ;\n"
+            ": Y1 Y0 ;\n"
+            ": Y2 Y1 ;\n"
+            ": U X Y2 ;\n"
+            ": X 2 ;\n"
+            "U X\n";
+        for (int threads : {1, 4}) {
+            CAPTURE(threads);
+            v4_repl_reset_dictionary(repl);
+            vm_ds_clear(vm);
+
+            REQUIRE(v4_repl_load_source(repl, shape, threads) == 0);
+            REQUIRE(v4_repl_stack_depth(repl) == 3);
+            v4_i32 result;
+            vm_ds_pop(vm, &result);
+            CHECK(result == 2);
+            vm_ds_pop(vm, &result);
+            CHECK(result == 0);
+            vm_ds_pop(vm, &result);
+            CHECK(result == 1);
+        }
+    }
+
+    SUBCASE("Errors stop the load") {
+        v4_err err = v4_repl_load_source(repl, ": GOOD 1 ;\n: BAD NO_SUCH_WORD ;\n2 GOOD\n", 4);
+        CHECK(err != 0);
+        CHECK(v4_repl_get_error(repl) != nullptr);
+        CHECK(v4_repl_find_word(repl, "BAD") == -1);
+        CHECK(v4_repl_stack_depth(repl) == 0);
+
+        err = v4_repl_load_source(repl, ": GOOD 1 ;\nGOOD NO_SUCH_WORD\n", 4);
+        CHECK(err != 0);
+        REQUIRE(v4_repl_get_error(repl) != nullptr);
+        CHECK(strstr(v4_repl_get_error(repl), "(source line 2)") != nullptr);
+    }
+}
+
+class V4ReplLazyFixture : public V4ReplFixture {
+protected:
+    void configure(V4ReplConfig& config) override {
+        config.lazy_definitions = 1;
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplLazyFixture, "libv4repl: Lazy definitions") {
+    setup();
+
+    REQUIRE(v4_repl_process_line(repl, ": SQUARE DUP * ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": SQ+1 SQUARE 1 + ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": UNUSED 42 ;") == 0);
+
+    // Recorded, not compiled
+    CHECK(v4_repl_find_word(repl, "SQUARE") == -1);
+    CHECK(v4_repl_find_word(repl, "SQ+1") == -1);
+    const char* names[4];
+    REQUIRE(v4_repl_lazy_words(repl, "SQ", names, 4) == 2);
+    CHECK(strcmp(names[0], "SQ+1") == 0);
+    CHECK(strcmp(names[1], "SQUARE") == 0);
+
+    SUBCASE("First use compiles the word and the words it uses") {
+        REQUIRE(v4_repl_process_line(repl, "3 SQ+1") == 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 10);
+        CHECK(v4_repl_find_word(repl, "SQUARE") >= 0);
+        CHECK(v4_repl_find_word(repl, "SQ+1") >= 0);
+        CHECK(v4_repl_find_word(repl, "UNUSED") == -1);
+        CHECK(v4_repl_lazy_words(repl, "", nullptr, 0) == 1);
+    }
+
+    SUBCASE("A pending redefinition replaces the earlier one") {
+        REQUIRE(v4_repl_process_line(repl, ": SQUARE DUP DUP * * ;") == 0);
+        CHECK(v4_repl_find_word(repl, "SQ+1") >= 0);  // Compiled against the first SQUARE
+        REQUIRE(v4_repl_process_line(repl, "2 SQUARE 3 SQ+1") == 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 10);
+        vm_ds_pop(vm, &result);
+        CHECK(result == 8);
+        CHECK(v4_repl_lazy_words(repl, "SQ", nullptr, 0) == 0);
+    }
+
+    SUBCASE("Mixed lines and batch loads") {
+        // Code besides definitions is compiled as usual
+        REQUIRE(v4_repl_process_line(repl, ": CUBE DUP SQUARE * ; 2 CUBE") == 0);
+        CHECK(v4_repl_find_word(repl, "CUBE") >= 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 8);
+
+        REQUIRE(v4_repl_load_source(repl, ": ONE 1 ;\n: TWO 2 ;\nTWO\n", 2) == 0);
+        CHECK(v4_repl_find_word(repl, "ONE") == -1);
+        CHECK(v4_repl_find_word(repl, "TWO") >= 0);
+        vm_ds_pop(vm, &result);
+        CHECK(result == 2);
+    }
+
+    SUBCASE("Errors name the lazy definition") {
+        REQUIRE(v4_repl_process_line(repl, ": BROKEN NO_SUCH_WORD ;") == 0);
+        CHECK(v4_repl_process_line(repl, "BROKEN") != 0);
+        REQUIRE(v4_repl_get_error(repl) != nullptr);
+        CHECK(strstr(v4_repl_get_error(repl), "(in lazy definition of BROKEN)") != nullptr);
+        CHECK(v4_repl_lazy_words(repl, "BROKEN", nullptr, 0) == 1);
+    }
+
+    SUBCASE("Pending words keep the meaning a name had when they were recorded") {
+        REQUIRE(v4_repl_process_line(repl, ": BASE 1 ;") == 0);
+        REQUIRE(v4_repl_process_line(repl, ": ONE-MORE BASE 10 + ;") == 0);
+        REQUIRE(v4_repl_process_line(repl, ": BASE 2 ;") == 0);  // Compiles ONE-MORE first
+        CHECK(v4_repl_find_word(repl, "ONE-MORE") >= 0);
+
+        REQUIRE(v4_repl_process_line(repl, ": TWO-MORE BASE 20 + ;") == 0);
+        REQUIRE(v4_repl_process_line(repl, ": BASE 3 ; 0 DROP") == 0);  // Eager
+        REQUIRE(v4_repl_process_line(repl, "ONE-MORE TWO-MORE BASE") == 0);
+        v4_i32 result;
+        vm_ds_pop(vm, &result);
+        CHECK(result == 3);
+        vm_ds_pop(vm, &result);
+        CHECK(result == 22);
+        vm_ds_pop(vm, &result);
+        CHECK(result == 11);
+    }
+
+    SUBCASE("Snapshot compiles pending definitions") {
+        size_t len = 0;
+        REQUIRE(v4_repl_snapshot(repl, nullptr, 0, &len) == 0);
+        CHECK(v4_repl_lazy_words(repl, "", nullptr, 0) == 0);
+        CHECK(v4_repl_find_word(repl, "UNUSED") >= 0);
+        CHECK(v4_repl_find_word(repl, "SQ+1") >= 0);
+
+        REQUIRE(v4_repl_process_line(repl, ": BROKEN NO_SUCH_WORD ;") == 0);
+        CHECK(v4_repl_snapshot(repl, nullptr, 0, &len) != 0);
+        CHECK(len == 0);
+        REQUIRE(v4_repl_get_error(repl) != nullptr);
+        CHECK(strstr(v4_repl_get_error(repl), "(in lazy definition of BROKEN)") != nullptr);
+    }
+
+    SUBCASE("Long chains of pending definitions") {
+        const int depth = 1000;
+        char line[64];
+        REQUIRE(v4_repl_process_line(repl, ": W0 1 ;") == 0);
+        for (int i = 1; i < depth; i++) {
+            snprintf(line, sizeof(line), ": W%d W%d 1 + ;", i, i - 1);
+            REQUIRE(v4_repl_process_line(repl, line) == 0);
+        }
+        snprintf(line, sizeof(line), ": TOP W%d ; 0 DROP", depth - 1);
+        REQUIRE(v4_repl_process_line(repl, line) == 0);
+        CHECK(v4_repl_find_word(repl, "W0") >= 0);
+        CHECK(v4_repl_lazy_words(repl, "W", nullptr, 0) == 0);
+    }
+
+    SUBCASE("Dictionary reset forgets pending definitions") {
+        v4_repl_reset_dictionary(repl);
+        CHECK(v4_repl_lazy_words(repl, "", nullptr, 0) == 0);
+    }
+}
+
+#if V4REPL_WITH_POOL
+struct PoolResults {
+    std::atomic<int> ok{0};
+    std::atomic<int> errors{0};
+    std::atomic<int> wrong{0};
+};
+
+// Tag 0 marks setup lines; otherwise "<tag> SQUARE" must leave tag*tag on top
+static void pool_result(void* user, int session, uint64_t tag, v4_err err, const char* output,
+                        size_t len) {
+    (void) session;
+    PoolResults* r = static_cast<PoolResults*>(user);
+    if (err != 0) {
+        r->errors++;
+        return;
+    }
+    if (tag == 0) {
+        return;
+    }
+    char expected[32];
+    int n = snprintf(expected, sizeof(expected), " %d\n", (int) (tag * tag));
+    if ((size_t) n <= len && memcmp(expected, output + len - n, n) == 0) {
+        r->ok++;
+    } else {
+        r->wrong++;
+    }
+}
+
+TEST_CASE("libv4repl: Session pool") {
+    PoolResults results;
+
+    V4ReplPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.workers = 4;
+    config.sessions = 8;
+    config.vm_mem_size = 4096;
+    config.queue_capacity = 1024;
+    config.on_result = pool_result;
+    config.user = &results;
+
+    V4ReplPool* pool = v4_repl_pool_create(&config);
+    REQUIRE(pool != nullptr);
+    CHECK(v4_repl_pool_session_count(pool) == 8);
+    CHECK(v4_repl_pool_worker_count(pool) == 4);
+
+    // Definitions are per session
+    for (int s = 0; s < 8; ++s) {
+        REQUIRE(v4_repl_pool_submit(pool, s, ": SQUARE DUP * ;", 0) == 0);
+    }
+    v4_repl_pool_wait_idle(pool);
+    CHECK(results.errors == 0);
+
+    SUBCASE("Lines from many threads reach their sessions") {
+        std::thread producers[2];
+        for (int t = 0; t < 2; ++t) {
+            producers[t] = std::thread([pool, t] {
+                for (int i = 0; i < 400; ++i) {
+                    char line[32];
+                    int n = 1 + (i % 100);
+                    snprintf(line, sizeof(line), "%d SQUARE", n);
+                    while (v4_repl_pool_submit(pool, (i + t) % 8, line, (uint64_t) n) ==
+                           V4_REPL_POOL_ERR_FULL) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int t = 0; t < 2; ++t) {
+            producers[t].join();
+        }
+        v4_repl_pool_wait_idle(pool);
+
+        CHECK(results.errors == 0);
+        CHECK(results.wrong == 0);
+        CHECK(results.ok == 800);
+
+        // 800 lines over 8 sessions: each stack holds its own 100 results
+        for (int s = 0; s < 8; ++s) {
+            CHECK(v4_repl_stack_depth(v4_repl_pool_context(pool, s)) == 100);
+        }
+    }
+
+    SUBCASE("Invalid session is rejected") {
+        CHECK(v4_repl_pool_submit(pool, 8, "1", 0) == V4_REPL_POOL_ERR_SESSION);
+        CHECK(v4_repl_pool_submit(pool, -1, "1", 0) == V4_REPL_POOL_ERR_SESSION);
+        CHECK(v4_repl_pool_context(pool, 8) == nullptr);
+    }
+
+    SUBCASE("Interrupt reaches the session's context") {
+        v4_repl_pool_interrupt(pool, 3);
+        REQUIRE(v4_repl_pool_submit(pool, 3, "1 2 +", 0) == 0);
+        v4_repl_pool_wait_idle(pool);
+        CHECK(results.errors == 1);
+        CHECK(v4_repl_stack_depth(v4_repl_pool_context(pool, 3)) == 0);
+    }
+
+    v4_repl_pool_destroy(pool);
+}
+#endif
+
+#if V4_REPL_ENABLE_STATS
+static uint64_t g_fake_now = 0;
+
+// Every reading advances 100ns, so each timed phase measures exactly 100ns
+static uint64_t fake_clock_ns(void) {
+    g_fake_now += 100;
+    return g_fake_now;
+}
+
+class V4ReplStatsFixture : public V4ReplFixture {
+protected:
+    void configure(V4ReplConfig& config) override {
+        config.clock_ns = fake_clock_ns;
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplStatsFixture, "libv4repl: Per-phase statistics") {
+    setup();
+
+    SUBCASE("Phases are timed separately") {
+        CHECK(v4_repl_process_line(repl, "2 3 +") == 0);
+
+        V4ReplStats stats;
+        REQUIRE(v4_repl_get_stats(repl, &stats) == 0);
+        CHECK(stats.lines == 1);
+        CHECK(stats.compile_ns_last == 100);
+        CHECK(stats.register_ns_last == 100);
+        CHECK(stats.exec_ns_last == 100);
+        CHECK(stats.exec_ns_total == 100);
+        CHECK(stats.bytecode_bytes > 0);
+        CHECK(stats.errors == 0);
+    }
+
+    SUBCASE("Errors are counted by code") {
+        v4_err err = v4_repl_process_line(repl, "NO_SUCH_WORD");
+        REQUIRE(err < 0);
+
+        V4ReplStats stats;
+        REQUIRE(v4_repl_get_stats(repl, &stats) == 0);
+        CHECK(stats.errors == 1);
+        CHECK(stats.compile_errors == 1);
+        int slot = (-err < V4_REPL_STATS_ERROR_SLOTS) ? -err : 0;
+        CHECK(stats.error_counts[slot] == 1);
+    }
+
+    SUBCASE("Reset zeroes the counters") {
+        CHECK(v4_repl_process_line(repl, ": SQUARE DUP * ;") == 0);
+        v4_repl_reset_stats(repl);
+
+        V4ReplStats stats;
+        REQUIRE(v4_repl_get_stats(repl, &stats) == 0);
+        CHECK(stats.lines == 0);
+        CHECK(stats.compile_ns_total == 0);
+        CHECK(stats.bytecode_bytes == 0);
+    }
+}
+
+class V4ReplLazyStatsFixture : public V4ReplFixture {
+protected:
+    void configure(V4ReplConfig& config) override {
+        config.clock_ns = fake_clock_ns;
+        config.lazy_definitions = 1;
+    }
+};
+
+TEST_CASE_FIXTURE(V4ReplLazyStatsFixture, "libv4repl: Lazy compiles are timed once") {
+    setup();
+
+    REQUIRE(v4_repl_process_line(repl, ": BASE 1 ;") == 0);
+    REQUIRE(v4_repl_process_line(repl, ": USE BASE ;") == 0);
+    v4_repl_reset_stats(repl);
+
+    // Redefining BASE first compiles BASE and USE, inside the line's own phases
+    REQUIRE(v4_repl_process_line(repl, ": BASE 2 ; 0 DROP") == 0);
+
+    V4ReplStats stats;
+    REQUIRE(v4_repl_get_stats(repl, &stats) == 0);
+    CHECK(stats.compile_ns_last == 3 * 100);   // The line, BASE and USE
+    CHECK(stats.register_ns_last == 4 * 100);  // BASE and USE, then the line's two steps
+}
+#endif
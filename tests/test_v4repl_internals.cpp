@@ -0,0 +1,460 @@
+/**
+ * @file test_v4repl_internals.cpp
+ * @brief Unit tests for internal modules of the v4-repl executable
+ *
+ * Covers code that is not reachable through the libv4repl C API. Words
+ * are registered in a bare VM from hand-built bytecode, so addresses and
+ * call graphs are known exactly.
+ */
+
+#define DOCTEST_CONFIG_NO_EXCEPTIONS_BUT_WITH_ALL_ASSERTS
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+extern "C" {
+#include "v4/vm_api.h"
+}
+
+#include <v4/opcodes.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "code_map.hpp"
+#include "disasm.hpp"
+#include "hex_dump.hpp"
+#include "profiler.hpp"
+#include "snapshot.h"
+#include "word_deps.hpp"
+#include "word_index.h"
+
+/**
+ * Bytecode builder. Operand sizes follow disasm.cpp: LIT and CALL take
+ * 32 bits, jumps a signed 16-bit offset from the next instruction.
+ */
+struct Code {
+    uint8_t bytes[128];
+    uint32_t len = 0;
+
+    Code& op(v4::Op o) {
+        bytes[len++] = static_cast<uint8_t>(o);
+        return *this;
+    }
+    Code& imm(int32_t v, int size) {
+        for (int i = 0; i < size; i++) {
+            bytes[len++] = static_cast<uint8_t>((uint32_t) v >> (8 * i));
+        }
+        return *this;
+    }
+    Code& lit(int32_t v) {
+        return op(v4::Op::LIT).imm(v, 4);
+    }
+    Code& call(int wid) {
+        return op(v4::Op::CALL).imm(wid, 4);
+    }
+    Code& jump(v4::Op o, int16_t rel) {
+        return op(o).imm(rel, 2);
+    }
+    Code& ret() {
+        return op(v4::Op::RET);
+    }
+};
+
+/**
+ * Test fixture: a VM plus the definition log and word index the REPL
+ * keeps next to it. Bytecode handed to define() is kept in the fixture,
+ * since the VM and the log only borrow it.
+ */
+class VmWordsFixture {
+protected:
+    static constexpr int MAX_WORDS = 16;
+
+    uint8_t vm_memory[4096];
+    struct Vm* vm;
+    V4ReplDefLog defs;
+    V4ReplWordIndex words;
+    Code code[MAX_WORDS];
+    int code_count;
+
+    VmWordsFixture() : vm(nullptr), defs(), words(), code_count(0) {
+        memset(vm_memory, 0, sizeof(vm_memory));
+        VmConfig vm_config;
+        memset(&vm_config, 0, sizeof(vm_config));
+        vm_config.mem = vm_memory;
+        vm_config.mem_size = sizeof(vm_memory);
+        vm = vm_create(&vm_config);
+        REQUIRE(vm != nullptr);
+    }
+
+    virtual ~VmWordsFixture() {
+        if (vm) {
+            vm_destroy(vm);
+        }
+        v4repl_deflog_free(&defs);
+        v4repl_index_free(&words);
+    }
+
+    // Register a word as the REPL does; returns its word ID
+    int define(const char* name, const Code& c) {
+        REQUIRE(code_count < MAX_WORDS);
+        Code* kept = &code[code_count++];
+        *kept = c;
+        int wid = vm_register_word(vm, name, kept->bytes, (int) kept->len);
+        REQUIRE(wid >= 0);
+        REQUIRE(v4repl_deflog_append(&defs, wid, name, kept->bytes, kept->len) == 0);
+        REQUIRE(v4repl_index_add(&words, name, wid) == 0);
+        return wid;
+    }
+
+    // Return-stack entry for an offset into the n-th defined word
+    int32_t addr(int n, uint32_t offset) const {
+        return (int32_t) (uint32_t) (uintptr_t) (code[n].bytes + offset);
+    }
+};
+
+TEST_CASE_FIXTURE(VmWordsFixture, "v4-repl: Profiler attributes samples to words") {
+    // C calls B calls A; R calls itself
+    int a = define("A", Code().lit(1).ret());
+    int b = define("B", Code().call(a).ret());
+    int c = define("C", Code().call(b).ret());
+    int r = define("R", Code().call(c + 1).ret());
+    REQUIRE(r == c + 1);  // IDs are handed out in order
+    const uint32_t after_call = 5;  // CALL + 32-bit word ID
+
+    CodeMap map;
+    REQUIRE(map.rebuild(vm, defs));
+    Profiler profiler;
+
+    SUBCASE("Innermost return address names the running word") {
+        int32_t in_a[] = {addr(1, after_call), addr(2, after_call)};  // A, called by B from C
+        profiler.record(map, in_a, 2);
+        int32_t in_b[] = {addr(2, after_call)};  // B, called by C
+        profiler.record(map, in_b, 1);
+
+        CHECK(profiler.self_samples(a) == 1);
+        CHECK(profiler.self_samples(b) == 1);
+        CHECK(profiler.self_samples(c) == 0);
+        CHECK(profiler.inclusive_samples(a) == 1);
+        CHECK(profiler.inclusive_samples(b) == 2);
+        CHECK(profiler.inclusive_samples(c) == 2);
+    }
+
+    SUBCASE("No frames means top-level code") {
+        profiler.record(map, nullptr, 0);
+        CHECK(profiler.top_level_samples() == 1);
+        CHECK(profiler.self_samples(a) == 0);
+    }
+
+    SUBCASE("Unknown return addresses are not attributed") {
+        int32_t stray[] = {addr(0, 0) - 4096};
+        profiler.record(map, stray, 1);
+        for (int wid = a; wid <= r; wid++) {
+            CHECK(profiler.self_samples(wid) == 0);
+            CHECK(profiler.inclusive_samples(wid) == 0);
+        }
+    }
+
+    SUBCASE("A recursive word counts once per sample") {
+        int32_t deep[] = {addr(3, after_call), addr(3, after_call), addr(3, after_call)};
+        profiler.record(map, deep, 3);
+        CHECK(profiler.self_samples(r) == 1);
+        CHECK(profiler.inclusive_samples(r) == 1);
+    }
+}
+
+// Everything print_trace() writes to a stream
+static std::string trace_text(const CodeMap& map, const v4_i32* rs, int depth,
+                              const V4ReplWordIndex& words) {
+    FILE* f = tmpfile();
+    REQUIRE(f != nullptr);
+    map.print_trace(f, rs, depth, words);
+    std::string text;
+    rewind(f);
+    char chunk[256];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        text.append(chunk, n);
+    }
+    fclose(f);
+    return text;
+}
+
+TEST_CASE_FIXTURE(VmWordsFixture, "v4-repl: Code map lookups and backtraces") {
+    // C calls B calls A; each word's bytecode is followed by unused bytes
+    int a = define("A", Code().lit(7).ret());
+    int b = define("B", Code().lit(1).call(a).ret());
+    define("C", Code().call(b).ret());
+    const uint32_t a_len = 6;             // LIT + 32-bit value, RET
+    const uint32_t b_after_call = 5 + 5;  // Return address in B
+    const uint32_t c_after_call = 5;      // Return address in C
+
+    CodeMap map;
+    REQUIRE(map.rebuild(vm, defs));
+    CHECK(map.size() == 3);
+
+    SUBCASE("First and last byte of a word") {
+        const CodeMap::Range* first = map.find((uint32_t) addr(0, 0));
+        const CodeMap::Range* last = map.find((uint32_t) addr(0, a_len - 1));
+        REQUIRE(first != nullptr);
+        CHECK(first->wid == a);
+        CHECK(strcmp(first->name, "A") == 0);
+        CHECK(last == first);
+    }
+
+    SUBCASE("Addresses between and outside words") {
+        CHECK(map.find((uint32_t) addr(0, a_len)) == nullptr);  // Just past A
+        CHECK(map.find((uint32_t) addr(0, 0) - 1) == nullptr);  // Just before A
+        CHECK(map.find((uint32_t) addr(2, 64)) == nullptr);     // Past the last word
+
+        char where[64];
+        map.describe((uint32_t) addr(0, a_len), where, sizeof(where));
+        CHECK(strcmp(where, "???") == 0);
+        map.describe((uint32_t) addr(1, b_after_call), where, sizeof(where));
+        CHECK(strcmp(where, "B+0xA") == 0);
+    }
+
+    SUBCASE("Top-level code is a separate range") {
+        const uint8_t line[] = {static_cast<uint8_t>(v4::Op::RET)};
+        map.set_top_level(line, sizeof(line));
+        const CodeMap::Range* top = map.find((uint32_t) (uintptr_t) line);
+        REQUIRE(top != nullptr);
+        CHECK(top->wid == -1);
+        map.set_top_level(nullptr, 0);
+        CHECK(map.find((uint32_t) (uintptr_t) line) == nullptr);
+    }
+
+    SUBCASE("Callee of the CALL before a return address") {
+        const CodeMap::Range* in_b = map.find((uint32_t) addr(1, b_after_call));
+        REQUIRE(in_b != nullptr);
+        CHECK(CodeMap::callee_at(in_b, (uint32_t) addr(1, b_after_call)) == a);
+        CHECK(CodeMap::callee_at(in_b, (uint32_t) addr(1, 5)) == -1);  // After LIT, not CALL
+        CHECK(CodeMap::callee_at(in_b, (uint32_t) addr(1, 2)) == -1);  // Too close to the start
+    }
+
+    SUBCASE("Backtrace names the innermost callee first") {
+        v4_i32 rs[] = {addr(2, c_after_call), addr(1, b_after_call)};  // Bottom first
+        std::string text = trace_text(map, rs, 2, words);
+        CHECK(text.find("  #0  A\n") != std::string::npos);
+        CHECK(text.find("  #1  B+0xA") != std::string::npos);
+        CHECK(text.find("  #2  C+0x5") != std::string::npos);
+        CHECK(text.find("#0  A") < text.find("#1  B"));
+    }
+
+    SUBCASE("Backtrace of top-level code") {
+        std::string text = trace_text(map, nullptr, 0, words);
+        CHECK(text.find("  #0  <top-level>\n") != std::string::npos);
+        CHECK(text.find("#1") == std::string::npos);
+    }
+}
+
+TEST_CASE_FIXTURE(VmWordsFixture, "v4-repl: Static word analysis") {
+    using v4::Op;
+    Disassembler dis(vm, words);
+
+    SUBCASE("Leaf word") {
+        int sq = define("SQ", Code().op(Op::DUP).op(Op::MUL).ret());  // ( n -- n*n )
+        const Disassembler::WordFacts* f = dis.analyze(sq);
+        REQUIRE(f != nullptr);
+        CHECK(f->insn_count == 3);
+        CHECK(f->leaf);
+        CHECK_FALSE(f->recursive);
+        CHECK(f->call_depth == 0);
+        REQUIRE(f->effect_known);
+        CHECK(f->inputs == 1);
+        CHECK(f->outputs == 1);
+        CHECK(f->peak == 1);
+
+        // A caller takes the callee's effect and peak at the call depth
+        int user = define("USER", Code().lit(3).call(sq).ret());
+        const Disassembler::WordFacts* u = dis.analyze(user);
+        REQUIRE(u != nullptr);
+        CHECK_FALSE(u->leaf);
+        CHECK(u->call_count == 1);
+        CHECK(u->call_depth == 1);
+        REQUIRE(u->effect_known);
+        CHECK(u->inputs == 0);
+        CHECK(u->outputs == 1);
+        CHECK(u->peak == 2);
+    }
+
+    SUBCASE("Both sides of a branch") {
+        // ( flag -- n ) IF 1 ELSE 2 THEN
+        Code pick;
+        pick.jump(Op::JZ, 8);   // 0: to ELSE at 11
+        pick.lit(1);            // 3
+        pick.jump(Op::JMP, 5);  // 8: to THEN at 16
+        pick.lit(2);            // 11
+        pick.ret();             // 16
+        const Disassembler::WordFacts* f = dis.analyze(define("PICK", pick));
+        REQUIRE(f != nullptr);
+        CHECK(f->insn_count == 5);
+        REQUIRE(f->effect_known);
+        CHECK(f->inputs == 1);
+        CHECK(f->outputs == 1);
+        CHECK(f->peak == 0);
+    }
+
+    SUBCASE("Unbalanced paths make the effect unknown") {
+        // IF 1 1 ELSE 2 THEN: the paths meet with different depths
+        Code lopsided;
+        lopsided.jump(Op::JZ, 13);  // 0: to ELSE at 16
+        lopsided.lit(1).lit(1);     // 3
+        lopsided.jump(Op::JMP, 5);  // 13: to THEN at 21
+        lopsided.lit(2);            // 16
+        lopsided.ret();             // 21
+        const Disassembler::WordFacts* f = dis.analyze(define("LOPSIDED", lopsided));
+        REQUIRE(f != nullptr);
+        CHECK_FALSE(f->effect_known);
+
+        // IF 1 EXIT THEN 1 1: both paths return, with different depths
+        Code exits;
+        exits.jump(Op::JZ, 6);  // 0: to 9
+        exits.lit(1).ret();     // 3
+        exits.lit(1).lit(1);    // 9
+        exits.ret();            // 19
+        const Disassembler::WordFacts* e = dis.analyze(define("EXITS", exits));
+        REQUIRE(e != nullptr);
+        CHECK_FALSE(e->effect_known);
+    }
+
+    SUBCASE("Direct recursion") {
+        // ( n -- ) DUP IF 1 - RECURSE ELSE DROP THEN
+        Code down;
+        int self = code_count;  // IDs are handed out in order
+        down.op(Op::DUP);
+        down.jump(Op::JZ, 14);    // 1: to ELSE at 18
+        down.lit(1).op(Op::SUB);  // 4
+        down.call(self);          // 10
+        down.jump(Op::JMP, 1);    // 15: to THEN at 19
+        down.op(Op::DROP);        // 18
+        down.ret();               // 19
+        int wid = define("DOWN", down);
+        REQUIRE(wid == self);
+
+        const Disassembler::WordFacts* f = dis.analyze(wid);
+        REQUIRE(f != nullptr);
+        CHECK(f->recursive);
+        CHECK(f->call_depth == -1);
+        CHECK_FALSE(f->leaf);
+        CHECK_FALSE(f->effect_known);
+    }
+
+    SUBCASE("Indirect recursion") {
+        // PING calls PONG calls PING; TOP calls PING but is not on the cycle
+        int ping = code_count;
+        define("PING", Code().call(ping + 1).ret());
+        int pong = define("PONG", Code().call(ping).ret());
+        int top = define("TOP", Code().call(ping).ret());
+        REQUIRE(pong == ping + 1);
+
+        const Disassembler::WordFacts* t = dis.analyze(top);
+        REQUIRE(t != nullptr);
+        CHECK_FALSE(t->recursive);
+        CHECK(t->call_depth == -1);  // Unbounded below
+
+        const Disassembler::WordFacts* pi = dis.analyze(ping);
+        const Disassembler::WordFacts* po = dis.analyze(pong);
+        REQUIRE(pi != nullptr);
+        REQUIRE(po != nullptr);
+        CHECK(pi->recursive);
+        CHECK(po->recursive);
+        CHECK(pi->call_depth == -1);
+        CHECK(po->call_depth == -1);
+    }
+}
+
+TEST_CASE("v4-repl: Hex dump rows") {
+    char line[HexDump::LINE_SIZE];
+    uint8_t bytes[HexDump::ROW_BYTES];
+    for (uint32_t i = 0; i < HexDump::ROW_BYTES; i++) {
+        bytes[i] = (uint8_t) ('A' + i);
+    }
+
+    SUBCASE("Full row") {
+        size_t n = HexDump::format_row(line, 0x1230, bytes, 16);
+        CHECK(std::string(line, n) ==
+              "00001230  41 42 43 44  45 46 47 48  49 4A 4B 4C  4D 4E 4F 50   ABCDEFGHIJKLMNOP\n");
+    }
+
+    SUBCASE("Non-printable bytes in the ASCII column") {
+        bytes[0] = 0x00;
+        bytes[1] = 0x1F;
+        bytes[2] = 0x7F;
+        bytes[3] = 0xFF;
+        bytes[4] = ' ';
+        bytes[5] = '~';
+        size_t n = HexDump::format_row(line, 0, bytes, 16);
+        std::string row(line, n);
+        CHECK(row.substr(10, 12) == "00 1F 7F FF ");
+        CHECK(row.substr(n - 17) == ".... ~GHIJKLMNOP\n");
+    }
+
+    SUBCASE("Partial last row") {
+        size_t n = HexDump::format_row(line, 0xFFF0, bytes, 5);
+        CHECK(std::string(line, n) ==
+              "0000FFF0  41 42 43 44  45 ?? ?? ??  ?? ?? ?? ??  ?? ?? ?? ??   ABCDE...........\n");
+
+        size_t empty = HexDump::format_row(line, 0, bytes, 0);
+        CHECK(empty == n);  // Rows are fixed-width
+        CHECK(std::string(line, empty).find("41") == std::string::npos);
+    }
+}
+
+TEST_CASE("v4-repl: Hex dump range is clamped to memory") {
+    const size_t mem = 16384;
+
+    CHECK(HexDump::row_span(0, 256, mem) == 256);
+    CHECK(HexDump::row_span(0, 1, mem) == 16);  // Whole rows
+    CHECK(HexDump::row_span(0, 0, mem) == 0);
+
+    // Lengths near UINT32_MAX used to wrap to a tiny range when rounded
+    CHECK(HexDump::row_span(0, 0xFFFFFFFFu, mem) == mem);
+    CHECK(HexDump::row_span(0, 0xFFFFFFF1u, mem) == mem);
+    CHECK(HexDump::row_span(0x100, 0xFFFFFFFFu, mem) == mem - 0x100);
+
+    // The last row may run past the end; format_row() marks those bytes
+    CHECK(HexDump::row_span(mem - 4, 100, mem) == 16);
+
+    CHECK(HexDump::row_span((uint32_t) mem, 16, mem) == 0);
+    CHECK(HexDump::row_span(0xFFFFFFF0u, 0xFFFFFFFFu, mem) == 0);
+}
+
+TEST_CASE("v4-repl: Words with unknown opcodes are never retired") {
+    int unknown = -1;
+    for (int op = 255; op >= 0 && unknown < 0; op--) {
+        if (Disassembler::op_info((uint8_t) op)->flags & Disassembler::OPF_UNKNOWN) {
+            unknown = op;
+        }
+    }
+    REQUIRE(unknown >= 0);
+
+    Code leaf, opaque, caller;
+    leaf.ret();
+    opaque.op((v4::Op) unknown).call(0).ret();  // The CALL may be an operand byte
+    caller.call(0).ret();
+
+    WordDeps deps;
+    REQUIRE(deps.add(0, true, leaf.bytes, leaf.len));
+    REQUIRE(deps.add(1, true, opaque.bytes, opaque.len));
+    REQUIRE(deps.add(2, true, caller.bytes, caller.len));
+
+    deps.set_bound(1, false);
+    CHECK(deps.sweep(1) == 0);
+    CHECK_FALSE(deps.is_retired(1));
+
+    // The call found by scanning still keeps the callee alive
+    deps.set_bound(0, false);
+    deps.set_bound(2, false);
+    CHECK(deps.unused_bytes() == caller.len);
+    CHECK(deps.sweep(2) == 1);
+    CHECK(deps.unused_bytes() == 0);
+    CHECK(deps.retired(0) == 2);
+    CHECK_FALSE(deps.is_retired(0));
+
+    int order[3];
+    CHECK(deps.layout_order(order) == 2);
+    CHECK(order[0] == 1);
+    CHECK(order[1] == 0);
+}